@@ -11,7 +11,15 @@ CommonCompilerFlags="-O0 -g -ggdb -fdiagnostics-color=always -std=gnu99 -fno-rtt
 -Wno-error=unused-variable -Wno-unused-function
 -Wno-error=unused-command-line-argument"
 
-CommonLinkerFlags="-Wl,--gc-sections -lm"
+CommonLinkerFlags="-Wl,--gc-sections -lm -pthread"
+
+# NOTE(dgl): e.g. DGL_SANITIZE=thread ./build.sh to run the tests under ThreadSanitizer
+if [ -n "$DGL_SANITIZE" ]; then
+    CommonCompilerFlags="$CommonCompilerFlags -fsanitize=$DGL_SANITIZE"
+fi
+
+# NOTE(dgl): dgl.hpp needs C++11
+CppCompilerFlags="${CommonCompilerFlags/-std=gnu99/-std=c++11}"
 
 if [ -z "$1" ]; then
     OS_NAME=$(uname -o 2>/dev/null || uname -s)
@@ -38,8 +46,16 @@ if [ "$OS_NAME" == "GNU/Linux" ] || \
     echo "Building tests"
     clang $CommonIncludeFlags $CommonCompilerFlags $CommonLinkerFlags -o linux/dgl_test_x64 $srcDir/dgl_test.c
 
+    echo "Building tests with DGL_FAST_MEMCPY"
+    clang $CommonIncludeFlags $CommonCompilerFlags $CommonLinkerFlags -DDGL_FAST_MEMCPY -o linux/dgl_test_fast_memcpy_x64 $srcDir/dgl_test.c
+
+    echo "Building C++ tests"
+    clang++ $CommonIncludeFlags $CppCompilerFlags $CommonLinkerFlags -o linux/dgl_test_cpp_x64 $srcDir/dgl_test.cpp
+
     echo "Testing:"
     ./linux/dgl_test_x64
+    ./linux/dgl_test_fast_memcpy_x64
+    ./linux/dgl_test_cpp_x64
 fi
 
 popd > /dev/null
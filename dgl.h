@@ -89,6 +89,12 @@ extern "C" {
 #define local_persist static
 #define local_inline static inline
 
+#if COMPILER_MSVC
+#define dgl_thread_local __declspec(thread)
+#else
+#define dgl_thread_local __thread
+#endif
+
 // NOTE(dgl): Casts can be very annoying while debugging. This is to identiy/search for them faster.
 #define dgl_cast(type) (type)
 #define array_count(array) (sizeof(array) / sizeof((array)[0]))
@@ -207,6 +213,18 @@ dgl_round_real32_to_int32(real32 value)
     return(result);
 }
 
+#if COMPILER_MSVC
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+DGL_DEF inline uint64
+dgl_read_cpu_timer(void)
+{
+    uint64 result = __rdtsc();
+    return(result);
+}
+
 #if COMPILER_LLVM
 DGL_DEF inline uint32
 dgl_atomic_compare_exchange_uint32(uint32 volatile *value, uint32 new_val, uint32 expected)
@@ -226,6 +244,85 @@ dgl_atomic_compare_exchange_uintptr(uintptr volatile *value, uintptr new_val, ui
     uintptr result = __sync_val_compare_and_swap(value, expected, new_val);
     return(result);
 }
+DGL_DEF inline uint64
+dgl_atomic_compare_exchange_uint64(uint64 volatile *value, uint64 new_val, uint64 expected)
+{
+    uint64 result = __sync_val_compare_and_swap(value, expected, new_val);
+    return(result);
+}
+// NOTE(dgl): Returns the value before the addition.
+DGL_DEF inline uint32
+dgl_atomic_add_uint32(uint32 volatile *value, uint32 addend)
+{
+    uint32 result = __sync_fetch_and_add(value, addend);
+    return(result);
+}
+DGL_DEF inline uint64
+dgl_atomic_add_uint64(uint64 volatile *value, uint64 addend)
+{
+    uint64 result = __sync_fetch_and_add(value, addend);
+    return(result);
+}
+// NOTE(dgl): Loads are acquire, stores are release and exchanges are a full barrier.
+DGL_DEF inline uint64
+dgl_atomic_load_uint64(uint64 volatile *value)
+{
+    uint64 result = __atomic_load_n(value, __ATOMIC_ACQUIRE);
+    return(result);
+}
+DGL_DEF inline void
+dgl_atomic_store_uint64(uint64 volatile *value, uint64 new_val)
+{
+    __atomic_store_n(value, new_val, __ATOMIC_RELEASE);
+}
+DGL_DEF inline uint64
+dgl_atomic_exchange_uint64(uint64 volatile *value, uint64 new_val)
+{
+    uint64 result = __atomic_exchange_n(value, new_val, __ATOMIC_SEQ_CST);
+    return(result);
+}
+DGL_DEF inline uintptr
+dgl_atomic_load_uintptr(uintptr volatile *value)
+{
+    uintptr result = __atomic_load_n(value, __ATOMIC_ACQUIRE);
+    return(result);
+}
+DGL_DEF inline void
+dgl_atomic_store_uintptr(uintptr volatile *value, uintptr new_val)
+{
+    __atomic_store_n(value, new_val, __ATOMIC_RELEASE);
+}
+DGL_DEF inline uint8
+dgl_atomic_load_uint8(uint8 volatile *value)
+{
+    uint8 result = __atomic_load_n(value, __ATOMIC_ACQUIRE);
+    return(result);
+}
+DGL_DEF inline void
+dgl_atomic_store_uint8(uint8 volatile *value, uint8 new_val)
+{
+    __atomic_store_n(value, new_val, __ATOMIC_RELEASE);
+}
+// NOTE(dgl): Full barrier, e.g. to order a release store before a later load.
+DGL_DEF inline void
+dgl_atomic_fence(void)
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+// NOTE(dgl): value must not be 0.
+DGL_DEF inline uint32
+dgl_count_trailing_zeros_uint64(uint64 value)
+{
+    uint32 result = dgl_cast(uint32)__builtin_ctzll(value);
+    return(result);
+}
+DGL_DEF inline uint32
+dgl_count_set_bits_uint64(uint64 value)
+{
+    uint32 result = dgl_cast(uint32)__builtin_popcountll(value);
+    return(result);
+}
 
 // TODO(dgl): not tested
 #elif COMPILER_MSVC
@@ -248,9 +345,167 @@ dgl_atomic_compare_exchange_uintptr(uintptr volatile *value, uintptr new_val, ui
     uintptr result = _InterlockedCompareExchange(value, new_val, expected);
     return(result);
 }
+DGL_DEF inline uint64
+dgl_atomic_compare_exchange_uint64(uint64 volatile *value, uint64 new_val, uint64 expected)
+{
+    uint64 result = _InterlockedCompareExchange64((__int64 volatile *)value, new_val, expected);
+    return(result);
+}
+DGL_DEF inline uint32
+dgl_atomic_add_uint32(uint32 volatile *value, uint32 addend)
+{
+    uint32 result = _InterlockedExchangeAdd((long volatile *)value, addend);
+    return(result);
+}
+DGL_DEF inline uint64
+dgl_atomic_add_uint64(uint64 volatile *value, uint64 addend)
+{
+    uint64 result = _InterlockedExchangeAdd64((__int64 volatile *)value, addend);
+    return(result);
+}
+// NOTE(dgl): Aligned volatile accesses are atomic on x64 and MSVC gives them acquire/release
+// semantics. The barrier only stops the compiler from reordering.
+DGL_DEF inline uint64
+dgl_atomic_load_uint64(uint64 volatile *value)
+{
+    uint64 result = *value;
+    _ReadWriteBarrier();
+    return(result);
+}
+DGL_DEF inline void
+dgl_atomic_store_uint64(uint64 volatile *value, uint64 new_val)
+{
+    _ReadWriteBarrier();
+    *value = new_val;
+}
+DGL_DEF inline uint64
+dgl_atomic_exchange_uint64(uint64 volatile *value, uint64 new_val)
+{
+    uint64 result = _InterlockedExchange64((__int64 volatile *)value, new_val);
+    return(result);
+}
+DGL_DEF inline uintptr
+dgl_atomic_load_uintptr(uintptr volatile *value)
+{
+    uintptr result = *value;
+    _ReadWriteBarrier();
+    return(result);
+}
+DGL_DEF inline void
+dgl_atomic_store_uintptr(uintptr volatile *value, uintptr new_val)
+{
+    _ReadWriteBarrier();
+    *value = new_val;
+}
+DGL_DEF inline uint8
+dgl_atomic_load_uint8(uint8 volatile *value)
+{
+    uint8 result = *value;
+    _ReadWriteBarrier();
+    return(result);
+}
+DGL_DEF inline void
+dgl_atomic_store_uint8(uint8 volatile *value, uint8 new_val)
+{
+    _ReadWriteBarrier();
+    *value = new_val;
+}
+DGL_DEF inline void
+dgl_atomic_fence(void)
+{
+    // NOTE(dgl): Same as MemoryBarrier on x64.
+    __faststorefence();
+}
+DGL_DEF inline uint32
+dgl_count_trailing_zeros_uint64(uint64 value)
+{
+    unsigned long result;
+    _BitScanForward64(&result, value);
+    return(result);
+}
+DGL_DEF inline uint32
+dgl_count_set_bits_uint64(uint64 value)
+{
+    uint32 result = dgl_cast(uint32)__popcnt64(value);
+    return(result);
+}
 #else
 // TODO(dgl): support other compilers
 #endif
+
+// NOTE(dgl): MSVC has no macro for SSE4.1, so the SSE4.1 kernels are always compiled in there and
+// the cpu has to support SSE4.1. Define DGL_NO_SIMD for older cpus.
+#if !defined(DGL_NO_SIMD) && (defined(__SSE4_1__) || COMPILER_MSVC)
+#define DGL_SIMD_SSE4_1 1
+#else
+#define DGL_SIMD_SSE4_1 0
+#endif
+
+// NOTE(dgl): Functions with this attribute may use AVX2 instructions even if the file is compiled
+// for SSE4.1 only. Only call them after checking dgl_cpu_features.
+#if COMPILER_MSVC
+#define DGL_TARGET_AVX2
+#else
+#define DGL_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+#if COMPILER_MSVC
+#define DGL_TARGET_AES
+#else
+#define DGL_TARGET_AES __attribute__((target("aes,sse4.1")))
+#endif
+
+#define DGL_CPU_FEATURE_SSE4_1 (1 << 0)
+#define DGL_CPU_FEATURE_AVX2 (1 << 1)
+#define DGL_CPU_FEATURE_AES (1 << 2)
+#define DGL_CPU_FEATURE_INITIALIZED (1u << 31)
+
+DGL_DEF uint32 dgl_cpu_features(void);
+
+DGL_DEF inline int32
+dgl_truncate_real32_to_int32(real32 value)
+{
+    int32 result = (int32)value;
+    return(result);
+}
+
+DGL_DEF inline int32
+dgl_clamp_round_real32_to_int32(real32 value, int32 min, int32 max)
+{
+    // NOTE(dgl): Values outside of the int32 range saturate before the clamp.
+    real32 rounded = roundf(value);
+    int32 result;
+    if(rounded >= 2147483648.0f) { result = 0x7FFFFFFF; }
+    else if(rounded <= -2147483648.0f) { result = dgl_cast(int32)0x80000000; }
+    else { result = (int32)rounded; }
+    result = dgl_clamp(result, min, max);
+    return(result);
+}
+
+DGL_DEF inline int16
+dgl_round_real32_to_int16(real32 value)
+{
+    int16 result = (int16)roundf(dgl_clamp(value, -32768.0f, 32767.0f));
+    return(result);
+}
+
+DGL_DEF inline uint8
+dgl_round_real32_to_uint8(real32 value)
+{
+    uint8 result = (uint8)roundf(dgl_clamp(value, 0.0f, 255.0f));
+    return(result);
+}
+
+// NOTE(dgl): The array versions return exactly the same values as the scalar functions above. They
+// use SSE4.1 and switch to AVX2 at runtime if the cpu supports it. NaN inputs are undefined.
+DGL_DEF void dgl_round_real32_to_int32_array(int32 *dest, real32 *source, usize count);
+DGL_DEF void dgl_round_real32_to_uint32_array(uint32 *dest, real32 *source, usize count);
+DGL_DEF void dgl_truncate_real32_to_int32_array(int32 *dest, real32 *source, usize count);
+DGL_DEF void dgl_clamp_round_real32_to_int32_array(int32 *dest, real32 *source, usize count, int32 min, int32 max);
+DGL_DEF void dgl_round_real32_to_int16_array(int16 *dest, real32 *source, usize count);
+DGL_DEF void dgl_round_real32_to_uint8_array(uint8 *dest, real32 *source, usize count);
+DGL_DEF void dgl_int16_to_real32_array(real32 *dest, int16 *source, usize count);
+DGL_DEF void dgl_uint8_to_real32_array(real32 *dest, uint8 *source, usize count);
 #endif // DGL_NO_INTRINSICS
 
 //
@@ -281,9 +536,102 @@ dgl_atomic_compare_exchange_uintptr(uintptr volatile *value, uintptr new_val, ui
 
 typedef void (*dgl_lock_F)(bool32 lock);
 typedef int64 (*dgl_time_in_ms_F)();
+typedef void (*dgl_log_sink_F)(void *user_data, char *line, usize length);
+
+// NOTE(dgl): Longer lines are cut off.
+#ifndef DGL_LOG_LINE_SIZE
+#define DGL_LOG_LINE_SIZE 1024
+#endif
 
+DGL_DEF void dgl_log_init(dgl_time_in_ms_F time_func);
+DGL_DEF void dgl_log_init_threadsafe(dgl_time_in_ms_F time_func, dgl_lock_F lock_func);
+// NOTE(dgl): Lines go to stdout unless a sink is set. The sink gets every line including the
+// newline (not null terminated). It is called without the lock, so it has to be thread safe.
+// Set the sink before other threads log.
+DGL_DEF void dgl_log_set_sink(dgl_log_sink_F sink, void *user_data);
 void dgl__log_internal(char *file, int32 line, char *fmt, ...);
 
+// NOTE(dgl): Log file split into segments <base_path>.<index>.log of a fixed size. Every segment
+// is preallocated and mapped, writers reserve their line with an atomic add on the write offset
+// and copy it into the mapping, so a line needs no lock and no syscall. The lines stay in the
+// page cache if the process crashes. The writer that does not fit anymore creates the next
+// segment; writers behind it wait until it is there.
+// A segment starts with DGL_LOG_FILE_HEADER_SIZE bytes of header and is followed by the text
+// lines and zeros. The first byte of a line is stored last, so readers in other processes
+// see complete lines only.
+// Several log files can share a base path, their segment indices are interleaved then. Every
+// header stores the index of the first segment of its log file, so a reader can follow one of them.
+// Usage:
+//    DGL_Log_File log_file;
+//    dgl_log_file_open(&log_file, "logs/app", megabytes(16));
+//    dgl_log_set_sink(dgl_log_file_sink, &log_file);
+#define DGL_LOG_FILE_MAGIC 0x32474F4C4C4744ULL // NOTE(dgl): "DGLLOG2"
+#define DGL_LOG_FILE_HEADER_SIZE 64
+#define DGL_LOG_FILE_PATH_SIZE 256
+
+typedef struct DGL_Log_File_Header
+{
+    uint64 magic;
+    uint64 segment_index;
+    uint64 segment_size;
+    // NOTE(dgl): 0 while the segment is written, then the offset behind the last line.
+    uint64 volatile end_offset;
+    // NOTE(dgl): Same for all segments of one log file and unique on the base path.
+    uint64 first_segment_index;
+} DGL_Log_File_Header;
+
+typedef struct DGL_Log_Segment
+{
+    uint8 *base;
+    uint64 size;
+    int32 file;
+    uint64 volatile write_offset;
+    uint64 volatile writer_count;
+    // NOTE(dgl): Cleared once the segment is unmapped and the slot can be used again.
+    uint64 volatile in_use;
+} DGL_Log_Segment;
+
+typedef struct DGL_Log_File
+{
+    char base_path[DGL_LOG_FILE_PATH_SIZE];
+    uint64 segment_size;
+    uint64 next_segment_index;
+    // NOTE(dgl): -1 until the first segment is created.
+    uint64 first_segment_index;
+    // NOTE(dgl): Incremented on every rotation, the current segment is segments[generation & 1].
+    uint64 volatile generation;
+    DGL_Log_Segment segments[2];
+} DGL_Log_File;
+
+typedef struct DGL_Log_Reader
+{
+    char base_path[DGL_LOG_FILE_PATH_SIZE];
+    uint64 segment_index;
+    // NOTE(dgl): Log file that is followed, -1 until the first segment is mapped.
+    uint64 first_segment_index;
+    uint8 *base;
+    uint64 size;
+    uint64 offset;
+} DGL_Log_Reader;
+
+// NOTE(dgl): Continues with the first segment index that does not exist yet. Indices that are
+// created by somebody else in the meantime are skipped.
+DGL_DEF bool32 dgl_log_file_open(DGL_Log_File *log_file, char *base_path, uint64 segment_size);
+// NOTE(dgl): All writers have to be finished (and none may start) before the log file is closed.
+DGL_DEF void dgl_log_file_close(DGL_Log_File *log_file);
+// NOTE(dgl): The line has to end with a newline and must not start with a zero. Returns false if
+// the line was dropped because the next segment could not be created (the next line tries again).
+DGL_DEF bool32 dgl_log_file_write(DGL_Log_File *log_file, char *line, usize length);
+DGL_DEF void dgl_log_file_sink(void *log_file, char *line, usize length);
+
+// NOTE(dgl): Follows the segments of a log file from segment_index on, also while they are written.
+// Segments of other log files on the same base path are skipped.
+// dgl_log_reader_next returns the length of the next line including the newline or 0 if there is
+// no new line yet. The line stays valid until the reader moves to the next segment.
+DGL_DEF bool32 dgl_log_reader_open(DGL_Log_Reader *reader, char *base_path, uint64 segment_index);
+DGL_DEF usize dgl_log_reader_next(DGL_Log_Reader *reader, char **line);
+DGL_DEF void dgl_log_reader_close(DGL_Log_Reader *reader);
+
 #endif // DGL_NO_LOG
 
 //
@@ -296,11 +644,153 @@ void dgl__log_internal(char *file, int32 line, char *fmt, ...);
 #define DEFAULT_ALIGNMENT (2*sizeof(void *))
 #endif
 
+// NOTE(dgl): Define DGL_FAST_MEMCPY to route dgl_memcpy and dgl_memset through dgl_fast_memcpy and
+// dgl_fast_memset instead of libc, or define both macros yourself.
 #ifndef dgl_memcpy
 #include <string.h> /* memset, memcpy */
+#ifdef DGL_FAST_MEMCPY
+#define dgl_memcpy dgl_fast_memcpy
+#define dgl_memset dgl_fast_memset
+#else
 #define dgl_memcpy memcpy
 #define dgl_memset memset
 #endif
+#endif
+
+// NOTE(dgl): From this size on the copy and set loops use non temporal stores, which bypass the
+// cache. Should be around the size of the last level cache that one core gets.
+#ifndef DGL_FAST_MEMCPY_STREAM_THRESHOLD
+#define DGL_FAST_MEMCPY_STREAM_THRESHOLD megabytes(8)
+#endif
+
+DGL_DEF void dgl__fast_memcpy_large(uint8 *dest, uint8 *src, usize size);
+DGL_DEF void dgl__fast_memset_large(uint8 *dest, uint8 value, usize size);
+
+#if COMPILER_MSVC
+typedef uint16 dgl__mem_uint16;
+typedef uint32 dgl__mem_uint32;
+typedef uint64 dgl__mem_uint64;
+#else
+// NOTE(dgl): Unaligned and allowed to alias everything, so the small copies can load any bytes.
+typedef uint16 __attribute__((may_alias, aligned(1))) dgl__mem_uint16;
+typedef uint32 __attribute__((may_alias, aligned(1))) dgl__mem_uint32;
+typedef uint64 __attribute__((may_alias, aligned(1))) dgl__mem_uint64;
+#endif
+
+local_inline void
+dgl__fast_memcpy_16(uint8 *dest, uint8 *src)
+{
+#if DGL_SIMD_SSE4_1
+    _mm_storeu_si128(dgl_cast(__m128i *)dest, _mm_loadu_si128(dgl_cast(__m128i *)src));
+#else
+    uint64 low = *dgl_cast(dgl__mem_uint64 *)src;
+    uint64 high = *dgl_cast(dgl__mem_uint64 *)(src + 8);
+    *dgl_cast(dgl__mem_uint64 *)dest = low;
+    *dgl_cast(dgl__mem_uint64 *)(dest + 8) = high;
+#endif
+}
+
+// NOTE(dgl): Copies of up to 64 bytes are inlined and copy the first and the last bytes with
+// loads that overlap in the middle, so there is no loop and only a few branches on the size.
+// Everything larger goes to the SSE or AVX2 loops. Like memcpy the ranges must not overlap.
+local_inline void *
+dgl_fast_memcpy(void *dest, const void *src, usize size)
+{
+    uint8 *d = dgl_cast(uint8 *)dest;
+    uint8 *s = dgl_cast(uint8 *)src;
+    if(size > 64)
+    {
+        dgl__fast_memcpy_large(d, s, size);
+    }
+    else if(size > 32)
+    {
+        dgl__fast_memcpy_16(d, s);
+        dgl__fast_memcpy_16(d + 16, s + 16);
+        dgl__fast_memcpy_16(d + size - 32, s + size - 32);
+        dgl__fast_memcpy_16(d + size - 16, s + size - 16);
+    }
+    else if(size >= 16)
+    {
+        dgl__fast_memcpy_16(d, s);
+        dgl__fast_memcpy_16(d + size - 16, s + size - 16);
+    }
+    else if(size >= 8)
+    {
+        uint64 first = *dgl_cast(dgl__mem_uint64 *)s;
+        uint64 last = *dgl_cast(dgl__mem_uint64 *)(s + size - 8);
+        *dgl_cast(dgl__mem_uint64 *)d = first;
+        *dgl_cast(dgl__mem_uint64 *)(d + size - 8) = last;
+    }
+    else if(size >= 4)
+    {
+        uint32 first = *dgl_cast(dgl__mem_uint32 *)s;
+        uint32 last = *dgl_cast(dgl__mem_uint32 *)(s + size - 4);
+        *dgl_cast(dgl__mem_uint32 *)d = first;
+        *dgl_cast(dgl__mem_uint32 *)(d + size - 4) = last;
+    }
+    else if(size >= 2)
+    {
+        uint16 first = *dgl_cast(dgl__mem_uint16 *)s;
+        uint16 last = *dgl_cast(dgl__mem_uint16 *)(s + size - 2);
+        *dgl_cast(dgl__mem_uint16 *)d = first;
+        *dgl_cast(dgl__mem_uint16 *)(d + size - 2) = last;
+    }
+    else if(size == 1)
+    {
+        *d = *s;
+    }
+    return(dest);
+}
+
+local_inline void *
+dgl_fast_memset(void *dest, int value, usize size)
+{
+    uint8 *d = dgl_cast(uint8 *)dest;
+    uint64 pattern = 0x0101010101010101ULL * dgl_cast(uint8)value;
+    if(size > 64)
+    {
+        dgl__fast_memset_large(d, dgl_cast(uint8)value, size);
+    }
+    else if(size >= 16)
+    {
+#if DGL_SIMD_SSE4_1
+        __m128i wide = _mm_set1_epi8(dgl_cast(char)value);
+        _mm_storeu_si128(dgl_cast(__m128i *)d, wide);
+        _mm_storeu_si128(dgl_cast(__m128i *)(d + size - 16), wide);
+        if(size > 32)
+        {
+            _mm_storeu_si128(dgl_cast(__m128i *)(d + 16), wide);
+            _mm_storeu_si128(dgl_cast(__m128i *)(d + size - 32), wide);
+        }
+#else
+        for(usize index = 0; index + 8 < size; index += 8)
+        {
+            *dgl_cast(dgl__mem_uint64 *)(d + index) = pattern;
+        }
+        *dgl_cast(dgl__mem_uint64 *)(d + size - 8) = pattern;
+#endif
+    }
+    else if(size >= 8)
+    {
+        *dgl_cast(dgl__mem_uint64 *)d = pattern;
+        *dgl_cast(dgl__mem_uint64 *)(d + size - 8) = pattern;
+    }
+    else if(size >= 4)
+    {
+        *dgl_cast(dgl__mem_uint32 *)d = dgl_cast(uint32)pattern;
+        *dgl_cast(dgl__mem_uint32 *)(d + size - 4) = dgl_cast(uint32)pattern;
+    }
+    else if(size >= 2)
+    {
+        *dgl_cast(dgl__mem_uint16 *)d = dgl_cast(uint16)pattern;
+        *dgl_cast(dgl__mem_uint16 *)(d + size - 2) = dgl_cast(uint16)pattern;
+    }
+    else if(size == 1)
+    {
+        *d = dgl_cast(uint8)value;
+    }
+    return(dest);
+}
 
 typedef usize DGL_Mem_Index;
 
@@ -320,6 +810,16 @@ typedef struct DGL_Mem_Temp_Arena
     DGL_Mem_Index prev_offset;
 } DGL_Mem_Temp_Arena;
 
+// NOTE(dgl): Thread safe variant of DGL_Mem_Arena. Allocating is a single atomic add on the
+// offset. There is no resize and no temp scope, and free_all must not run concurrently with
+// allocations.
+typedef struct DGL_Mem_Atomic_Arena
+{
+    uint8 *base;
+    DGL_Mem_Index size;
+    uint64 volatile curr_offset;
+} DGL_Mem_Atomic_Arena;
+
 typedef struct DGL_Mem_Pool_Free_Node DGL_Mem_Pool_Free_Node;
 struct DGL_Mem_Pool_Free_Node
 {
@@ -340,6 +840,10 @@ DGL_DEF void dgl_mem_arena_init(DGL_Mem_Arena *arena, uint8 *base, DGL_Mem_Index
 #define dgl_mem_arena_push_array(arena, type, count) (type *)dgl_mem_arena_alloc_align(arena, (count)*sizeof(type), DEFAULT_ALIGNMENT)
 #define dgl_mem_arena_push(arena, size) dgl_mem_arena_alloc_align(arena, size, DEFAULT_ALIGNMENT)
 DGL_DEF void * dgl_mem_arena_alloc_align(DGL_Mem_Arena *arena, DGL_Mem_Index size, DGL_Mem_Index align);
+// NOTE(dgl): Same as the push functions above, but the memory is not zeroed. Use it for buffers
+// that are completely overwritten anyway.
+#define dgl_mem_arena_push_array_no_zero(arena, type, count) (type *)dgl_mem_arena_alloc_align_no_zero(arena, (count)*sizeof(type), DEFAULT_ALIGNMENT)
+DGL_DEF void * dgl_mem_arena_alloc_align_no_zero(DGL_Mem_Arena *arena, DGL_Mem_Index size, DGL_Mem_Index align);
 #define dgl_mem_arena_resize_array(arena, type, current_base, current_size, new_size) (type *) dgl_mem_arena_resize_align(arena, dgl_cast(uint8 *)(current_base), (current_size)*sizeof(type), (new_size)*sizeof(type), DEFAULT_ALIGNMENT)
 #define dgl_mem_arena_resize(arena, current_base, current_size, new_size) dgl_mem_arena_resize_align(arena, current_base, current_size, new_size, DEFAULT_ALIGNMENT)
 DGL_DEF void * dgl_mem_arena_resize_align(DGL_Mem_Arena *arena, uint8 *current_base, DGL_Mem_Index current_size, DGL_Mem_Index new_size, usize align);
@@ -347,473 +851,5307 @@ DGL_DEF void dgl_mem_arena_free_all(DGL_Mem_Arena *arena);
 DGL_DEF DGL_Mem_Temp_Arena dgl_mem_arena_begin_temp(DGL_Mem_Arena *arena);
 DGL_DEF void dgl_mem_arena_end_temp(DGL_Mem_Temp_Arena temp);
 
+// NOTE(dgl): Per thread scratch arenas for temporary memory, so functions do not need an arena
+// parameter just to call dgl_mem_arena_begin_temp. Every thread calls dgl_mem_scratch_thread_init
+// once with its own backing memory, which is split into DGL_MEM_SCRATCH_ARENA_COUNT arenas.
+// Pass every arena the caller allocates persistent results from as conflict. The returned scratch
+// arena is never one of them, so temporary allocations cannot overlap the results.
+// Usage:
+//    DGL_Mem_Temp_Arena scratch = dgl_mem_scratch_begin(&output_arena, 1);
+//    ...allocate from scratch.arena...
+//    dgl_mem_scratch_end(scratch);
+#ifndef DGL_MEM_SCRATCH_ARENA_COUNT
+#define DGL_MEM_SCRATCH_ARENA_COUNT 2
+#endif
+
+DGL_DEF void dgl_mem_scratch_thread_init(uint8 *base, DGL_Mem_Index size);
+DGL_DEF DGL_Mem_Arena * dgl_mem_get_scratch(DGL_Mem_Arena **conflicts, uint32 conflict_count);
+DGL_DEF DGL_Mem_Temp_Arena dgl_mem_scratch_begin(DGL_Mem_Arena **conflicts, uint32 conflict_count);
+#define dgl_mem_scratch_end(temp) dgl_mem_arena_end_temp(temp)
+
+// NOTE(dgl): Pool variant that tracks used chunks in a bitmap in front of the chunks instead of a
+// free list inside them. Allocation takes the lowest free chunk, which keeps the live chunks
+// packed at the start. Live chunks can be iterated in address order and released in bulk.
+typedef struct DGL_Mem_Bitmap_Pool
+{
+    uint8 *base;
+    DGL_Mem_Index chunk_size;
+    DGL_Mem_Index chunk_count;
+    uint64 *occupied;
+    DGL_Mem_Index word_count;
+    // NOTE(dgl): All words before this one are full.
+    DGL_Mem_Index first_free_word;
+    DGL_Mem_Index live_count;
+} DGL_Mem_Bitmap_Pool;
+
+typedef struct DGL_Mem_Bitmap_Pool_Iter
+{
+    DGL_Mem_Bitmap_Pool *pool;
+    DGL_Mem_Index word_index;
+    uint64 word;
+} DGL_Mem_Bitmap_Pool_Iter;
+
+typedef void (*dgl_mem_pool_visit_F)(void *chunk, void *user_data);
+
+DGL_DEF void dgl_mem_atomic_arena_init(DGL_Mem_Atomic_Arena *arena, uint8 *base, DGL_Mem_Index size);
+#define dgl_mem_atomic_arena_push_struct(arena, type) (type *)dgl_mem_atomic_arena_alloc_align(arena, sizeof(type), DEFAULT_ALIGNMENT)
+#define dgl_mem_atomic_arena_push_array(arena, type, count) (type *)dgl_mem_atomic_arena_alloc_align(arena, (count)*sizeof(type), DEFAULT_ALIGNMENT)
+#define dgl_mem_atomic_arena_push(arena, size) dgl_mem_atomic_arena_alloc_align(arena, size, DEFAULT_ALIGNMENT)
+// NOTE(dgl): Returns 0 once the arena is full (from then on every allocation fails).
+DGL_DEF void * dgl_mem_atomic_arena_alloc_align(DGL_Mem_Atomic_Arena *arena, DGL_Mem_Index size, usize align);
+DGL_DEF void dgl_mem_atomic_arena_free_all(DGL_Mem_Atomic_Arena *arena);
+// NOTE(dgl): Allocates from a thread owned block (a normal arena) and only touches the shared
+// offset to get a new block of block_size bytes. Allocations larger than half a block go directly
+// to the shared arena. The rest of an exhausted block is wasted. Returns 0 if the shared arena has
+// no block left.
+#define dgl_mem_atomic_arena_push_struct_local(arena, local, type) (type *)dgl_mem_atomic_arena_alloc_local(arena, local, sizeof(type), DEFAULT_ALIGNMENT)
+#define dgl_mem_atomic_arena_push_array_local(arena, local, type, count) (type *)dgl_mem_atomic_arena_alloc_local(arena, local, (count)*sizeof(type), DEFAULT_ALIGNMENT)
+DGL_DEF void * dgl_mem_atomic_arena_alloc_local(DGL_Mem_Atomic_Arena *arena, DGL_Mem_Arena *local, DGL_Mem_Index size, usize align);
+
+#ifndef DGL_MEM_ATOMIC_ARENA_BLOCK_SIZE
+#define DGL_MEM_ATOMIC_ARENA_BLOCK_SIZE kilobytes(64)
+#endif
+
 #define dgl_mem_pool_init_struct(arena, base, size, type) dgl_mem_pool_init_align(arena, base, size, sizeof(type), DEFAULT_ALIGNMENT)
 #define dgl_mem_pool_init(arena, base, size, chunk_size) dgl_mem_pool_init_align(arena, base, size, chunk_size, DEFAULT_ALIGNMENT)
 DGL_DEF void dgl_mem_pool_init_align(DGL_Mem_Pool *arena, uint8 *base, DGL_Mem_Index size, DGL_Mem_Index chunk_size, DGL_Mem_Index chunk_alignment);
 DGL_DEF void dgl_mem_pool_free_all(DGL_Mem_Pool *arena);
 #define dgl_mem_pool_push(arena, type) (type *)dgl__mem_pool_alloc_internal(arena)
 DGL_DEF void * dgl__mem_pool_alloc_internal(DGL_Mem_Pool *arena);
-#define dgl_mem_pool_release(arena, ptr) dgl__mem_pool_free_internal(arena)
+#define dgl_mem_pool_release(arena, ptr) dgl__mem_pool_free_internal(arena, ptr)
 DGL_DEF void dgl__mem_pool_free_internal(DGL_Mem_Pool *arena, void *ptr);
 #define dgl_mem_pool_push_threadsafe(arena, type) (type *)dgl__mem_pool_alloc_threadsafe_internal(arena)
 DGL_DEF void * dgl__mem_pool_alloc_threadsafe_internal(DGL_Mem_Pool *arena);
 #define dgl_mem_pool_release_threadsafe(arena, ptr) dgl__mem_pool_free_threadsafe_internal(arena, ptr)
 DGL_DEF void dgl__mem_pool_free_threadsafe_internal(DGL_Mem_Pool *arena, void *ptr);
 
-#endif // DGL_NO_MEMORY
-
-//
-// String
-//
-
-#ifndef DGL_NO_STRING
+#define dgl_mem_bitmap_pool_init_struct(pool, base, size, type) dgl_mem_bitmap_pool_init_align(pool, base, size, sizeof(type), DEFAULT_ALIGNMENT)
+#define dgl_mem_bitmap_pool_init(pool, base, size, chunk_size) dgl_mem_bitmap_pool_init_align(pool, base, size, chunk_size, DEFAULT_ALIGNMENT)
+DGL_DEF void dgl_mem_bitmap_pool_init_align(DGL_Mem_Bitmap_Pool *pool, uint8 *base, DGL_Mem_Index size, DGL_Mem_Index chunk_size, DGL_Mem_Index chunk_alignment);
+DGL_DEF void dgl_mem_bitmap_pool_free_all(DGL_Mem_Bitmap_Pool *pool);
+// NOTE(dgl): Returns 0 if the pool is full.
+#define dgl_mem_bitmap_pool_push(pool, type) (type *)dgl_mem_bitmap_pool_alloc(pool)
+DGL_DEF void * dgl_mem_bitmap_pool_alloc(DGL_Mem_Bitmap_Pool *pool);
+DGL_DEF void dgl_mem_bitmap_pool_release(DGL_Mem_Bitmap_Pool *pool, void *ptr);
+// NOTE(dgl): Releases every chunk whose bit is set in mask (bit i of mask[w] is chunk w*64 + i).
+DGL_DEF void dgl_mem_bitmap_pool_release_mask(DGL_Mem_Bitmap_Pool *pool, uint64 *mask, DGL_Mem_Index word_count);
+DGL_DEF void dgl_mem_bitmap_pool_for_each_live(DGL_Mem_Bitmap_Pool *pool, dgl_mem_pool_visit_F visit, void *user_data);
+
+local_inline DGL_Mem_Index
+dgl_mem_bitmap_pool_index_of(DGL_Mem_Bitmap_Pool *pool, void *ptr)
+{
+    DGL_Mem_Index result = dgl_cast(DGL_Mem_Index)(dgl_cast(uint8 *)ptr - pool->base) / pool->chunk_size;
+    return(result);
+}
 
-#include <stdarg.h>
+// NOTE(dgl): Usage:
+//    DGL_Mem_Bitmap_Pool_Iter iter = dgl_mem_bitmap_pool_iter(&pool);
+//    for(Entity *entity; (entity = (Entity *)dgl_mem_bitmap_pool_iter_next(&iter));) { ... }
+// Releasing the current chunk while iterating is fine, allocating is not.
+local_inline DGL_Mem_Bitmap_Pool_Iter
+dgl_mem_bitmap_pool_iter(DGL_Mem_Bitmap_Pool *pool)
+{
+    DGL_Mem_Bitmap_Pool_Iter result;
+    result.pool = pool;
+    result.word_index = 0;
+    result.word = pool->word_count > 0 ? pool->occupied[0] : 0;
+    return(result);
+}
 
-typedef struct DGL_String_Builder
+local_inline void *
+dgl_mem_bitmap_pool_iter_next(DGL_Mem_Bitmap_Pool_Iter *iter)
 {
-    DGL_Mem_Arena *arena;
-    usize capacity;
-    usize count;
-    union
+    void *result = 0;
+    while(!iter->word && iter->word_index + 1 < iter->pool->word_count)
     {
-       uint8 *data;
-       char *string;
-    };
-} DGL_String_Builder;
+        iter->word = iter->pool->occupied[++iter->word_index];
+    }
 
-DGL_DEF inline usize
-dgl_string_length(char *string)
-{
-    usize count = 0;
-    if(string)
+    if(iter->word)
     {
-        while(*string++) { ++count; }
+        DGL_Mem_Index index = iter->word_index * 64 + dgl_count_trailing_zeros_uint64(iter->word);
+        iter->word &= iter->word - 1;
+        result = iter->pool->base + index * iter->pool->chunk_size;
     }
-    return(count);
+    return(result);
 }
 
-DGL_DEF DGL_String_Builder dgl_string_builder_init(DGL_Mem_Arena *arena, usize capacity);
-#define dgl_string_append(builder, fmt, ...) dgl__string_append_internal(builder, fmt, ## __VA_ARGS__)
-DGL_DEF void dgl__string_append_internal(DGL_String_Builder *builder, char *fmt, ...);
-DGL_DEF char * dgl_string_c_style(DGL_String_Builder *builder);
+// NOTE(dgl): Pool that hands out 32 bit handles instead of pointers. A handle packs the chunk
+// index and the generation of the chunk. Releasing a chunk bumps its generation, so old handles
+// resolve to 0 instead of a recycled chunk. The generation 0 is never handed out, which makes
+// the handle 0 the null handle. Generations wrap around after 2^DGL_MEM_HANDLE_GENERATION_BITS - 1
+// releases of the same chunk.
+#ifndef DGL_MEM_HANDLE_INDEX_BITS
+#define DGL_MEM_HANDLE_INDEX_BITS 20
+#endif
+#define DGL_MEM_HANDLE_GENERATION_BITS (32 - DGL_MEM_HANDLE_INDEX_BITS)
+#define DGL_MEM_HANDLE_INDEX_MASK ((1U << DGL_MEM_HANDLE_INDEX_BITS) - 1)
+#define DGL_MEM_HANDLE_GENERATION_MASK ((1U << DGL_MEM_HANDLE_GENERATION_BITS) - 1)
+// NOTE(dgl): The slot state is the generation and this flag if the chunk is live, so resolving a
+// handle is a single compare.
+#define DGL_MEM_HANDLE_SLOT_LIVE 0x8000
+
+#if DGL_MEM_HANDLE_GENERATION_BITS > 15
+#error "DGL_MEM_HANDLE_INDEX_BITS is too small, the generation must fit into 15 bits"
+#endif
 
-#endif // DGL_NO_STRING
+typedef uint32 DGL_Mem_Handle;
 
-#ifdef __cplusplus
+typedef struct DGL_Mem_Handle_Pool
+{
+    DGL_Mem_Pool pool;
+    uint16 *slots;
+    DGL_Mem_Index chunk_count;
+    DGL_Mem_Index live_count;
+} DGL_Mem_Handle_Pool;
+
+#define dgl_mem_handle_pool_init_struct(pool, base, size, type) dgl_mem_handle_pool_init_align(pool, base, size, sizeof(type), DEFAULT_ALIGNMENT)
+#define dgl_mem_handle_pool_init(pool, base, size, chunk_size) dgl_mem_handle_pool_init_align(pool, base, size, chunk_size, DEFAULT_ALIGNMENT)
+DGL_DEF void dgl_mem_handle_pool_init_align(DGL_Mem_Handle_Pool *pool, uint8 *base, DGL_Mem_Index size, DGL_Mem_Index chunk_size, DGL_Mem_Index chunk_alignment);
+DGL_DEF void dgl_mem_handle_pool_free_all(DGL_Mem_Handle_Pool *pool);
+// NOTE(dgl): Returns 0 if the pool is full.
+DGL_DEF DGL_Mem_Handle dgl_mem_handle_pool_alloc(DGL_Mem_Handle_Pool *pool);
+// NOTE(dgl): Returns false if the handle is stale, releasing twice is harmless.
+DGL_DEF bool32 dgl_mem_handle_pool_release(DGL_Mem_Handle_Pool *pool, DGL_Mem_Handle handle);
+DGL_DEF DGL_Mem_Handle dgl_mem_handle_pool_handle_of(DGL_Mem_Handle_Pool *pool, void *ptr);
+#define dgl_mem_handle_pool_get(pool, handle, type) (type *)dgl_mem_handle_pool_resolve(pool, handle)
+
+local_inline DGL_Mem_Handle
+dgl_mem_handle_make(DGL_Mem_Index index, uint32 generation)
+{
+    DGL_Mem_Handle result = (generation << DGL_MEM_HANDLE_INDEX_BITS) | (dgl_cast(uint32)index & DGL_MEM_HANDLE_INDEX_MASK);
+    return(result);
 }
-#endif
 
-#endif // DGL_H
-
-//_------------------------------------------------------------------------------------------------
-//
-// IMPLEMENTATION
-//
-//-------------------------------------------------------------------------------------------------
-#ifdef DGL_IMPLEMENTATION
+local_inline uint32
+dgl_mem_handle_index(DGL_Mem_Handle handle)
+{
+    uint32 result = handle & DGL_MEM_HANDLE_INDEX_MASK;
+    return(result);
+}
 
-//
-// Log
-//
-#ifndef DGL_NO_LOG
+local_inline uint32
+dgl_mem_handle_generation(DGL_Mem_Handle handle)
+{
+    uint32 result = handle >> DGL_MEM_HANDLE_INDEX_BITS;
+    return(result);
+}
 
-global struct DGL_Logger
+// NOTE(dgl): Returns 0 for the null handle and for stale handles.
+local_inline void *
+dgl_mem_handle_pool_resolve(DGL_Mem_Handle_Pool *pool, DGL_Mem_Handle handle)
 {
-    dgl_lock_F lock;
+    void *result = 0;
+    DGL_Mem_Index index = dgl_mem_handle_index(handle);
+    uint32 expected = DGL_MEM_HANDLE_SLOT_LIVE | dgl_mem_handle_generation(handle);
+    if(index < pool->chunk_count && pool->slots[index] == expected)
+    {
+        result = pool->pool.base + index * pool->pool.chunk_size;
+    }
+    return(result);
+}
+
+// NOTE(dgl): Epoch based reclamation for chunks that lock free readers may still be looking at.
+// Readers wrap every access in dgl_epoch_enter/dgl_epoch_exit. Writers unlink a chunk and retire
+// it instead of releasing it. Retired chunks are kept in per thread lists and released to their
+// pool in batches once every thread that is inside a critical section has seen a newer epoch
+// (two epochs after the retire). Usage:
+//    dgl_epoch_thread_register(&epoch, &thread, memory, memory_size); // once per thread
+//    dgl_epoch_enter(&thread);
+//    Node *node = (Node *)dgl_atomic_load_uintptr(&shared);
+//    ...read node...
+//    dgl_epoch_exit(&thread);
+//    ...
+//    dgl_epoch_retire(&thread, old_node, &pool);
+// The thread that retires a chunk also releases it, with the non thread safe pool functions. So
+// the pool has to belong to the retiring thread (or be guarded by the caller).
+// Registered threads are never removed. A thread that is done calls dgl_epoch_thread_end, which
+// reclaims what it can and keeps the record from blocking the others.
+#ifndef DGL_EPOCH_BLOCK_CAPACITY
+#define DGL_EPOCH_BLOCK_CAPACITY 64
+#endif
+// NOTE(dgl): dgl_epoch_retire tries to reclaim once this many chunks are waiting.
+#ifndef DGL_EPOCH_RECLAIM_THRESHOLD
+#define DGL_EPOCH_RECLAIM_THRESHOLD 128
+#endif
+#define DGL_EPOCH_BAG_COUNT 3
+
+typedef struct DGL_Epoch_Retired
+{
+    void *ptr;
+    DGL_Mem_Pool *pool;
+} DGL_Epoch_Retired;
+
+typedef struct DGL_Epoch_Block DGL_Epoch_Block;
+struct DGL_Epoch_Block
+{
+    DGL_Epoch_Block *next;
+    uint32 count;
+    DGL_Epoch_Retired items[DGL_EPOCH_BLOCK_CAPACITY];
+};
+
+typedef struct DGL_Epoch DGL_Epoch;
+typedef struct DGL_Epoch_Thread DGL_Epoch_Thread;
+struct DGL_Epoch_Thread
+{
+    // NOTE(dgl): The announced epoch shifted left by one with the lowest bit set while the thread
+    // is inside a critical section, 0 otherwise. Written by the owner, read by everyone.
+    uint64 volatile announced;
+    uint32 nesting;
+    DGL_Epoch *epoch;
+    DGL_Mem_Arena arena;
+    DGL_Epoch_Block *bags[DGL_EPOCH_BAG_COUNT];
+    uint64 bag_epochs[DGL_EPOCH_BAG_COUNT];
+    DGL_Epoch_Block *free_blocks;
+    usize retired_count;
+    DGL_Epoch_Thread *next;
+};
+
+struct DGL_Epoch
+{
+    uint64 volatile global_epoch;
+    DGL_Epoch_Thread * volatile first_thread;
+};
+
+DGL_DEF void dgl_epoch_init(DGL_Epoch *epoch);
+// NOTE(dgl): base/size is the memory for the retire lists of this thread.
+DGL_DEF void dgl_epoch_thread_register(DGL_Epoch *epoch, DGL_Epoch_Thread *thread, uint8 *base, DGL_Mem_Index size);
+DGL_DEF void dgl_epoch_thread_end(DGL_Epoch_Thread *thread);
+// NOTE(dgl): Returns false if the retire list memory is exhausted even after reclaiming. The
+// chunk is leaked in that case.
+DGL_DEF bool32 dgl_epoch_retire(DGL_Epoch_Thread *thread, void *ptr, DGL_Mem_Pool *pool);
+// NOTE(dgl): Advances the global epoch if possible and releases the retired chunks of this thread
+// that are safe. Returns the number of released chunks.
+DGL_DEF usize dgl_epoch_collect(DGL_Epoch_Thread *thread);
+DGL_DEF bool32 dgl_epoch_try_advance(DGL_Epoch *epoch);
+
+// NOTE(dgl): Critical sections nest. Entering costs one exchange (a full barrier), exiting a
+// release store. Announcing a stale epoch is fine, it only delays the next advance.
+local_inline void
+dgl_epoch_enter(DGL_Epoch_Thread *thread)
+{
+    if(thread->nesting++ == 0)
+    {
+        uint64 global_epoch = dgl_atomic_load_uint64(&thread->epoch->global_epoch);
+        dgl_atomic_exchange_uint64(&thread->announced, (global_epoch << 1) | 1);
+    }
+}
+
+local_inline void
+dgl_epoch_exit(DGL_Epoch_Thread *thread)
+{
+    dgl_assert(thread->nesting > 0, "Exit without enter");
+    if(--thread->nesting == 0)
+    {
+        dgl_atomic_store_uint64(&thread->announced, 0);
+    }
+}
+
+// NOTE(dgl): Self relative pointers store the distance to the target instead of its address, so
+// they stay valid when the memory that contains them is mapped at another address (e.g. arena
+// images). An offset of 0 is the null pointer.
+typedef int64 DGL_Rel_Ptr;
+#define dgl_rel_ptr_get(type, rel_ptr) ((type *)dgl__rel_ptr_get(&(rel_ptr)))
+#define dgl_rel_ptr_set(rel_ptr, target) dgl__rel_ptr_set(&(rel_ptr), target)
+
+local_inline void *
+dgl__rel_ptr_get(DGL_Rel_Ptr *rel_ptr)
+{
+    void *result = *rel_ptr ? dgl_cast(void *)(dgl_cast(uint8 *)rel_ptr + *rel_ptr) : 0;
+    return(result);
+}
+
+local_inline void
+dgl__rel_ptr_set(DGL_Rel_Ptr *rel_ptr, void *target)
+{
+    *rel_ptr = target ? dgl_cast(DGL_Rel_Ptr)(dgl_cast(uint8 *)target - dgl_cast(uint8 *)rel_ptr) : 0;
+}
+
+// NOTE(dgl): Arena relative offsets, e.g. to find the root structures in a loaded image.
+#define dgl_mem_arena_offset_of(arena, ptr) (dgl_cast(DGL_Mem_Index)(dgl_cast(uint8 *)(ptr) - (arena)->base))
+#define dgl_mem_arena_at(arena, type, offset) ((type *)((arena)->base + (offset)))
+
+// NOTE(dgl): An arena image is the used part of an arena written to a file behind a header of
+// DGL_MEM_ARENA_IMAGE_HEADER_SIZE bytes. 64KB is a multiple of every common page size (4KB, 16KB
+// on Apple Silicon, 64KB on some arm64 linux), so the data can be mapped directly.
+// Loading maps the file copy on write into a new reservation of the original arena size, so the
+// structures are usable without deserialization and the arena can keep allocating. Everything in
+// the image has to use offsets or DGL_Rel_Ptr instead of pointers. Allocations are aligned relative
+// to the arena base, so the base of the saved arena has to be aligned to the largest alignment used.
+// Verifying the checksum reads the whole image, which defeats lazy loading for large images.
+// On windows the used part is read into new memory instead of mapped.
+// The checksum needs the Hash module, so images are not available with DGL_NO_HASH.
+#ifndef DGL_NO_HASH
+#define DGL_MEM_ARENA_IMAGE_MAGIC 0x4D494C44 // 'DLIM'
+#define DGL_MEM_ARENA_IMAGE_VERSION 2
+#define DGL_MEM_ARENA_IMAGE_HEADER_SIZE kilobytes(64)
+
+typedef struct DGL_Mem_Arena_Image_Header
+{
+    uint32 magic;
+    uint32 version;
+    uint64 header_size;
+    uint64 used_size;
+    uint64 arena_size;
+    uint64 checksum;
+} DGL_Mem_Arena_Image_Header;
+
+DGL_DEF bool32 dgl_mem_arena_save_image(DGL_Mem_Arena *arena, char *path);
+DGL_DEF bool32 dgl_mem_arena_load_image(DGL_Mem_Arena *arena, char *path, bool32 verify_checksum);
+DGL_DEF void dgl_mem_arena_unload_image(DGL_Mem_Arena *arena);
+#endif // DGL_NO_HASH
+
+#endif // DGL_NO_MEMORY
+
+//
+// String
+//
+
+#ifndef DGL_NO_STRING
+
+#include <stdarg.h>
+
+typedef struct DGL_String_Builder
+{
+    DGL_Mem_Arena *arena;
+    usize capacity;
+    usize count;
+    union
+    {
+       uint8 *data;
+       char *string;
+    };
+} DGL_String_Builder;
+
+DGL_DEF inline usize
+dgl_string_length(char *string)
+{
+    usize count = 0;
+    if(string)
+    {
+        while(*string++) { ++count; }
+    }
+    return(count);
+}
+
+DGL_DEF DGL_String_Builder dgl_string_builder_init(DGL_Mem_Arena *arena, usize capacity);
+#define dgl_string_append(builder, fmt, ...) dgl__string_append_internal(builder, fmt, ## __VA_ARGS__)
+DGL_DEF void dgl__string_append_internal(DGL_String_Builder *builder, char *fmt, ...);
+DGL_DEF char * dgl_string_c_style(DGL_String_Builder *builder);
+
+// NOTE(dgl): UTF-8 validation follows the Unicode rules (no overlong forms, no surrogates, nothing
+// above U+10FFFF). It checks 16 (AVX2: 32) bytes at once with the lookup algorithm of Keiser and
+// Lemire and skips blocks that are pure ASCII. dgl_utf8_validate_scalar is the byte at a time
+// reference.
+// The transcoding functions return 0 for invalid input. The output is allocated from the arena
+// (worst case first, then shrunk in place), null terminated and the terminator is not counted.
+// ASCII blocks are widened/narrowed with SIMD, everything else goes through the scalar codec.
+DGL_DEF bool32 dgl_utf8_validate(uint8 *data, usize size);
+DGL_DEF bool32 dgl_utf8_validate_scalar(uint8 *data, usize size);
+// NOTE(dgl): Expects valid UTF-8.
+DGL_DEF usize dgl_utf8_count_code_points(uint8 *data, usize size);
+DGL_DEF uint16 * dgl_utf8_to_utf16(DGL_Mem_Arena *arena, uint8 *data, usize size, usize *count);
+DGL_DEF uint32 * dgl_utf8_to_utf32(DGL_Mem_Arena *arena, uint8 *data, usize size, usize *count);
+DGL_DEF uint8 * dgl_utf16_to_utf8(DGL_Mem_Arena *arena, uint16 *data, usize count, usize *size);
+DGL_DEF uint8 * dgl_utf32_to_utf8(DGL_Mem_Arena *arena, uint32 *data, usize count, usize *size);
+
+#endif // DGL_NO_STRING
+
+//
+// Hash
+//
+
+#ifndef DGL_NO_HASH
+
+// NOTE(dgl): Fast non cryptographic hashes for hash tables, interning and deduplication. Do not use
+// them where an attacker controls the keys.
+// dgl_hash_bytes returns the same value on every machine (wyhash style). dgl_hash_bytes_fast uses
+// AES-NI for keys longer than 128 bytes if the cpu supports it, so its values differ between
+// machines. Only use it for in memory data that is never persisted.
+// The streaming interface (begin/update/end) returns the same value as dgl_hash_bytes.
+
+typedef struct DGL_Hash_State
+{
+    uint64 seed;
+    uint64 see1;
+    uint64 see2;
+    uint64 total_size;
+    usize buffer_count;
+    bool32 processed_blocks;
+    // NOTE(dgl): The first 16 bytes keep the end of the last processed block, because the final
+    // read may reach back into it. Pending input starts at offset 16.
+    uint8 buffer[16 + 48];
+} DGL_Hash_State;
+
+// NOTE(dgl): Bijective integer mixers for fixed size keys.
+DGL_DEF inline uint64
+dgl_hash_uint64(uint64 value)
+{
+    uint64 result = value;
+    result ^= result >> 30;
+    result *= 0xBF58476D1CE4E5B9ULL;
+    result ^= result >> 27;
+    result *= 0x94D049BB133111EBULL;
+    result ^= result >> 31;
+    return(result);
+}
+
+DGL_DEF inline uint32
+dgl_hash_uint32(uint32 value)
+{
+    uint32 result = value;
+    result ^= result >> 16;
+    result *= 0x7FEB352DU;
+    result ^= result >> 15;
+    result *= 0x846CA68BU;
+    result ^= result >> 16;
+    return(result);
+}
+
+DGL_DEF uint64 dgl_hash_bytes(void *data, usize size, uint64 seed);
+DGL_DEF uint64 dgl_hash_bytes_aes(void *data, usize size, uint64 seed);
+DGL_DEF uint64 dgl_hash_bytes_fast(void *data, usize size, uint64 seed);
+DGL_DEF void dgl_hash_begin(DGL_Hash_State *state, uint64 seed);
+DGL_DEF void dgl_hash_update(DGL_Hash_State *state, void *data, usize size);
+DGL_DEF uint64 dgl_hash_end(DGL_Hash_State *state);
+
+#endif // DGL_NO_HASH
+
+//
+// Intern
+//
+
+// NOTE(dgl): The interner hashes with dgl_hash_bytes.
+#if defined(DGL_NO_HASH) && !defined(DGL_NO_INTERN)
+#define DGL_NO_INTERN
+#endif
+
+#ifndef DGL_NO_INTERN
+
+// NOTE(dgl): Stores every unique string once (null terminated) in an arena and hands out ids, so
+// comparing interned strings is a single integer compare. Ids start at 1 and are dense, 0 is the
+// invalid id. The canonical pointer of an id never moves.
+// The lookup table is a swiss style open addressing table: one control byte per slot (7 bits of
+// the hash or DGL__INTERN_EMPTY) and 16 control bytes are compared at once with SSE2. Growing
+// allocates a new table from the arena and leaves the old one behind, so reserve enough up front
+// (e.g. with dgl_intern_bulk) if the arena memory is tight.
+// The shared variant splits the ids over DGL_INTERN_SHARD_COUNT tables, each with its own arena
+// and spinlock.
+typedef uint32 DGL_Intern_Id;
+
+typedef struct DGL_Intern_Entry
+{
+    char *string;
+    usize length;
+    uint64 hash;
+} DGL_Intern_Entry;
+
+typedef struct DGL_Intern_Table
+{
+    DGL_Mem_Arena *arena;
+    // NOTE(dgl): capacity + 16 control bytes. The last 16 mirror the first ones, so a group can be
+    // loaded at any slot without wrapping.
+    uint8 *control;
+    DGL_Intern_Id *slots;
+    usize capacity;
+    DGL_Intern_Entry *entries;
+    usize count;
+    usize entry_capacity;
+} DGL_Intern_Table;
+
+// NOTE(dgl): Shared ids are (id in the shard << DGL_INTERN_SHARD_BITS) | shard, so every shard
+// holds at most DGL_INTERN_SHARD_ID_MAX strings (2^29 with the default 3 bits).
+#ifndef DGL_INTERN_SHARD_BITS
+#define DGL_INTERN_SHARD_BITS 3
+#endif
+#define DGL_INTERN_SHARD_COUNT (1 << DGL_INTERN_SHARD_BITS)
+#define DGL_INTERN_SHARD_ID_MAX (0xFFFFFFFFu >> DGL_INTERN_SHARD_BITS)
+
+typedef struct DGL_Intern_Shared
+{
+    DGL_Intern_Table shards[DGL_INTERN_SHARD_COUNT];
+    DGL_Mem_Arena arenas[DGL_INTERN_SHARD_COUNT];
+    uint32 volatile locks[DGL_INTERN_SHARD_COUNT];
+} DGL_Intern_Shared;
+
+DGL_DEF void dgl_intern_init(DGL_Intern_Table *table, DGL_Mem_Arena *arena, usize initial_count);
+DGL_DEF DGL_Intern_Id dgl_intern(DGL_Intern_Table *table, char *string, usize length);
+#define dgl_intern_cstring(table, string) dgl_intern(table, string, dgl_string_length(string))
+// NOTE(dgl): Returns 0 if the string was never interned.
+DGL_DEF DGL_Intern_Id dgl_intern_find(DGL_Intern_Table *table, char *string, usize length);
+// NOTE(dgl): Interns count strings and writes their ids to ids. The table grows at most once.
+// lengths can be 0 for null terminated strings.
+DGL_DEF void dgl_intern_bulk(DGL_Intern_Table *table, char **strings, usize *lengths, usize count, DGL_Intern_Id *ids);
+
+DGL_DEF inline char *
+dgl_intern_string(DGL_Intern_Table *table, DGL_Intern_Id id)
+{
+    dgl_assert(id > 0 && id <= table->count, "Invalid intern id");
+    char *result = table->entries[id - 1].string;
+    return(result);
+}
+
+DGL_DEF inline usize
+dgl_intern_length(DGL_Intern_Table *table, DGL_Intern_Id id)
+{
+    dgl_assert(id > 0 && id <= table->count, "Invalid intern id");
+    usize result = table->entries[id - 1].length;
+    return(result);
+}
+
+// NOTE(dgl): The memory is split evenly between the shards.
+DGL_DEF void dgl_intern_shared_init(DGL_Intern_Shared *shared, uint8 *base, usize size, usize initial_count);
+DGL_DEF DGL_Intern_Id dgl_intern_shared(DGL_Intern_Shared *shared, char *string, usize length);
+DGL_DEF DGL_Intern_Id dgl_intern_shared_find(DGL_Intern_Shared *shared, char *string, usize length);
+DGL_DEF void dgl_intern_shared_bulk(DGL_Intern_Shared *shared, char **strings, usize *lengths, usize count, DGL_Intern_Id *ids);
+// NOTE(dgl): The returned pointer stays valid, only the lookup takes the lock.
+DGL_DEF char * dgl_intern_shared_string(DGL_Intern_Shared *shared, DGL_Intern_Id id);
+
+#endif // DGL_NO_INTERN
+
+//
+// Bitset
+//
+
+#ifndef DGL_NO_BITSET
+
+// NOTE(dgl): Fixed size bitset from an arena. The words are padded to a multiple of four (32 bytes)
+// and the bits after bit_count are always zero, so the whole set functions work on full blocks.
+// Whole set functions use SSE4.1 and switch to AVX2 at runtime, population counts use the pshufb
+// nibble lookup. The set algebra returns the number of bits set in the result. The result can be
+// one of the inputs and all sets need the same bit_count.
+// Functions that search return bit_count if nothing is found.
+typedef struct DGL_Bitset
+{
+    uint64 *words;
+    usize word_count;
+    usize bit_count;
+} DGL_Bitset;
+
+typedef struct DGL_Bitset_Iter
+{
+    DGL_Bitset *bitset;
+    usize word_index;
+    uint64 word;
+} DGL_Bitset_Iter;
+
+DGL_DEF DGL_Bitset dgl_bitset_init(DGL_Mem_Arena *arena, usize bit_count);
+DGL_DEF void dgl_bitset_clear_all(DGL_Bitset *bitset);
+DGL_DEF void dgl_bitset_set_all(DGL_Bitset *bitset);
+DGL_DEF usize dgl_bitset_count(DGL_Bitset *bitset);
+// NOTE(dgl): Number of set bits before index.
+DGL_DEF usize dgl_bitset_rank(DGL_Bitset *bitset, usize index);
+// NOTE(dgl): Index of the set bit with the given rank (starting at 0).
+DGL_DEF usize dgl_bitset_select(DGL_Bitset *bitset, usize rank);
+DGL_DEF usize dgl_bitset_find_next_set(DGL_Bitset *bitset, usize from);
+DGL_DEF usize dgl_bitset_find_next_unset(DGL_Bitset *bitset, usize from);
+DGL_DEF usize dgl_bitset_and(DGL_Bitset *dest, DGL_Bitset *a, DGL_Bitset *b);
+DGL_DEF usize dgl_bitset_or(DGL_Bitset *dest, DGL_Bitset *a, DGL_Bitset *b);
+DGL_DEF usize dgl_bitset_xor(DGL_Bitset *dest, DGL_Bitset *a, DGL_Bitset *b);
+// NOTE(dgl): dest = a & ~b
+DGL_DEF usize dgl_bitset_andnot(DGL_Bitset *dest, DGL_Bitset *a, DGL_Bitset *b);
+
+local_inline void
+dgl_bitset_set(DGL_Bitset *bitset, usize index)
+{
+    dgl_assert(index < bitset->bit_count, "Bit index out of range");
+    bitset->words[index / 64] |= 1ULL << (index % 64);
+}
+
+local_inline void
+dgl_bitset_clear(DGL_Bitset *bitset, usize index)
+{
+    dgl_assert(index < bitset->bit_count, "Bit index out of range");
+    bitset->words[index / 64] &= ~(1ULL << (index % 64));
+}
+
+local_inline bool32
+dgl_bitset_test(DGL_Bitset *bitset, usize index)
+{
+    dgl_assert(index < bitset->bit_count, "Bit index out of range");
+    bool32 result = (bitset->words[index / 64] >> (index % 64)) & 1;
+    return(result);
+}
+
+// NOTE(dgl): Usage:
+//    DGL_Bitset_Iter iter = dgl_bitset_iter(&bitset);
+//    for(usize index; dgl_bitset_iter_next(&iter, &index);) { ... }
+local_inline DGL_Bitset_Iter
+dgl_bitset_iter(DGL_Bitset *bitset)
+{
+    DGL_Bitset_Iter result;
+    result.bitset = bitset;
+    result.word_index = 0;
+    result.word = bitset->word_count > 0 ? bitset->words[0] : 0;
+    return(result);
+}
+
+local_inline bool32
+dgl_bitset_iter_next(DGL_Bitset_Iter *iter, usize *index)
+{
+    while(!iter->word && iter->word_index + 1 < iter->bitset->word_count)
+    {
+        iter->word = iter->bitset->words[++iter->word_index];
+    }
+
+    bool32 result = iter->word != 0;
+    if(result)
+    {
+        *index = iter->word_index * 64 + dgl_count_trailing_zeros_uint64(iter->word);
+        iter->word &= iter->word - 1;
+    }
+    return(result);
+}
+
+#endif // DGL_NO_BITSET
+
+//
+// Sort
+//
+
+#ifndef DGL_NO_SORT
+
+// NOTE(dgl): LSD radix sort (8 bit digits) for 32 and 64 bit keys. The sort is stable and all
+// temporary memory comes from a temp region of the scratch arena (about the size of the input).
+// Passes in which all keys share the same digit are skipped, which helps with skewed keys.
+// Inputs with up to DGL_SORT_INSERTION_THRESHOLD elements use an insertion sort instead.
+// Signed and floating point keys are mapped to unsigned keys with the same order (negative zero
+// sorts before zero, NaNs sort to the ends depending on their sign bit).
+
+#ifndef DGL_SORT_INSERTION_THRESHOLD
+#define DGL_SORT_INSERTION_THRESHOLD 64
+#endif
+
+#ifndef DGL_SORT_PARALLEL_THRESHOLD
+#define DGL_SORT_PARALLEL_THRESHOLD 65536
+#endif
+
+// NOTE(dgl): The parallel sort does not create threads. The dispatch function has to call
+// task(task_data[i]) for every i < task_count (e.g. on a thread pool) and return once all of them
+// are done.
+typedef void (*dgl_sort_task_F)(void *data);
+typedef void (*dgl_sort_dispatch_F)(dgl_sort_task_F task, void **task_data, uint32 task_count);
+
+DGL_DEF void dgl_sort_uint32(uint32 *keys, usize count, DGL_Mem_Arena *scratch);
+DGL_DEF void dgl_sort_int32(int32 *keys, usize count, DGL_Mem_Arena *scratch);
+DGL_DEF void dgl_sort_real32(real32 *keys, usize count, DGL_Mem_Arena *scratch);
+DGL_DEF void dgl_sort_uint64(uint64 *keys, usize count, DGL_Mem_Arena *scratch);
+DGL_DEF void dgl_sort_int64(int64 *keys, usize count, DGL_Mem_Arena *scratch);
+DGL_DEF void dgl_sort_real64(real64 *keys, usize count, DGL_Mem_Arena *scratch);
+
+// NOTE(dgl): Key-value variants move values[i] together with keys[i].
+DGL_DEF void dgl_sort_uint32_kv(uint32 *keys, uint32 *values, usize count, DGL_Mem_Arena *scratch);
+DGL_DEF void dgl_sort_int32_kv(int32 *keys, uint32 *values, usize count, DGL_Mem_Arena *scratch);
+DGL_DEF void dgl_sort_real32_kv(real32 *keys, uint32 *values, usize count, DGL_Mem_Arena *scratch);
+DGL_DEF void dgl_sort_uint64_kv(uint64 *keys, uint64 *values, usize count, DGL_Mem_Arena *scratch);
+DGL_DEF void dgl_sort_int64_kv(int64 *keys, uint64 *values, usize count, DGL_Mem_Arena *scratch);
+DGL_DEF void dgl_sort_real64_kv(real64 *keys, uint64 *values, usize count, DGL_Mem_Arena *scratch);
+
+DGL_DEF void dgl_sort_uint32_parallel(uint32 *keys, usize count, DGL_Mem_Arena *scratch, uint32 task_count, dgl_sort_dispatch_F dispatch);
+DGL_DEF void dgl_sort_uint64_parallel(uint64 *keys, usize count, DGL_Mem_Arena *scratch, uint32 task_count, dgl_sort_dispatch_F dispatch);
+
+#endif // DGL_NO_SORT
+
+//
+// Profiler
+//
+
+#ifndef DGL_NO_PROFILER
+
+// NOTE(dgl): Timed blocks record enter/exit events with the cpu timer into a per thread ring buffer.
+// Recording does not lock and does not allocate. Every thread that should be profiled has to call
+// dgl_profiler_thread_begin with its own event storage (power of two count). If the ring buffer
+// wraps, the oldest events are overwritten.
+// Thread records stay in the global thread list after dgl_profiler_thread_end, so finished threads
+// can still be exported. The record and its events need static (or program) lifetime and the
+// record has to be zero initialized. Beginning a registered record again continues recording
+// into it.
+// The markers compile to nothing unless DGL_PROFILE is set, so they can stay in the hot loops.
+// Usage:
+//    {
+//        DGL_TIMED_BLOCK("update");
+//        ...
+//    }
+
+#ifndef DGL_PROFILE
+#define DGL_PROFILE 0
+#endif
+
+#ifndef DGL_PROFILE_MAX_DEPTH
+#define DGL_PROFILE_MAX_DEPTH 64
+#endif
+
+#define DGL_PROFILE_EVENT_BEGIN 0
+#define DGL_PROFILE_EVENT_END 1
+
+typedef struct DGL_Profile_Event
+{
+    uint64 cpu_time;
+    char *name;
+    uint32 type;
+} DGL_Profile_Event;
+
+typedef struct DGL_Profile_Thread DGL_Profile_Thread;
+struct DGL_Profile_Thread
+{
+    DGL_Profile_Event *events;
+    uint64 event_mask;
+    // NOTE(dgl): Total number of recorded events. Only the owning thread writes to it.
+    uint64 write_index;
+    uint32 id;
+    char *name;
+    // NOTE(dgl): Set once the record is in the global thread list.
+    bool32 registered;
+    DGL_Profile_Thread *next;
+};
+
+typedef struct DGL_Profile_Node DGL_Profile_Node;
+struct DGL_Profile_Node
+{
+    char *name;
+    uint64 hit_count;
+    uint64 inclusive_cycles;
+    uint64 self_cycles;
+    DGL_Profile_Node *parent;
+    DGL_Profile_Node *first_child;
+    DGL_Profile_Node *next_sibling;
+};
+
+typedef struct DGL_Profile_Scope
+{
+    char *name;
+} DGL_Profile_Scope;
+
+extern dgl_thread_local DGL_Profile_Thread *dgl__profile_thread;
+
+local_inline void
+dgl__profile_record(char *name, uint32 type)
+{
+    DGL_Profile_Thread *thread = dgl__profile_thread;
+    if(thread)
+    {
+        DGL_Profile_Event *event = thread->events + (thread->write_index & thread->event_mask);
+        event->cpu_time = dgl_read_cpu_timer();
+        event->name = name;
+        event->type = type;
+        ++thread->write_index;
+    }
+}
+
+local_inline DGL_Profile_Scope
+dgl__profile_scope_begin(char *name)
+{
+    DGL_Profile_Scope result;
+    result.name = name;
+    dgl__profile_record(name, DGL_PROFILE_EVENT_BEGIN);
+    return(result);
+}
+
+local_inline void
+dgl__profile_scope_end(DGL_Profile_Scope *scope)
+{
+    dgl__profile_record(scope->name, DGL_PROFILE_EVENT_END);
+}
+
+#if DGL_PROFILE
+#define dgl__profile_concat_internal(a, b) a##b
+#define dgl__profile_concat(a, b) dgl__profile_concat_internal(a, b)
+#ifdef __cplusplus
+struct DGL_Profile_Scope_Guard
+{
+    DGL_Profile_Scope scope;
+    DGL_Profile_Scope_Guard(char *name) { scope = dgl__profile_scope_begin(name); }
+    ~DGL_Profile_Scope_Guard() { dgl__profile_scope_end(&scope); }
+};
+#define DGL_TIMED_BLOCK(name) DGL_Profile_Scope_Guard dgl__profile_concat(dgl__timed_block_, __LINE__)(dgl_cast(char *)(name))
+#elif COMPILER_MSVC
+// NOTE(dgl): MSVC C has no cleanup attribute. Using a timed block fails to compile with this
+// array name, use DGL_TIMED_BEGIN/DGL_TIMED_END instead.
+#define DGL_TIMED_BLOCK(name) typedef char DGL_TIMED_BLOCK_needs_cplusplus_use_DGL_TIMED_BEGIN_and_DGL_TIMED_END[-1]
+#else
+#define DGL_TIMED_BLOCK(name) DGL_Profile_Scope dgl__profile_concat(dgl__timed_block_, __LINE__) __attribute__((cleanup(dgl__profile_scope_end))) = dgl__profile_scope_begin(dgl_cast(char *)(name))
+#endif
+#define DGL_TIMED_FUNCTION() DGL_TIMED_BLOCK(__func__)
+#define DGL_TIMED_BEGIN(name) dgl__profile_record(dgl_cast(char *)(name), DGL_PROFILE_EVENT_BEGIN)
+#define DGL_TIMED_END(name) dgl__profile_record(dgl_cast(char *)(name), DGL_PROFILE_EVENT_END)
+#else
+#define DGL_TIMED_BLOCK(name)
+#define DGL_TIMED_FUNCTION()
+#define DGL_TIMED_BEGIN(name)
+#define DGL_TIMED_END(name)
+#endif
+
+DGL_DEF void dgl_profiler_thread_begin(DGL_Profile_Thread *thread, DGL_Profile_Event *events, uint32 event_count, char *name);
+DGL_DEF void dgl_profiler_thread_end(void);
+DGL_DEF DGL_Profile_Thread * dgl_profiler_threads(void);
+DGL_DEF uint64 dgl_profiler_estimate_cpu_timer_frequency(uint32 milliseconds_to_wait);
+DGL_DEF DGL_Profile_Node * dgl_profiler_build_tree(DGL_Mem_Arena *arena, DGL_Profile_Thread *thread);
+DGL_DEF void dgl_profiler_export_chrome_trace(DGL_String_Builder *builder, uint64 cpu_timer_frequency);
+
+#endif // DGL_NO_PROFILER
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DGL_H
+
+//_------------------------------------------------------------------------------------------------
+//
+// IMPLEMENTATION
+//
+//-------------------------------------------------------------------------------------------------
+#ifdef DGL_IMPLEMENTATION
+
+//
+// Intrinsics
+//
+#ifndef DGL_NO_INTRINSICS
+
+global uint32 volatile dgl__cpu_feature_flags;
+
+DGL_DEF uint32
+dgl_cpu_features(void)
+{
+    uint32 result = dgl__cpu_feature_flags;
+    if(!(result & DGL_CPU_FEATURE_INITIALIZED))
+    {
+        // NOTE(dgl): Racing threads all compute the same flags, so no synchronization is needed.
+        result = DGL_CPU_FEATURE_INITIALIZED;
+#if COMPILER_LLVM
+        __builtin_cpu_init();
+        if(__builtin_cpu_supports("sse4.1")) { result |= DGL_CPU_FEATURE_SSE4_1; }
+        if(__builtin_cpu_supports("avx2")) { result |= DGL_CPU_FEATURE_AVX2; }
+        if(__builtin_cpu_supports("aes")) { result |= DGL_CPU_FEATURE_AES; }
+#elif COMPILER_MSVC
+        // NOTE(dgl): Leaf 1 ecx: SSE4.1 bit 19, AES bit 25, OSXSAVE bit 27. The OS has to save the
+        // ymm registers (XCR0 bits 1 and 2) before AVX2 (leaf 7 ebx bit 5) can be used.
+        int32 info[4];
+        __cpuid(info, 1);
+        bool32 os_saves_ymm = (info[2] & (1 << 27)) && ((_xgetbv(0) & 6) == 6);
+        if(info[2] & (1 << 19)) { result |= DGL_CPU_FEATURE_SSE4_1; }
+        if(info[2] & (1 << 25)) { result |= DGL_CPU_FEATURE_AES; }
+        __cpuidex(info, 7, 0);
+        if(os_saves_ymm && (info[1] & (1 << 5))) { result |= DGL_CPU_FEATURE_AVX2; }
+        dgl_assert(!DGL_SIMD_SSE4_1 || (result & DGL_CPU_FEATURE_SSE4_1), "The cpu does not support SSE4.1, define DGL_NO_SIMD");
+#endif
+        dgl__cpu_feature_flags = result;
+    }
+    return(result);
+}
+
+#if DGL_SIMD_SSE4_1
+// NOTE(dgl): _mm_round_ps rounds halfway cases to even, roundf rounds them away from zero. We
+// truncate and add one in the direction of the sign if the (exact) fraction is at least one half.
+local_inline __m128
+dgl__round_ps(__m128 value)
+{
+    __m128 sign_mask = _mm_set1_ps(-0.0f);
+    __m128 truncated = _mm_round_ps(value, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+    __m128 fraction = _mm_andnot_ps(sign_mask, _mm_sub_ps(value, truncated));
+    __m128 round_up = _mm_cmpge_ps(fraction, _mm_set1_ps(0.5f));
+    __m128 one = _mm_or_ps(_mm_set1_ps(1.0f), _mm_and_ps(value, sign_mask));
+    __m128 result = _mm_add_ps(truncated, _mm_and_ps(round_up, one));
+    return(result);
+}
+
+DGL_TARGET_AVX2 local_inline __m256
+dgl__round_ps_avx2(__m256 value)
+{
+    __m256 sign_mask = _mm256_set1_ps(-0.0f);
+    __m256 truncated = _mm256_round_ps(value, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+    __m256 fraction = _mm256_andnot_ps(sign_mask, _mm256_sub_ps(value, truncated));
+    __m256 round_up = _mm256_cmp_ps(fraction, _mm256_set1_ps(0.5f), _CMP_GE_OQ);
+    __m256 one = _mm256_or_ps(_mm256_set1_ps(1.0f), _mm256_and_ps(value, sign_mask));
+    __m256 result = _mm256_add_ps(truncated, _mm256_and_ps(round_up, one));
+    return(result);
+}
+
+// NOTE(dgl): cvttps returns 0x80000000 for values >= 2^31. For unsigned results we convert the
+// upper half with 2^31 subtracted and set the top bit again.
+local_inline __m128i
+dgl__convert_ps_to_epu32(__m128 value)
+{
+    __m128 two_pow_31 = _mm_set1_ps(2147483648.0f);
+    __m128 is_large = _mm_cmpge_ps(value, two_pow_31);
+    __m128 lowered = _mm_sub_ps(value, _mm_and_ps(is_large, two_pow_31));
+    __m128i result = _mm_xor_si128(_mm_cvttps_epi32(lowered), _mm_slli_epi32(_mm_castps_si128(is_large), 31));
+    return(result);
+}
+
+DGL_TARGET_AVX2 local_inline __m256i
+dgl__convert_ps_to_epu32_avx2(__m256 value)
+{
+    __m256 two_pow_31 = _mm256_set1_ps(2147483648.0f);
+    __m256 is_large = _mm256_cmp_ps(value, two_pow_31, _CMP_GE_OQ);
+    __m256 lowered = _mm256_sub_ps(value, _mm256_and_ps(is_large, two_pow_31));
+    __m256i result = _mm256_xor_si256(_mm256_cvttps_epi32(lowered), _mm256_slli_epi32(_mm256_castps_si256(is_large), 31));
+    return(result);
+}
+
+local_inline __m128i
+dgl__clamp_convert_ps_to_epi32(__m128 rounded, __m128i min, __m128i max)
+{
+    // NOTE(dgl): cvttps returns 0x80000000 for values >= 2^31, flipping all bits saturates them.
+    __m128i is_large = _mm_castps_si128(_mm_cmpge_ps(rounded, _mm_set1_ps(2147483648.0f)));
+    __m128i converted = _mm_cvttps_epi32(rounded);
+    converted = _mm_xor_si128(converted, is_large);
+    __m128i result = _mm_min_epi32(_mm_max_epi32(converted, min), max);
+    return(result);
+}
+
+DGL_TARGET_AVX2 local_inline __m256i
+dgl__clamp_convert_ps_to_epi32_avx2(__m256 rounded, __m256i min, __m256i max)
+{
+    __m256i is_large = _mm256_castps_si256(_mm256_cmp_ps(rounded, _mm256_set1_ps(2147483648.0f), _CMP_GE_OQ));
+    __m256i converted = _mm256_cvttps_epi32(rounded);
+    converted = _mm256_xor_si256(converted, is_large);
+    __m256i result = _mm256_min_epi32(_mm256_max_epi32(converted, min), max);
+    return(result);
+}
+
+// NOTE(dgl): The avx2 kernels process blocks of 8 (or 32) values and return how many values they
+// converted. The rest is done by the sse and scalar loops.
+DGL_TARGET_AVX2 internal usize
+dgl__round_real32_to_int32_avx2(int32 *dest, real32 *source, usize count)
+{
+    usize index = 0;
+    for(; index + 8 <= count; index += 8)
+    {
+        __m256 rounded = dgl__round_ps_avx2(_mm256_loadu_ps(source + index));
+        _mm256_storeu_si256(dgl_cast(__m256i *)(dest + index), _mm256_cvttps_epi32(rounded));
+    }
+    return(index);
+}
+
+DGL_TARGET_AVX2 internal usize
+dgl__round_real32_to_uint32_avx2(uint32 *dest, real32 *source, usize count)
+{
+    usize index = 0;
+    for(; index + 8 <= count; index += 8)
+    {
+        __m256 rounded = dgl__round_ps_avx2(_mm256_loadu_ps(source + index));
+        _mm256_storeu_si256(dgl_cast(__m256i *)(dest + index), dgl__convert_ps_to_epu32_avx2(rounded));
+    }
+    return(index);
+}
+
+DGL_TARGET_AVX2 internal usize
+dgl__truncate_real32_to_int32_avx2(int32 *dest, real32 *source, usize count)
+{
+    usize index = 0;
+    for(; index + 8 <= count; index += 8)
+    {
+        _mm256_storeu_si256(dgl_cast(__m256i *)(dest + index), _mm256_cvttps_epi32(_mm256_loadu_ps(source + index)));
+    }
+    return(index);
+}
+
+DGL_TARGET_AVX2 internal usize
+dgl__clamp_round_real32_to_int32_avx2(int32 *dest, real32 *source, usize count, int32 min, int32 max)
+{
+    __m256i min_wide = _mm256_set1_epi32(min);
+    __m256i max_wide = _mm256_set1_epi32(max);
+    usize index = 0;
+    for(; index + 8 <= count; index += 8)
+    {
+        __m256 rounded = dgl__round_ps_avx2(_mm256_loadu_ps(source + index));
+        _mm256_storeu_si256(dgl_cast(__m256i *)(dest + index), dgl__clamp_convert_ps_to_epi32_avx2(rounded, min_wide, max_wide));
+    }
+    return(index);
+}
+
+DGL_TARGET_AVX2 internal usize
+dgl__round_real32_to_int16_avx2(int16 *dest, real32 *source, usize count)
+{
+    __m256 lo = _mm256_set1_ps(-32768.0f);
+    __m256 hi = _mm256_set1_ps(32767.0f);
+    usize index = 0;
+    for(; index + 16 <= count; index += 16)
+    {
+        __m256 a = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(source + index), lo), hi);
+        __m256 b = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(source + index + 8), lo), hi);
+        __m256i packed = _mm256_packs_epi32(_mm256_cvttps_epi32(dgl__round_ps_avx2(a)),
+                                            _mm256_cvttps_epi32(dgl__round_ps_avx2(b)));
+        // NOTE(dgl): pack works per 128 bit lane, restore the order of the 64 bit blocks.
+        packed = _mm256_permute4x64_epi64(packed, 0xD8);
+        _mm256_storeu_si256(dgl_cast(__m256i *)(dest + index), packed);
+    }
+    return(index);
+}
+
+DGL_TARGET_AVX2 internal usize
+dgl__round_real32_to_uint8_avx2(uint8 *dest, real32 *source, usize count)
+{
+    __m256 lo = _mm256_set1_ps(0.0f);
+    __m256 hi = _mm256_set1_ps(255.0f);
+    usize index = 0;
+    for(; index + 32 <= count; index += 32)
+    {
+        __m256i v[4];
+        for(int32 part = 0; part < 4; ++part)
+        {
+            __m256 value = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(source + index + 8*part), lo), hi);
+            v[part] = _mm256_cvttps_epi32(dgl__round_ps_avx2(value));
+        }
+        __m256i packed = _mm256_packus_epi16(_mm256_packus_epi32(v[0], v[1]), _mm256_packus_epi32(v[2], v[3]));
+        // NOTE(dgl): pack works per 128 bit lane, restore the order of the 32 bit blocks.
+        packed = _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+        _mm256_storeu_si256(dgl_cast(__m256i *)(dest + index), packed);
+    }
+    return(index);
+}
+
+DGL_TARGET_AVX2 internal usize
+dgl__int16_to_real32_avx2(real32 *dest, int16 *source, usize count)
+{
+    usize index = 0;
+    for(; index + 8 <= count; index += 8)
+    {
+        __m256i wide = _mm256_cvtepi16_epi32(_mm_loadu_si128(dgl_cast(__m128i *)(source + index)));
+        _mm256_storeu_ps(dest + index, _mm256_cvtepi32_ps(wide));
+    }
+    return(index);
+}
+
+DGL_TARGET_AVX2 internal usize
+dgl__uint8_to_real32_avx2(real32 *dest, uint8 *source, usize count)
+{
+    usize index = 0;
+    for(; index + 8 <= count; index += 8)
+    {
+        __m256i wide = _mm256_cvtepu8_epi32(_mm_loadl_epi64(dgl_cast(__m128i *)(source + index)));
+        _mm256_storeu_ps(dest + index, _mm256_cvtepi32_ps(wide));
+    }
+    return(index);
+}
+#endif // DGL_SIMD_SSE4_1
+
+DGL_DEF void
+dgl_round_real32_to_int32_array(int32 *dest, real32 *source, usize count)
+{
+    usize index = 0;
+#if DGL_SIMD_SSE4_1
+    if(dgl_cpu_features() & DGL_CPU_FEATURE_AVX2)
+    {
+        index = dgl__round_real32_to_int32_avx2(dest, source, count);
+    }
+    for(; index + 4 <= count; index += 4)
+    {
+        __m128 rounded = dgl__round_ps(_mm_loadu_ps(source + index));
+        _mm_storeu_si128(dgl_cast(__m128i *)(dest + index), _mm_cvttps_epi32(rounded));
+    }
+#endif
+    for(; index < count; ++index)
+    {
+        dest[index] = dgl_round_real32_to_int32(source[index]);
+    }
+}
+
+DGL_DEF void
+dgl_round_real32_to_uint32_array(uint32 *dest, real32 *source, usize count)
+{
+    usize index = 0;
+#if DGL_SIMD_SSE4_1
+    if(dgl_cpu_features() & DGL_CPU_FEATURE_AVX2)
+    {
+        index = dgl__round_real32_to_uint32_avx2(dest, source, count);
+    }
+    for(; index + 4 <= count; index += 4)
+    {
+        __m128 rounded = dgl__round_ps(_mm_loadu_ps(source + index));
+        _mm_storeu_si128(dgl_cast(__m128i *)(dest + index), dgl__convert_ps_to_epu32(rounded));
+    }
+#endif
+    for(; index < count; ++index)
+    {
+        dest[index] = dgl_round_real32_to_uint32(source[index]);
+    }
+}
+
+DGL_DEF void
+dgl_truncate_real32_to_int32_array(int32 *dest, real32 *source, usize count)
+{
+    usize index = 0;
+#if DGL_SIMD_SSE4_1
+    if(dgl_cpu_features() & DGL_CPU_FEATURE_AVX2)
+    {
+        index = dgl__truncate_real32_to_int32_avx2(dest, source, count);
+    }
+    for(; index + 4 <= count; index += 4)
+    {
+        _mm_storeu_si128(dgl_cast(__m128i *)(dest + index), _mm_cvttps_epi32(_mm_loadu_ps(source + index)));
+    }
+#endif
+    for(; index < count; ++index)
+    {
+        dest[index] = dgl_truncate_real32_to_int32(source[index]);
+    }
+}
+
+DGL_DEF void
+dgl_clamp_round_real32_to_int32_array(int32 *dest, real32 *source, usize count, int32 min, int32 max)
+{
+    usize index = 0;
+#if DGL_SIMD_SSE4_1
+    if(dgl_cpu_features() & DGL_CPU_FEATURE_AVX2)
+    {
+        index = dgl__clamp_round_real32_to_int32_avx2(dest, source, count, min, max);
+    }
+    __m128i min_wide = _mm_set1_epi32(min);
+    __m128i max_wide = _mm_set1_epi32(max);
+    for(; index + 4 <= count; index += 4)
+    {
+        __m128 rounded = dgl__round_ps(_mm_loadu_ps(source + index));
+        _mm_storeu_si128(dgl_cast(__m128i *)(dest + index), dgl__clamp_convert_ps_to_epi32(rounded, min_wide, max_wide));
+    }
+#endif
+    for(; index < count; ++index)
+    {
+        dest[index] = dgl_clamp_round_real32_to_int32(source[index], min, max);
+    }
+}
+
+DGL_DEF void
+dgl_round_real32_to_int16_array(int16 *dest, real32 *source, usize count)
+{
+    usize index = 0;
+#if DGL_SIMD_SSE4_1
+    if(dgl_cpu_features() & DGL_CPU_FEATURE_AVX2)
+    {
+        index = dgl__round_real32_to_int16_avx2(dest, source, count);
+    }
+    __m128 lo = _mm_set1_ps(-32768.0f);
+    __m128 hi = _mm_set1_ps(32767.0f);
+    for(; index + 8 <= count; index += 8)
+    {
+        __m128 a = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(source + index), lo), hi);
+        __m128 b = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(source + index + 4), lo), hi);
+        __m128i packed = _mm_packs_epi32(_mm_cvttps_epi32(dgl__round_ps(a)), _mm_cvttps_epi32(dgl__round_ps(b)));
+        _mm_storeu_si128(dgl_cast(__m128i *)(dest + index), packed);
+    }
+#endif
+    for(; index < count; ++index)
+    {
+        dest[index] = dgl_round_real32_to_int16(source[index]);
+    }
+}
+
+DGL_DEF void
+dgl_round_real32_to_uint8_array(uint8 *dest, real32 *source, usize count)
+{
+    usize index = 0;
+#if DGL_SIMD_SSE4_1
+    if(dgl_cpu_features() & DGL_CPU_FEATURE_AVX2)
+    {
+        index = dgl__round_real32_to_uint8_avx2(dest, source, count);
+    }
+    __m128 lo = _mm_set1_ps(0.0f);
+    __m128 hi = _mm_set1_ps(255.0f);
+    for(; index + 16 <= count; index += 16)
+    {
+        __m128i v[4];
+        for(int32 part = 0; part < 4; ++part)
+        {
+            __m128 value = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(source + index + 4*part), lo), hi);
+            v[part] = _mm_cvttps_epi32(dgl__round_ps(value));
+        }
+        __m128i packed = _mm_packus_epi16(_mm_packus_epi32(v[0], v[1]), _mm_packus_epi32(v[2], v[3]));
+        _mm_storeu_si128(dgl_cast(__m128i *)(dest + index), packed);
+    }
+#endif
+    for(; index < count; ++index)
+    {
+        dest[index] = dgl_round_real32_to_uint8(source[index]);
+    }
+}
+
+DGL_DEF void
+dgl_int16_to_real32_array(real32 *dest, int16 *source, usize count)
+{
+    usize index = 0;
+#if DGL_SIMD_SSE4_1
+    if(dgl_cpu_features() & DGL_CPU_FEATURE_AVX2)
+    {
+        index = dgl__int16_to_real32_avx2(dest, source, count);
+    }
+    for(; index + 4 <= count; index += 4)
+    {
+        __m128i wide = _mm_cvtepi16_epi32(_mm_loadl_epi64(dgl_cast(__m128i *)(source + index)));
+        _mm_storeu_ps(dest + index, _mm_cvtepi32_ps(wide));
+    }
+#endif
+    for(; index < count; ++index)
+    {
+        dest[index] = dgl_cast(real32)source[index];
+    }
+}
+
+DGL_DEF void
+dgl_uint8_to_real32_array(real32 *dest, uint8 *source, usize count)
+{
+    usize index = 0;
+#if DGL_SIMD_SSE4_1
+    if(dgl_cpu_features() & DGL_CPU_FEATURE_AVX2)
+    {
+        index = dgl__uint8_to_real32_avx2(dest, source, count);
+    }
+    for(; index + 16 <= count; index += 16)
+    {
+        __m128i bytes = _mm_loadu_si128(dgl_cast(__m128i *)(source + index));
+        _mm_storeu_ps(dest + index, _mm_cvtepi32_ps(_mm_cvtepu8_epi32(bytes)));
+        _mm_storeu_ps(dest + index + 4, _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(bytes, 4))));
+        _mm_storeu_ps(dest + index + 8, _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(bytes, 8))));
+        _mm_storeu_ps(dest + index + 12, _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(bytes, 12))));
+    }
+#endif
+    for(; index < count; ++index)
+    {
+        dest[index] = dgl_cast(real32)source[index];
+    }
+}
+
+#endif // DGL_NO_INTRINSICS
+
+//
+// Log
+//
+#ifndef DGL_NO_LOG
+
+global struct DGL_Logger
+{
+    dgl_lock_F lock;
     dgl_time_in_ms_F get_time;
+    dgl_log_sink_F sink;
+    void *sink_data;
     bool32 initialized;
 } dgl_logger;
 
 DGL_DEF void
-dgl_log_init_threadsafe(dgl_time_in_ms_F time_func, dgl_lock_F lock_func)
+dgl_log_init_threadsafe(dgl_time_in_ms_F time_func, dgl_lock_F lock_func)
+{
+    dgl_logger.get_time = time_func;
+    dgl_logger.lock = lock_func;
+    dgl_logger.initialized = true;
+}
+
+DGL_DEF void
+dgl_log_init(dgl_time_in_ms_F time_func)
+{
+    dgl_log_init_threadsafe(time_func, 0);
+}
+
+DGL_DEF void
+dgl_log_set_sink(dgl_log_sink_F sink, void *user_data)
+{
+    dgl_logger.sink = sink;
+    dgl_logger.sink_data = user_data;
+}
+
+DGL_DEF void
+dgl__lock()
+{
+  if (dgl_logger.lock) { dgl_logger.lock(true); }
+}
+
+DGL_DEF void
+dgl__unlock()
+{
+    if (dgl_logger.lock) { dgl_logger.lock(false); }
+}
+
+void
+dgl__log_internal(char *file, int32 line, char *fmt, ...)
+{
+    if(dgl_logger.initialized)
+    {
+       dgl_assert(dgl_logger.get_time, "time_in_ms must be a valid function");
+       int64 milliseconds = dgl_logger.get_time();
+       int32 seconds = dgl_cast(int32)(milliseconds / 1000);
+       milliseconds = milliseconds % 1000;
+       int32 minutes = seconds / 60;
+       seconds = seconds % 60;
+       int32 hours = minutes / 60;
+       minutes = minutes % 60;
+
+       // NOTE(dgl): The line is formatted on the stack first, so a sink gets it in one piece.
+       // The text is clamped to size - 1 bytes, the last byte is for the newline.
+       char buffer[DGL_LOG_LINE_SIZE];
+       usize size = sizeof(buffer);
+       int32 written;
+       if(file)
+       {
+           written = snprintf(buffer, size, "%02d:%02d:%02d.%04lld %s:%d: ", hours, minutes, seconds, milliseconds, file, line);
+       }
+       else
+       {
+           written = snprintf(buffer, size, "%02d:%02d:%02d.%04lld: ", hours, minutes, seconds, milliseconds);
+       }
+       usize length = dgl_min(dgl_cast(usize)dgl_max(written, 0), size - 1);
+
+       va_list ap;
+       va_start(ap, fmt);
+       written = vsnprintf(buffer + length, size - length, fmt, ap);
+       va_end(ap);
+       length = dgl_min(length + dgl_cast(usize)dgl_max(written, 0), size - 1);
+       buffer[length++] = '\n';
+
+       if(dgl_logger.sink)
+       {
+           dgl_logger.sink(dgl_logger.sink_data, buffer, length);
+       }
+       else
+       {
+           dgl__lock();
+           fwrite(buffer, 1, length, stdout);
+           fflush(stdout);
+           dgl__unlock();
+       }
+    }
+    else
+    {
+       //fprintf(stdout, "Failed to write log at %s:%d (Logger must be initialized)\n", file, line);
+    }
+
+}
+
+#include <string.h> // memcpy, memchr
+#if DGL_OS_UNIX || DGL_OS_OSX
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sched.h>
+#elif DGL_OS_WINDOWS
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h> // CreateFileMappingA, MapViewOfFile, SwitchToThread
+#endif
+
+// NOTE(dgl): Waiting on a rotation spins DGL__LOG_SPIN_COUNT times and then yields the core, so
+// a waiter does not burn its time slice while the rotating thread is preempted.
+#define DGL__LOG_SPIN_COUNT 64
+
+internal void
+dgl__log_backoff(uint32 *spins)
+{
+    if(*spins < DGL__LOG_SPIN_COUNT)
+    {
+        _mm_pause();
+        ++*spins;
+    }
+    else
+    {
+#if DGL_OS_UNIX || DGL_OS_OSX
+        sched_yield();
+#elif DGL_OS_WINDOWS
+        SwitchToThread();
+#endif
+    }
+}
+
+internal void
+dgl__log_unmap(void *base, usize size)
+{
+#if DGL_OS_UNIX || DGL_OS_OSX
+    munmap(base, size);
+#elif DGL_OS_WINDOWS
+    UnmapViewOfFile(base);
+#endif
+}
+
+internal void
+dgl__log_file_path(char *path, usize size, char *base_path, uint64 segment_index)
+{
+    snprintf(path, size, "%s.%06llu.log", base_path, dgl_cast(unsigned long long)segment_index);
+}
+
+// NOTE(dgl): Creates, preallocates and maps the next segment. Indices that already exist (e.g.
+// from another log file on the same path) are skipped. On failure the segment has no memory and
+// size 0, so the first writer into it tries to create it again.
+internal bool32
+dgl__log_segment_create(DGL_Log_File *log_file, DGL_Log_Segment *segment)
+{
+    bool32 result = false;
+    segment->base = 0;
+    segment->size = 0;
+    segment->file = -1;
+    segment->write_offset = 0;
+
+    char path[DGL_LOG_FILE_PATH_SIZE + 32];
+    void *base = 0;
+    int32 segment_file = -1;
+#if DGL_OS_UNIX || DGL_OS_OSX
+    int file = -1;
+    for(;;)
+    {
+        dgl__log_file_path(path, sizeof(path), log_file->base_path, log_file->next_segment_index);
+        file = open(path, O_RDWR | O_CREAT | O_EXCL, 0644);
+        if(file >= 0 || errno != EEXIST) { break; }
+        ++log_file->next_segment_index;
+    }
+
+    if(file >= 0)
+    {
+        // NOTE(dgl): Allocate the blocks up front. Writing to a sparse mapping on a full disk
+        // would raise SIGBUS instead of failing here.
+#if DGL_OS_UNIX
+        bool32 allocated = posix_fallocate(file, 0, dgl_cast(off_t)log_file->segment_size) == 0;
+#else
+        bool32 allocated = ftruncate(file, dgl_cast(off_t)log_file->segment_size) == 0;
+#endif
+        void *memory = MAP_FAILED;
+        if(allocated)
+        {
+            memory = mmap(0, log_file->segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+        }
+
+        if(memory != MAP_FAILED)
+        {
+            base = memory;
+            segment_file = file;
+        }
+        else
+        {
+            close(file);
+            unlink(path);
+        }
+    }
+#elif DGL_OS_WINDOWS
+    HANDLE file = INVALID_HANDLE_VALUE;
+    for(;;)
+    {
+        dgl__log_file_path(path, sizeof(path), log_file->base_path, log_file->next_segment_index);
+        file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, 0, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, 0);
+        if(file != INVALID_HANDLE_VALUE || GetLastError() != ERROR_FILE_EXISTS) { break; }
+        ++log_file->next_segment_index;
+    }
+
+    if(file != INVALID_HANDLE_VALUE)
+    {
+        // NOTE(dgl): Creating the mapping extends the file to the segment size (zero filled) and
+        // fails if the disk is full. The view keeps the file and the mapping alive.
+        HANDLE mapping = CreateFileMappingA(file, 0, PAGE_READWRITE, dgl_cast(DWORD)(log_file->segment_size >> 32),
+                                            dgl_cast(DWORD)log_file->segment_size, 0);
+        if(mapping)
+        {
+            base = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, dgl_cast(SIZE_T)log_file->segment_size);
+            CloseHandle(mapping);
+        }
+        CloseHandle(file);
+
+        if(!base) { DeleteFileA(path); }
+    }
+#endif
+
+    if(base)
+    {
+        DGL_Log_File_Header *header = dgl_cast(DGL_Log_File_Header *)base;
+        header->segment_index = log_file->next_segment_index;
+        header->segment_size = log_file->segment_size;
+        header->end_offset = 0;
+        if(log_file->first_segment_index == dgl_cast(uint64)-1)
+        {
+            log_file->first_segment_index = log_file->next_segment_index;
+        }
+        header->first_segment_index = log_file->first_segment_index;
+        dgl_atomic_store_uint64(&header->magic, DGL_LOG_FILE_MAGIC);
+
+        segment->base = dgl_cast(uint8 *)base;
+        segment->size = log_file->segment_size;
+        segment->file = segment_file;
+        segment->write_offset = DGL_LOG_FILE_HEADER_SIZE;
+        ++log_file->next_segment_index;
+        result = true;
+    }
+
+    // NOTE(dgl): No DGL_LOG on failure, the log file may be the sink.
+    segment->in_use = true;
+    return(result);
+}
+
+internal void
+dgl__log_segment_release(DGL_Log_Segment *segment, uint64 end_offset)
+{
+    if(segment->base)
+    {
+        DGL_Log_File_Header *header = dgl_cast(DGL_Log_File_Header *)segment->base;
+        dgl_atomic_store_uint64(&header->end_offset, end_offset);
+        dgl__log_unmap(segment->base, segment->size);
+#if DGL_OS_UNIX || DGL_OS_OSX
+        close(segment->file);
+#endif
+    }
+    segment->base = 0;
+    dgl_atomic_store_uint64(&segment->in_use, false);
+}
+
+// NOTE(dgl): Called by the one writer whose reservation crossed the end of the segment. Returns
+// false if the next segment could not be created.
+internal bool32
+dgl__log_file_rotate(DGL_Log_File *log_file, uint64 generation, uint64 end_offset)
+{
+    DGL_Log_Segment *segment = log_file->segments + (generation & 1);
+    DGL_Log_Segment *next = log_file->segments + ((generation + 1) & 1);
+
+    // NOTE(dgl): The previous rotation may still wait for writers in the other slot.
+    uint32 spins = 0;
+    while(dgl_atomic_load_uint64(&next->in_use)) { dgl__log_backoff(&spins); }
+    bool32 result = dgl__log_segment_create(log_file, next);
+
+    // NOTE(dgl): The exchange is a full barrier. Writers increment writer_count before they check
+    // the generation, so every writer still in the old segment is counted after it.
+    dgl_atomic_exchange_uint64(&log_file->generation, generation + 1);
+    spins = 0;
+    while(dgl_atomic_load_uint64(&segment->writer_count)) { dgl__log_backoff(&spins); }
+    dgl__log_segment_release(segment, end_offset);
+    return(result);
+}
+
+DGL_DEF bool32
+dgl_log_file_open(DGL_Log_File *log_file, char *base_path, uint64 segment_size)
+{
+    dgl_assert(segment_size >= DGL_LOG_FILE_HEADER_SIZE + DGL_LOG_LINE_SIZE, "Segments must fit at least one line");
+    dgl_assert(strlen(base_path) < DGL_LOG_FILE_PATH_SIZE, "Path is too long");
+    memset(log_file, 0, sizeof(*log_file));
+    snprintf(log_file->base_path, sizeof(log_file->base_path), "%s", base_path);
+    log_file->segment_size = segment_size;
+    log_file->first_segment_index = dgl_cast(uint64)-1;
+    log_file->segments[0].file = -1;
+    log_file->segments[1].file = -1;
+
+    bool32 result = dgl__log_segment_create(log_file, log_file->segments);
+    if(!result)
+    {
+        DGL_LOG("Failed to open log file %s", base_path);
+    }
+    return(result);
+}
+
+DGL_DEF void
+dgl_log_file_close(DGL_Log_File *log_file)
+{
+    DGL_Log_Segment *segment = log_file->segments + (log_file->generation & 1);
+    dgl_assert(!segment->writer_count && !log_file->segments[(log_file->generation + 1) & 1].in_use,
+               "All writers have to be finished before the log file is closed");
+    dgl__log_segment_release(segment, dgl_min(segment->write_offset, segment->size));
+}
+
+DGL_DEF bool32
+dgl_log_file_write(DGL_Log_File *log_file, char *line, usize length)
+{
+    dgl_assert(length > 0 && line[0] != 0 && line[length - 1] == '\n', "Lines must end with a newline and not start with zero");
+    bool32 result = false;
+    bool32 done = length > log_file->segment_size - DGL_LOG_FILE_HEADER_SIZE;
+    while(!done)
+    {
+        uint64 generation = dgl_atomic_load_uint64(&log_file->generation);
+        DGL_Log_Segment *segment = log_file->segments + (generation & 1);
+        dgl_atomic_add_uint64(&segment->writer_count, 1);
+
+        // NOTE(dgl): Only a writer that is counted while the generation is current may use the
+        // segment, otherwise the rotation might already unmap it.
+        bool32 current = dgl_atomic_load_uint64(&log_file->generation) == generation;
+        bool32 rotate = false;
+        uint64 offset = 0;
+        if(current)
+        {
+            offset = dgl_atomic_add_uint64(&segment->write_offset, length);
+            if(offset + length <= segment->size)
+            {
+                memcpy(segment->base + offset + 1, line + 1, length - 1);
+                dgl_atomic_store_uint8(segment->base + offset, dgl_cast(uint8)line[0]);
+                result = true;
+                done = true;
+            }
+            else
+            {
+                // NOTE(dgl): The first writer behind the end rotates.
+                rotate = offset <= segment->size;
+            }
+        }
+        dgl_atomic_add_uint64(&segment->writer_count, dgl_cast(uint64)-1);
+
+        if(rotate)
+        {
+            // NOTE(dgl): Drop the line if there is no next segment, so this does not spin.
+            done = !dgl__log_file_rotate(log_file, generation, offset);
+        }
+        else if(current && !done)
+        {
+            uint32 spins = 0;
+            while(dgl_atomic_load_uint64(&log_file->generation) == generation) { dgl__log_backoff(&spins); }
+        }
+    }
+    return(result);
+}
+
+DGL_DEF void
+dgl_log_file_sink(void *log_file, char *line, usize length)
+{
+    dgl_log_file_write(dgl_cast(DGL_Log_File *)log_file, line, length);
+}
+
+// NOTE(dgl): Maps a segment read only. Returns 0 if it does not exist or its header is not
+// written yet.
+internal DGL_Log_File_Header *
+dgl__log_segment_map_read(char *base_path, uint64 segment_index, usize *segment_size)
+{
+    DGL_Log_File_Header *result = 0;
+    char path[DGL_LOG_FILE_PATH_SIZE + 32];
+    dgl__log_file_path(path, sizeof(path), base_path, segment_index);
+    void *base = 0;
+    usize size = 0;
+#if DGL_OS_UNIX || DGL_OS_OSX
+    int file = open(path, O_RDONLY);
+    if(file >= 0)
+    {
+        struct stat file_stat;
+        if(fstat(file, &file_stat) == 0 && file_stat.st_size >= DGL_LOG_FILE_HEADER_SIZE)
+        {
+            size = dgl_cast(usize)file_stat.st_size;
+            void *memory = mmap(0, size, PROT_READ, MAP_SHARED, file, 0);
+            if(memory != MAP_FAILED) { base = memory; }
+        }
+        // NOTE(dgl): The mapping stays valid after closing the file.
+        close(file);
+    }
+#elif DGL_OS_WINDOWS
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    if(file != INVALID_HANDLE_VALUE)
+    {
+        LARGE_INTEGER file_size;
+        if(GetFileSizeEx(file, &file_size) && file_size.QuadPart >= DGL_LOG_FILE_HEADER_SIZE)
+        {
+            size = dgl_cast(usize)file_size.QuadPart;
+            HANDLE mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+            if(mapping)
+            {
+                base = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+                CloseHandle(mapping);
+            }
+        }
+        // NOTE(dgl): The view stays valid after closing the file.
+        CloseHandle(file);
+    }
+#endif
+
+    if(base)
+    {
+        // NOTE(dgl): The magic is written last, a new segment may not be ready yet.
+        DGL_Log_File_Header *header = dgl_cast(DGL_Log_File_Header *)base;
+        if(dgl_atomic_load_uint64(&header->magic) == DGL_LOG_FILE_MAGIC && header->segment_size == size)
+        {
+            *segment_size = size;
+            result = header;
+        }
+        else
+        {
+            dgl__log_unmap(base, size);
+        }
+    }
+    return(result);
+}
+
+internal bool32
+dgl__log_reader_map(DGL_Log_Reader *reader)
+{
+    bool32 result = false;
+    bool32 searching = true;
+    while(searching)
+    {
+        usize size = 0;
+        DGL_Log_File_Header *header = dgl__log_segment_map_read(reader->base_path, reader->segment_index, &size);
+        if(!header)
+        {
+            searching = false;
+        }
+        else
+        {
+            if(reader->first_segment_index == dgl_cast(uint64)-1)
+            {
+                reader->first_segment_index = header->first_segment_index;
+            }
+
+            if(header->first_segment_index == reader->first_segment_index)
+            {
+                reader->base = dgl_cast(uint8 *)header;
+                reader->size = size;
+                reader->offset = DGL_LOG_FILE_HEADER_SIZE;
+                result = true;
+                searching = false;
+            }
+            else
+            {
+                // NOTE(dgl): Written by another log file on the same base path.
+                dgl__log_unmap(header, size);
+                ++reader->segment_index;
+            }
+        }
+    }
+    return(result);
+}
+
+internal void
+dgl__log_reader_unmap(DGL_Log_Reader *reader)
+{
+    if(reader->base) { dgl__log_unmap(reader->base, reader->size); }
+    reader->base = 0;
+    reader->size = 0;
+    reader->offset = 0;
+}
+
+DGL_DEF bool32
+dgl_log_reader_open(DGL_Log_Reader *reader, char *base_path, uint64 segment_index)
+{
+    dgl_assert(strlen(base_path) < DGL_LOG_FILE_PATH_SIZE, "Path is too long");
+    memset(reader, 0, sizeof(*reader));
+    snprintf(reader->base_path, sizeof(reader->base_path), "%s", base_path);
+    reader->segment_index = segment_index;
+    reader->first_segment_index = dgl_cast(uint64)-1;
+    bool32 result = dgl__log_reader_map(reader);
+    return(result);
+}
+
+DGL_DEF usize
+dgl_log_reader_next(DGL_Log_Reader *reader, char **line)
+{
+    usize result = 0;
+    bool32 waiting = false;
+    while(!result && !waiting)
+    {
+        if(!reader->base && !dgl__log_reader_map(reader))
+        {
+            waiting = true;
+        }
+        else
+        {
+            uint8 *at = reader->base + reader->offset;
+            uint8 *end = 0;
+            if(reader->offset < reader->size && dgl_atomic_load_uint8(at) != 0)
+            {
+                // NOTE(dgl): The first byte was stored last, so the rest of the line is there.
+                end = dgl_cast(uint8 *)memchr(at, '\n', reader->size - reader->offset);
+            }
+
+            if(end)
+            {
+                result = dgl_cast(usize)(end - at) + 1;
+                *line = dgl_cast(char *)at;
+                reader->offset += result;
+            }
+            else
+            {
+                DGL_Log_File_Header *header = dgl_cast(DGL_Log_File_Header *)reader->base;
+                uint64 end_offset = dgl_atomic_load_uint64(&header->end_offset);
+                if(end_offset && reader->offset >= end_offset)
+                {
+                    // NOTE(dgl): This segment is finished, the next one may not exist yet.
+                    dgl__log_reader_unmap(reader);
+                    ++reader->segment_index;
+                }
+                else
+                {
+                    waiting = true;
+                }
+            }
+        }
+    }
+    return(result);
+}
+
+DGL_DEF void
+dgl_log_reader_close(DGL_Log_Reader *reader)
+{
+    dgl__log_reader_unmap(reader);
+}
+
+#endif // DGL_NO_LOG
+
+//
+// Memory
+//
+#ifndef DGL_NO_MEMORY
+
+#ifndef DGL_LOG
+#define DGL_LOG(...)
+#endif
+
+#ifndef DGL_LOG_DEBUG
+#define DGL_LOG_DEBUG(...)
+#endif
+
+#include <string.h>
+DGL_DEF uintptr
+dgl__align_forward_uintptr(uintptr base, usize align)
+{
+    uintptr result = base;
+
+    dgl_assert((align & (align - 1)) == 0, "Alignment has to be a power of two");
+    // Same as (base % align) but faster as 'align' is a power of two
+    uintptr modulo = base & (dgl_cast(uintptr)align - 1);
+
+    if(modulo != 0)
+    {
+        result += (align - modulo);
+    }
+
+    return(result);
+}
+
+DGL_DEF DGL_Mem_Index
+dgl__align_forward_memory_index(DGL_Mem_Index size, usize align)
+{
+    DGL_Mem_Index result = size;
+
+    dgl_assert((align & (align - 1)) == 0, "Alignment has to be a power of two");
+
+    DGL_Mem_Index modulo = size & (align - 1);
+
+    if(modulo != 0)
+    {
+        result += (align - modulo);
+    }
+
+    return(result);
+}
+
+#if DGL_SIMD_SSE4_1
+// NOTE(dgl): Medium sizes are copied without a loop, as blocks from both ends that overlap in the
+// middle. Above that the loop starts at the first aligned destination address and the unaligned
+// first and last blocks are stored separately, so the branches do not depend on the alignment.
+// Expects size > 64.
+DGL_TARGET_AVX2 internal void
+dgl__fast_memcpy_avx2(uint8 *dest, uint8 *src, usize size)
+{
+    if(size <= 256)
+    {
+        __m256i a = _mm256_loadu_si256(dgl_cast(__m256i *)src);
+        __m256i b = _mm256_loadu_si256(dgl_cast(__m256i *)(src + 32));
+        __m256i c = _mm256_loadu_si256(dgl_cast(__m256i *)(src + size - 64));
+        __m256i d = _mm256_loadu_si256(dgl_cast(__m256i *)(src + size - 32));
+        if(size > 128)
+        {
+            __m256i e = _mm256_loadu_si256(dgl_cast(__m256i *)(src + 64));
+            __m256i f = _mm256_loadu_si256(dgl_cast(__m256i *)(src + 96));
+            __m256i g = _mm256_loadu_si256(dgl_cast(__m256i *)(src + size - 128));
+            __m256i h = _mm256_loadu_si256(dgl_cast(__m256i *)(src + size - 96));
+            _mm256_storeu_si256(dgl_cast(__m256i *)(dest + 64), e);
+            _mm256_storeu_si256(dgl_cast(__m256i *)(dest + 96), f);
+            _mm256_storeu_si256(dgl_cast(__m256i *)(dest + size - 128), g);
+            _mm256_storeu_si256(dgl_cast(__m256i *)(dest + size - 96), h);
+        }
+        _mm256_storeu_si256(dgl_cast(__m256i *)dest, a);
+        _mm256_storeu_si256(dgl_cast(__m256i *)(dest + 32), b);
+        _mm256_storeu_si256(dgl_cast(__m256i *)(dest + size - 64), c);
+        _mm256_storeu_si256(dgl_cast(__m256i *)(dest + size - 32), d);
+    }
+    else
+    {
+        __m256i first = _mm256_loadu_si256(dgl_cast(__m256i *)src);
+        __m256i last_a = _mm256_loadu_si256(dgl_cast(__m256i *)(src + size - 128));
+        __m256i last_b = _mm256_loadu_si256(dgl_cast(__m256i *)(src + size - 96));
+        __m256i last_c = _mm256_loadu_si256(dgl_cast(__m256i *)(src + size - 64));
+        __m256i last_d = _mm256_loadu_si256(dgl_cast(__m256i *)(src + size - 32));
+        usize index = 32 - (dgl_cast(uintptr)dest & 31);
+        if(size >= DGL_FAST_MEMCPY_STREAM_THRESHOLD)
+        {
+            for(; index + 128 <= size; index += 128)
+            {
+                __m256i a = _mm256_loadu_si256(dgl_cast(__m256i *)(src + index));
+                __m256i b = _mm256_loadu_si256(dgl_cast(__m256i *)(src + index + 32));
+                __m256i c = _mm256_loadu_si256(dgl_cast(__m256i *)(src + index + 64));
+                __m256i d = _mm256_loadu_si256(dgl_cast(__m256i *)(src + index + 96));
+                _mm256_stream_si256(dgl_cast(__m256i *)(dest + index), a);
+                _mm256_stream_si256(dgl_cast(__m256i *)(dest + index + 32), b);
+                _mm256_stream_si256(dgl_cast(__m256i *)(dest + index + 64), c);
+                _mm256_stream_si256(dgl_cast(__m256i *)(dest + index + 96), d);
+            }
+            _mm_sfence();
+        }
+        else
+        {
+            for(; index + 128 <= size; index += 128)
+            {
+                __m256i a = _mm256_loadu_si256(dgl_cast(__m256i *)(src + index));
+                __m256i b = _mm256_loadu_si256(dgl_cast(__m256i *)(src + index + 32));
+                __m256i c = _mm256_loadu_si256(dgl_cast(__m256i *)(src + index + 64));
+                __m256i d = _mm256_loadu_si256(dgl_cast(__m256i *)(src + index + 96));
+                _mm256_store_si256(dgl_cast(__m256i *)(dest + index), a);
+                _mm256_store_si256(dgl_cast(__m256i *)(dest + index + 32), b);
+                _mm256_store_si256(dgl_cast(__m256i *)(dest + index + 64), c);
+                _mm256_store_si256(dgl_cast(__m256i *)(dest + index + 96), d);
+            }
+        }
+        _mm256_storeu_si256(dgl_cast(__m256i *)dest, first);
+        _mm256_storeu_si256(dgl_cast(__m256i *)(dest + size - 128), last_a);
+        _mm256_storeu_si256(dgl_cast(__m256i *)(dest + size - 96), last_b);
+        _mm256_storeu_si256(dgl_cast(__m256i *)(dest + size - 64), last_c);
+        _mm256_storeu_si256(dgl_cast(__m256i *)(dest + size - 32), last_d);
+    }
+}
+
+DGL_TARGET_AVX2 internal void
+dgl__fast_memset_avx2(uint8 *dest, uint8 value, usize size)
+{
+    __m256i wide = _mm256_set1_epi8(dgl_cast(char)value);
+    _mm256_storeu_si256(dgl_cast(__m256i *)dest, wide);
+    _mm256_storeu_si256(dgl_cast(__m256i *)(dest + 32), wide);
+    _mm256_storeu_si256(dgl_cast(__m256i *)(dest + size - 64), wide);
+    _mm256_storeu_si256(dgl_cast(__m256i *)(dest + size - 32), wide);
+    if(size > 128)
+    {
+        _mm256_storeu_si256(dgl_cast(__m256i *)(dest + 64), wide);
+        _mm256_storeu_si256(dgl_cast(__m256i *)(dest + 96), wide);
+        _mm256_storeu_si256(dgl_cast(__m256i *)(dest + size - 128), wide);
+        _mm256_storeu_si256(dgl_cast(__m256i *)(dest + size - 96), wide);
+    }
+    if(size > 256)
+    {
+        usize index = 32 - (dgl_cast(uintptr)dest & 31);
+        if(size >= DGL_FAST_MEMCPY_STREAM_THRESHOLD)
+        {
+            for(; index + 128 <= size; index += 128)
+            {
+                _mm256_stream_si256(dgl_cast(__m256i *)(dest + index), wide);
+                _mm256_stream_si256(dgl_cast(__m256i *)(dest + index + 32), wide);
+                _mm256_stream_si256(dgl_cast(__m256i *)(dest + index + 64), wide);
+                _mm256_stream_si256(dgl_cast(__m256i *)(dest + index + 96), wide);
+            }
+            _mm_sfence();
+        }
+        else
+        {
+            for(; index + 128 <= size; index += 128)
+            {
+                _mm256_store_si256(dgl_cast(__m256i *)(dest + index), wide);
+                _mm256_store_si256(dgl_cast(__m256i *)(dest + index + 32), wide);
+                _mm256_store_si256(dgl_cast(__m256i *)(dest + index + 64), wide);
+                _mm256_store_si256(dgl_cast(__m256i *)(dest + index + 96), wide);
+            }
+        }
+    }
+}
+
+internal void
+dgl__fast_memcpy_sse(uint8 *dest, uint8 *src, usize size)
+{
+    if(size <= 128)
+    {
+        __m128i a = _mm_loadu_si128(dgl_cast(__m128i *)src);
+        __m128i b = _mm_loadu_si128(dgl_cast(__m128i *)(src + 16));
+        __m128i c = _mm_loadu_si128(dgl_cast(__m128i *)(src + 32));
+        __m128i d = _mm_loadu_si128(dgl_cast(__m128i *)(src + 48));
+        __m128i e = _mm_loadu_si128(dgl_cast(__m128i *)(src + size - 64));
+        __m128i f = _mm_loadu_si128(dgl_cast(__m128i *)(src + size - 48));
+        __m128i g = _mm_loadu_si128(dgl_cast(__m128i *)(src + size - 32));
+        __m128i h = _mm_loadu_si128(dgl_cast(__m128i *)(src + size - 16));
+        _mm_storeu_si128(dgl_cast(__m128i *)dest, a);
+        _mm_storeu_si128(dgl_cast(__m128i *)(dest + 16), b);
+        _mm_storeu_si128(dgl_cast(__m128i *)(dest + 32), c);
+        _mm_storeu_si128(dgl_cast(__m128i *)(dest + 48), d);
+        _mm_storeu_si128(dgl_cast(__m128i *)(dest + size - 64), e);
+        _mm_storeu_si128(dgl_cast(__m128i *)(dest + size - 48), f);
+        _mm_storeu_si128(dgl_cast(__m128i *)(dest + size - 32), g);
+        _mm_storeu_si128(dgl_cast(__m128i *)(dest + size - 16), h);
+    }
+    else
+    {
+        __m128i first = _mm_loadu_si128(dgl_cast(__m128i *)src);
+        __m128i last_a = _mm_loadu_si128(dgl_cast(__m128i *)(src + size - 64));
+        __m128i last_b = _mm_loadu_si128(dgl_cast(__m128i *)(src + size - 48));
+        __m128i last_c = _mm_loadu_si128(dgl_cast(__m128i *)(src + size - 32));
+        __m128i last_d = _mm_loadu_si128(dgl_cast(__m128i *)(src + size - 16));
+        usize index = 16 - (dgl_cast(uintptr)dest & 15);
+        if(size >= DGL_FAST_MEMCPY_STREAM_THRESHOLD)
+        {
+            for(; index + 64 <= size; index += 64)
+            {
+                __m128i a = _mm_loadu_si128(dgl_cast(__m128i *)(src + index));
+                __m128i b = _mm_loadu_si128(dgl_cast(__m128i *)(src + index + 16));
+                __m128i c = _mm_loadu_si128(dgl_cast(__m128i *)(src + index + 32));
+                __m128i d = _mm_loadu_si128(dgl_cast(__m128i *)(src + index + 48));
+                _mm_stream_si128(dgl_cast(__m128i *)(dest + index), a);
+                _mm_stream_si128(dgl_cast(__m128i *)(dest + index + 16), b);
+                _mm_stream_si128(dgl_cast(__m128i *)(dest + index + 32), c);
+                _mm_stream_si128(dgl_cast(__m128i *)(dest + index + 48), d);
+            }
+            _mm_sfence();
+        }
+        else
+        {
+            for(; index + 64 <= size; index += 64)
+            {
+                __m128i a = _mm_loadu_si128(dgl_cast(__m128i *)(src + index));
+                __m128i b = _mm_loadu_si128(dgl_cast(__m128i *)(src + index + 16));
+                __m128i c = _mm_loadu_si128(dgl_cast(__m128i *)(src + index + 32));
+                __m128i d = _mm_loadu_si128(dgl_cast(__m128i *)(src + index + 48));
+                _mm_store_si128(dgl_cast(__m128i *)(dest + index), a);
+                _mm_store_si128(dgl_cast(__m128i *)(dest + index + 16), b);
+                _mm_store_si128(dgl_cast(__m128i *)(dest + index + 32), c);
+                _mm_store_si128(dgl_cast(__m128i *)(dest + index + 48), d);
+            }
+        }
+        _mm_storeu_si128(dgl_cast(__m128i *)dest, first);
+        _mm_storeu_si128(dgl_cast(__m128i *)(dest + size - 64), last_a);
+        _mm_storeu_si128(dgl_cast(__m128i *)(dest + size - 48), last_b);
+        _mm_storeu_si128(dgl_cast(__m128i *)(dest + size - 32), last_c);
+        _mm_storeu_si128(dgl_cast(__m128i *)(dest + size - 16), last_d);
+    }
+}
+
+internal void
+dgl__fast_memset_sse(uint8 *dest, uint8 value, usize size)
+{
+    __m128i wide = _mm_set1_epi8(dgl_cast(char)value);
+    _mm_storeu_si128(dgl_cast(__m128i *)dest, wide);
+    _mm_storeu_si128(dgl_cast(__m128i *)(dest + 16), wide);
+    _mm_storeu_si128(dgl_cast(__m128i *)(dest + 32), wide);
+    _mm_storeu_si128(dgl_cast(__m128i *)(dest + 48), wide);
+    _mm_storeu_si128(dgl_cast(__m128i *)(dest + size - 64), wide);
+    _mm_storeu_si128(dgl_cast(__m128i *)(dest + size - 48), wide);
+    _mm_storeu_si128(dgl_cast(__m128i *)(dest + size - 32), wide);
+    _mm_storeu_si128(dgl_cast(__m128i *)(dest + size - 16), wide);
+    if(size > 128)
+    {
+        usize index = 16 - (dgl_cast(uintptr)dest & 15);
+        if(size >= DGL_FAST_MEMCPY_STREAM_THRESHOLD)
+        {
+            for(; index + 64 <= size; index += 64)
+            {
+                _mm_stream_si128(dgl_cast(__m128i *)(dest + index), wide);
+                _mm_stream_si128(dgl_cast(__m128i *)(dest + index + 16), wide);
+                _mm_stream_si128(dgl_cast(__m128i *)(dest + index + 32), wide);
+                _mm_stream_si128(dgl_cast(__m128i *)(dest + index + 48), wide);
+            }
+            _mm_sfence();
+        }
+        else
+        {
+            for(; index + 64 <= size; index += 64)
+            {
+                _mm_store_si128(dgl_cast(__m128i *)(dest + index), wide);
+                _mm_store_si128(dgl_cast(__m128i *)(dest + index + 16), wide);
+                _mm_store_si128(dgl_cast(__m128i *)(dest + index + 32), wide);
+                _mm_store_si128(dgl_cast(__m128i *)(dest + index + 48), wide);
+            }
+        }
+    }
+}
+#endif // DGL_SIMD_SSE4_1
+
+DGL_DEF void
+dgl__fast_memcpy_large(uint8 *dest, uint8 *src, usize size)
+{
+    dgl_assert(size > 64, "Small copies are inlined");
+#if DGL_SIMD_SSE4_1
+    if(dgl_cpu_features() & DGL_CPU_FEATURE_AVX2)
+    {
+        dgl__fast_memcpy_avx2(dest, src, size);
+    }
+    else
+    {
+        dgl__fast_memcpy_sse(dest, src, size);
+    }
+#else
+    for(usize index = 0; index + 8 < size; index += 8)
+    {
+        *dgl_cast(dgl__mem_uint64 *)(dest + index) = *dgl_cast(dgl__mem_uint64 *)(src + index);
+    }
+    *dgl_cast(dgl__mem_uint64 *)(dest + size - 8) = *dgl_cast(dgl__mem_uint64 *)(src + size - 8);
+#endif
+}
+
+DGL_DEF void
+dgl__fast_memset_large(uint8 *dest, uint8 value, usize size)
+{
+    dgl_assert(size > 64, "Small sets are inlined");
+#if DGL_SIMD_SSE4_1
+    if(dgl_cpu_features() & DGL_CPU_FEATURE_AVX2)
+    {
+        dgl__fast_memset_avx2(dest, value, size);
+    }
+    else
+    {
+        dgl__fast_memset_sse(dest, value, size);
+    }
+#else
+    uint64 pattern = 0x0101010101010101ULL * value;
+    for(usize index = 0; index + 8 < size; index += 8)
+    {
+        *dgl_cast(dgl__mem_uint64 *)(dest + index) = pattern;
+    }
+    *dgl_cast(dgl__mem_uint64 *)(dest + size - 8) = pattern;
+#endif
+}
+
+void
+dgl_mem_arena_init(DGL_Mem_Arena *arena, uint8 *base, DGL_Mem_Index size)
+{
+    arena->size = size;
+    arena->base = base;
+    arena->curr_offset = 0;
+    arena->prev_offset = 0;
+}
+
+DGL_DEF void *
+dgl_mem_arena_alloc_align_no_zero(DGL_Mem_Arena *arena, DGL_Mem_Index size, usize align)
+{
+    uintptr curr_ptr = dgl_cast(uintptr)(arena->base + arena->curr_offset);
+    uintptr new_ptr = dgl__align_forward_uintptr(curr_ptr, align);
+
+    DGL_Mem_Index offset = dgl_cast(DGL_Mem_Index)(new_ptr - dgl_cast(uintptr)arena->base); // revert back to relative offset
+
+    dgl_assert((offset + size) <= arena->size, "Arena overflow. Cannot allocate size");
+
+    void *result = arena->base + offset;
+    arena->prev_offset = offset;
+    arena->curr_offset = offset + size;
+
+    return(result);
+}
+
+DGL_DEF void *
+dgl_mem_arena_alloc_align(DGL_Mem_Arena *arena, DGL_Mem_Index size, usize align)
+{
+    void *result = dgl_mem_arena_alloc_align_no_zero(arena, size, align);
+
+    // Zero new memory by default (we do not zero the memory on init or free_all)
+    dgl_memset(result, 0, size);
+
+    return(result);
+}
+
+DGL_DEF void *
+dgl_mem_arena_resize_align(DGL_Mem_Arena *arena, uint8 *current_base, DGL_Mem_Index current_size, DGL_Mem_Index new_size, usize align)
+{
+    void *result = 0;
+    dgl_assert(arena->base <= current_base && current_base < arena->base + arena->size, "This allocation does not belong to the arena");
+
+    if(current_size == new_size)
+    {
+        result = current_base;
+    }
+    else if(arena->base + arena->prev_offset == current_base)
+    {
+        dgl_assert((arena->prev_offset + new_size) <= arena->size, "Arena overflow. Cannot allocate new size");
+        arena->curr_offset = arena->prev_offset + new_size;
+        if (new_size > current_size)
+        {
+            // Zero the newly allocated memory
+            dgl_memset(arena->base + arena->prev_offset + current_size, 0, new_size - current_size);
+        }
+        result = current_base;
+        DGL_LOG_DEBUG("Resize allocation at 0x%p from %d to %d (%d bytes)", current_base, current_size, new_size, new_size - current_size);
+    }
+    else
+    {
+        void *new_base = dgl_mem_arena_alloc_align(arena, new_size, align);
+        // NOTE(dgl): copy the existing data to the new location
+        usize copy_size = new_size < current_size ? new_size : current_size;
+        dgl_memcpy(new_base, current_base, copy_size);
+        result = new_base;
+        DGL_LOG_DEBUG("New allocation for resizing 0x%p from %d to %d (%d bytes). New address is 0x%p", current_base, current_size, new_size, new_size - current_size, new_base);
+    }
+
+    return(result);
+}
+
+DGL_DEF void
+dgl_mem_arena_free_all(DGL_Mem_Arena *arena)
+{
+    arena->curr_offset = 0;
+    arena->prev_offset = 0;
+}
+
+DGL_DEF DGL_Mem_Temp_Arena
+dgl_mem_arena_begin_temp(DGL_Mem_Arena *arena)
+{
+    DGL_Mem_Temp_Arena result;
+    result.arena = arena;
+    result.prev_offset = arena->prev_offset;
+    result.curr_offset = arena->curr_offset;
+    return(result);
+}
+
+DGL_DEF void
+dgl_mem_arena_end_temp(DGL_Mem_Temp_Arena temp)
+{
+    temp.arena->prev_offset = temp.prev_offset;
+    temp.arena->curr_offset = temp.curr_offset;
+}
+
+global dgl_thread_local DGL_Mem_Arena dgl__mem_scratch_arenas[DGL_MEM_SCRATCH_ARENA_COUNT];
+
+DGL_DEF void
+dgl_mem_scratch_thread_init(uint8 *base, DGL_Mem_Index size)
+{
+    // NOTE(dgl): Round down, so every arena starts at the same alignment as base.
+    DGL_Mem_Index arena_size = (size / DGL_MEM_SCRATCH_ARENA_COUNT) & ~(DEFAULT_ALIGNMENT - 1);
+
+    for(uint32 index = 0; index < DGL_MEM_SCRATCH_ARENA_COUNT; ++index)
+    {
+        dgl_mem_arena_init(dgl__mem_scratch_arenas + index, base + index * arena_size, arena_size);
+    }
+}
+
+DGL_DEF DGL_Mem_Arena *
+dgl_mem_get_scratch(DGL_Mem_Arena **conflicts, uint32 conflict_count)
+{
+    DGL_Mem_Arena *result = 0;
+    for(uint32 index = 0; index < DGL_MEM_SCRATCH_ARENA_COUNT && !result; ++index)
+    {
+        DGL_Mem_Arena *candidate = dgl__mem_scratch_arenas + index;
+        bool32 has_conflict = false;
+        for(uint32 conflict_index = 0; conflict_index < conflict_count; ++conflict_index)
+        {
+            if(conflicts[conflict_index] == candidate) { has_conflict = true; break; }
+        }
+
+        if(!has_conflict) { result = candidate; }
+    }
+
+    dgl_assert(result, "All scratch arenas conflict. Increase DGL_MEM_SCRATCH_ARENA_COUNT");
+    dgl_assert(result->base, "Scratch arenas are not initialized on this thread");
+
+    return(result);
+}
+
+DGL_DEF DGL_Mem_Temp_Arena
+dgl_mem_scratch_begin(DGL_Mem_Arena **conflicts, uint32 conflict_count)
+{
+    DGL_Mem_Temp_Arena result = dgl_mem_arena_begin_temp(dgl_mem_get_scratch(conflicts, conflict_count));
+    return(result);
+}
+
+DGL_DEF void
+dgl_mem_atomic_arena_init(DGL_Mem_Atomic_Arena *arena, uint8 *base, DGL_Mem_Index size)
+{
+    // NOTE(dgl): Every reservation is a multiple of DEFAULT_ALIGNMENT, so all offsets stay aligned
+    // and smaller alignments never need padding.
+    uintptr aligned_base = dgl__align_forward_uintptr(dgl_cast(uintptr)base, DEFAULT_ALIGNMENT);
+    DGL_Mem_Index padding = dgl_cast(DGL_Mem_Index)(aligned_base - dgl_cast(uintptr)base);
+    arena->base = dgl_cast(uint8 *)aligned_base;
+    arena->size = size > padding ? size - padding : 0;
+    arena->curr_offset = 0;
+}
+
+internal void *
+dgl__mem_atomic_arena_reserve(DGL_Mem_Atomic_Arena *arena, DGL_Mem_Index size, usize align)
+{
+    void *result = 0;
+    DGL_Mem_Index padding = align > DEFAULT_ALIGNMENT ? align - DEFAULT_ALIGNMENT : 0;
+    DGL_Mem_Index reserved = dgl__align_forward_memory_index(size + padding, DEFAULT_ALIGNMENT);
+
+    DGL_Mem_Index offset = dgl_cast(DGL_Mem_Index)dgl_atomic_add_uint64(&arena->curr_offset, reserved);
+    // NOTE(dgl): Threads running past the end is expected, so an overflow returns 0 without an
+    // assert. The offset stays past the end, so every following allocation fails as well.
+    if(offset + reserved <= arena->size)
+    {
+        result = dgl_cast(void *)dgl__align_forward_uintptr(dgl_cast(uintptr)(arena->base + offset), align);
+    }
+
+    return(result);
+}
+
+DGL_DEF void *
+dgl_mem_atomic_arena_alloc_align(DGL_Mem_Atomic_Arena *arena, DGL_Mem_Index size, usize align)
+{
+    void *result = dgl__mem_atomic_arena_reserve(arena, size, align);
+    if(result)
+    {
+        dgl_memset(result, 0, size);
+    }
+    return(result);
+}
+
+DGL_DEF void
+dgl_mem_atomic_arena_free_all(DGL_Mem_Atomic_Arena *arena)
+{
+    arena->curr_offset = 0;
+}
+
+DGL_DEF void *
+dgl_mem_atomic_arena_alloc_local(DGL_Mem_Atomic_Arena *arena, DGL_Mem_Arena *local, DGL_Mem_Index size, usize align)
+{
+    void *result = 0;
+    if(size + align > DGL_MEM_ATOMIC_ARENA_BLOCK_SIZE / 2)
+    {
+        result = dgl_mem_atomic_arena_alloc_align(arena, size, align);
+    }
+    else
+    {
+        uintptr curr_ptr = dgl_cast(uintptr)(local->base + local->curr_offset);
+        DGL_Mem_Index offset = dgl_cast(DGL_Mem_Index)(dgl__align_forward_uintptr(curr_ptr, align) - dgl_cast(uintptr)local->base);
+        if(!local->base || offset + size > local->size)
+        {
+            uint8 *block = dgl_cast(uint8 *)dgl__mem_atomic_arena_reserve(arena, DGL_MEM_ATOMIC_ARENA_BLOCK_SIZE, DEFAULT_ALIGNMENT);
+            dgl_mem_arena_init(local, block, block ? DGL_MEM_ATOMIC_ARENA_BLOCK_SIZE : 0);
+        }
+
+        if(local->base)
+        {
+            result = dgl_mem_arena_alloc_align(local, size, align);
+        }
+    }
+    return(result);
+}
+
+DGL_DEF void
+dgl_mem_pool_free_all(DGL_Mem_Pool *arena)
+{
+    DGL_Mem_Index chunk_count = arena->size / arena->chunk_size;
+
+    // NOTE(dgl): Build the list back to front, so the chunks are handed out in address order.
+    arena->head = 0;
+    for(DGL_Mem_Index index = chunk_count; index > 0; --index)
+    {
+        void *chunk = arena->base + (arena->chunk_size * (index - 1));
+
+        DGL_Mem_Pool_Free_Node *node = dgl_cast(DGL_Mem_Pool_Free_Node *)(chunk);
+        node->next = arena->head;
+        arena->head = node;
+    }
+}
+
+DGL_DEF void
+dgl_mem_pool_init_align(DGL_Mem_Pool *arena, uint8 *base, DGL_Mem_Index size, DGL_Mem_Index chunk_size, usize chunk_alignment)
+{
+    uintptr initial_base = (uintptr)base;
+    uintptr new_base = dgl__align_forward_uintptr(initial_base, chunk_alignment);
+    size -= dgl_cast(DGL_Mem_Index)(new_base - initial_base);
+
+    // NOTE(dgl): Align the size of each memory chunk
+    DGL_Mem_Index aligned_chunk_size = dgl__align_forward_memory_index(chunk_size, chunk_alignment);
+
+    // NOTE(dgl): dgl_assert if everything fits
+    dgl_assert(chunk_size >= sizeof(DGL_Mem_Pool_Free_Node), "Chunk size is too small");
+    dgl_assert(size >= chunk_size, "Backing buffer length is smaller than the chunk size");
+
+    arena->size = size;
+    arena->base = dgl_cast(uint8 *)new_base;
+    arena->chunk_size = aligned_chunk_size;
+    arena->head = 0;
+
+    dgl_mem_pool_free_all(arena);
+}
+
+DGL_DEF void *
+dgl__mem_pool_alloc_internal(DGL_Mem_Pool *arena)
+{
+    void *result = 0;
+    DGL_Mem_Pool_Free_Node *node = arena->head;
+
+    if(node) {
+        result = node;
+        arena->head = node->next;
+        dgl_memset(result, 0, arena->chunk_size);
+    }
+    else
+    {
+        // TODO(dgl): logging
+        dgl_assert(!node, "No free node in memory pool");
+    }
+
+    return(result);
+}
+
+DGL_DEF void
+dgl__mem_pool_free_internal(DGL_Mem_Pool *arena, void *ptr)
+{
+    dgl_assert((ptr >= dgl_cast(void *)arena->base) &&
+           (ptr < dgl_cast(void *)(arena->base + arena->size)), "Pointer is not in memory pool range");
+
+    DGL_Mem_Pool_Free_Node *node = dgl_cast(DGL_Mem_Pool_Free_Node *)ptr;
+    node->next = arena->head;
+    arena->head = node;
+}
+
+DGL_DEF void
+dgl_mem_handle_pool_init_align(DGL_Mem_Handle_Pool *pool, uint8 *base, DGL_Mem_Index size, DGL_Mem_Index chunk_size, usize chunk_alignment)
+{
+    DGL_Mem_Index aligned_chunk_size = dgl__align_forward_memory_index(chunk_size, chunk_alignment);
+    uintptr slots = dgl__align_forward_uintptr(dgl_cast(uintptr)base, sizeof(uint16));
+    uintptr end = dgl_cast(uintptr)base + size;
+
+    // NOTE(dgl): The slot states live in front of the chunks. Same estimate as the bitmap pool,
+    // every chunk costs its size plus two bytes.
+    DGL_Mem_Index chunk_count = size / (aligned_chunk_size + sizeof(uint16));
+    chunk_count = dgl_min(chunk_count, dgl_cast(DGL_Mem_Index)DGL_MEM_HANDLE_INDEX_MASK + 1);
+    uintptr chunks = 0;
+    for(; chunk_count > 0; --chunk_count)
+    {
+        chunks = dgl__align_forward_uintptr(slots + chunk_count * sizeof(uint16), chunk_alignment);
+        if(chunks + chunk_count * aligned_chunk_size <= end) { break; }
+    }
+    dgl_assert(chunk_count > 0, "Backing buffer length is smaller than the chunk size");
+
+    pool->slots = dgl_cast(uint16 *)slots;
+    pool->chunk_count = chunk_count;
+    dgl_memset(pool->slots, 0, chunk_count * sizeof(uint16));
+    // NOTE(dgl): chunks is already aligned, the pool does not move it.
+    dgl_mem_pool_init_align(&pool->pool, dgl_cast(uint8 *)chunks, chunk_count * aligned_chunk_size, aligned_chunk_size, chunk_alignment);
+    pool->live_count = 0;
+}
+
+DGL_DEF void
+dgl_mem_handle_pool_free_all(DGL_Mem_Handle_Pool *pool)
+{
+    for(DGL_Mem_Index index = 0; index < pool->chunk_count; ++index)
+    {
+        uint16 slot = pool->slots[index];
+        if(slot & DGL_MEM_HANDLE_SLOT_LIVE)
+        {
+            uint32 generation = ((slot & DGL_MEM_HANDLE_GENERATION_MASK) + 1) & DGL_MEM_HANDLE_GENERATION_MASK;
+            pool->slots[index] = dgl_cast(uint16)generation;
+        }
+    }
+    dgl_mem_pool_free_all(&pool->pool);
+    pool->live_count = 0;
+}
+
+DGL_DEF DGL_Mem_Handle
+dgl_mem_handle_pool_alloc(DGL_Mem_Handle_Pool *pool)
+{
+    DGL_Mem_Handle result = 0;
+    if(pool->pool.head)
+    {
+        void *chunk = dgl_mem_pool_push(&pool->pool, void);
+        DGL_Mem_Index index = dgl_cast(DGL_Mem_Index)(dgl_cast(uint8 *)chunk - pool->pool.base) / pool->pool.chunk_size;
+
+        uint32 generation = pool->slots[index];
+        dgl_assert(!(generation & DGL_MEM_HANDLE_SLOT_LIVE), "Chunk is already live");
+        // NOTE(dgl): Skip the generation 0, otherwise the first chunk could get the null handle.
+        if(generation == 0) { generation = 1; }
+
+        pool->slots[index] = dgl_cast(uint16)(DGL_MEM_HANDLE_SLOT_LIVE | generation);
+        ++pool->live_count;
+        result = dgl_mem_handle_make(index, generation);
+    }
+    return(result);
+}
+
+DGL_DEF bool32
+dgl_mem_handle_pool_release(DGL_Mem_Handle_Pool *pool, DGL_Mem_Handle handle)
+{
+    bool32 result = false;
+    void *chunk = dgl_mem_handle_pool_resolve(pool, handle);
+    if(chunk)
+    {
+        DGL_Mem_Index index = dgl_mem_handle_index(handle);
+        uint32 generation = (dgl_mem_handle_generation(handle) + 1) & DGL_MEM_HANDLE_GENERATION_MASK;
+        pool->slots[index] = dgl_cast(uint16)generation;
+        --pool->live_count;
+        dgl_mem_pool_release(&pool->pool, chunk);
+        result = true;
+    }
+    return(result);
+}
+
+DGL_DEF DGL_Mem_Handle
+dgl_mem_handle_pool_handle_of(DGL_Mem_Handle_Pool *pool, void *ptr)
+{
+    DGL_Mem_Handle result = 0;
+    if(dgl_cast(uint8 *)ptr >= pool->pool.base && dgl_cast(uint8 *)ptr < pool->pool.base + pool->pool.size)
+    {
+        DGL_Mem_Index index = dgl_cast(DGL_Mem_Index)(dgl_cast(uint8 *)ptr - pool->pool.base) / pool->pool.chunk_size;
+        uint16 slot = pool->slots[index];
+        if(slot & DGL_MEM_HANDLE_SLOT_LIVE)
+        {
+            result = dgl_mem_handle_make(index, slot & DGL_MEM_HANDLE_GENERATION_MASK);
+        }
+    }
+    return(result);
+}
+
+DGL_DEF void
+dgl_mem_bitmap_pool_init_align(DGL_Mem_Bitmap_Pool *pool, uint8 *base, DGL_Mem_Index size, DGL_Mem_Index chunk_size, usize chunk_alignment)
+{
+    DGL_Mem_Index aligned_chunk_size = dgl__align_forward_memory_index(chunk_size, chunk_alignment);
+    uintptr bitmap = dgl__align_forward_uintptr(dgl_cast(uintptr)base, sizeof(uint64));
+    uintptr end = dgl_cast(uintptr)base + size;
+
+    // NOTE(dgl): Every chunk costs its size plus one bit. Start with that estimate and shrink
+    // until the bitmap, the alignment padding and the chunks fit.
+    DGL_Mem_Index chunk_count = (size * 8) / (aligned_chunk_size * 8 + 1);
+    DGL_Mem_Index word_count = 0;
+    uintptr chunks = 0;
+    for(; chunk_count > 0; --chunk_count)
+    {
+        word_count = (chunk_count + 63) / 64;
+        chunks = dgl__align_forward_uintptr(bitmap + word_count * sizeof(uint64), chunk_alignment);
+        if(chunks + chunk_count * aligned_chunk_size <= end) { break; }
+    }
+    dgl_assert(chunk_count > 0, "Backing buffer length is smaller than the chunk size");
+
+    pool->occupied = dgl_cast(uint64 *)bitmap;
+    pool->word_count = chunk_count ? word_count : 0;
+    pool->base = dgl_cast(uint8 *)chunks;
+    pool->chunk_size = aligned_chunk_size;
+    pool->chunk_count = chunk_count;
+
+    dgl_mem_bitmap_pool_free_all(pool);
+}
+
+DGL_DEF void
+dgl_mem_bitmap_pool_free_all(DGL_Mem_Bitmap_Pool *pool)
+{
+    dgl_memset(pool->occupied, 0, pool->word_count * sizeof(uint64));
+    pool->first_free_word = 0;
+    pool->live_count = 0;
+}
+
+DGL_DEF void *
+dgl_mem_bitmap_pool_alloc(DGL_Mem_Bitmap_Pool *pool)
+{
+    void *result = 0;
+    DGL_Mem_Index word_index = pool->first_free_word;
+    while(word_index < pool->word_count && pool->occupied[word_index] == 0xFFFFFFFFFFFFFFFFULL)
+    {
+        ++word_index;
+    }
+    pool->first_free_word = word_index;
+
+    if(word_index < pool->word_count)
+    {
+        uint64 word = pool->occupied[word_index];
+        uint32 bit = dgl_count_trailing_zeros_uint64(~word);
+        DGL_Mem_Index index = word_index * 64 + bit;
+        // NOTE(dgl): The bits after the last chunk are never set, so the lowest free bit can be
+        // past the end only if the pool is full.
+        if(index < pool->chunk_count)
+        {
+            pool->occupied[word_index] = word | (1ULL << bit);
+            ++pool->live_count;
+            result = pool->base + index * pool->chunk_size;
+            dgl_memset(result, 0, pool->chunk_size);
+        }
+    }
+
+    return(result);
+}
+
+DGL_DEF void
+dgl_mem_bitmap_pool_release(DGL_Mem_Bitmap_Pool *pool, void *ptr)
+{
+    dgl_assert((dgl_cast(uint8 *)ptr >= pool->base) &&
+               (dgl_cast(uint8 *)ptr < pool->base + pool->chunk_count * pool->chunk_size), "Pointer is not in memory pool range");
+
+    DGL_Mem_Index index = dgl_mem_bitmap_pool_index_of(pool, ptr);
+    DGL_Mem_Index word_index = index / 64;
+    uint64 bit = 1ULL << (index % 64);
+    dgl_assert(pool->occupied[word_index] & bit, "Chunk is already free");
+
+    pool->occupied[word_index] &= ~bit;
+    --pool->live_count;
+    pool->first_free_word = dgl_min(pool->first_free_word, word_index);
+}
+
+DGL_DEF void
+dgl_mem_bitmap_pool_release_mask(DGL_Mem_Bitmap_Pool *pool, uint64 *mask, DGL_Mem_Index word_count)
+{
+    word_count = dgl_min(word_count, pool->word_count);
+    for(DGL_Mem_Index word_index = 0; word_index < word_count; ++word_index)
+    {
+        uint64 released = pool->occupied[word_index] & mask[word_index];
+        if(released)
+        {
+            pool->occupied[word_index] &= ~released;
+            pool->live_count -= dgl_count_set_bits_uint64(released);
+            pool->first_free_word = dgl_min(pool->first_free_word, word_index);
+        }
+    }
+}
+
+DGL_DEF void
+dgl_mem_bitmap_pool_for_each_live(DGL_Mem_Bitmap_Pool *pool, dgl_mem_pool_visit_F visit, void *user_data)
+{
+    DGL_Mem_Bitmap_Pool_Iter iter = dgl_mem_bitmap_pool_iter(pool);
+    for(void *chunk; (chunk = dgl_mem_bitmap_pool_iter_next(&iter));)
+    {
+        visit(chunk, user_data);
+    }
+}
+
+DGL_DEF void *
+dgl__mem_pool_alloc_threadsafe_internal(DGL_Mem_Pool *arena)
+{
+    void *result = 0;
+    DGL_Mem_Pool_Free_Node *node = arena->head;
+
+    if(node) {
+        uintptr old_head = dgl_cast(uintptr)node;
+        uintptr new_head = dgl_cast(uintptr)arena->head->next;
+        uintptr head = dgl_cast(uintptr)arena->head;
+
+        if(dgl_atomic_compare_exchange_uintptr(&head,
+           new_head,
+           old_head) == old_head)
+        {
+            result = node;
+            dgl_memset(result, 0, arena->chunk_size);
+        }
+        else
+        {
+           // TODO(dgl): logging
+            printf("compare exchange failed.");
+        }
+    }
+    else
+    {
+        // TODO(dgl): logging
+        dgl_assert(!node, "No free node in memory pool");
+    }
+
+    return(result);
+}
+
+DGL_DEF void
+dgl__mem_pool_free_threadsafe_internal(DGL_Mem_Pool *arena, void *ptr)
+{
+    dgl_assert((ptr >= dgl_cast(void *)arena->base) &&
+           (ptr < dgl_cast(void *)(arena->base + arena->size)), "Pointer is not in memory pool range");
+
+    DGL_Mem_Pool_Free_Node *node = dgl_cast(DGL_Mem_Pool_Free_Node *)ptr;
+
+    uintptr old_head;
+    uintptr new_head;
+    uintptr head;
+    do
+    {
+        node->next = arena->head;
+        head = dgl_cast(uintptr)arena->head;
+        old_head = head;
+        new_head = dgl_cast(uintptr)node;
+    } while(dgl_atomic_compare_exchange_uintptr(&head,
+            new_head,
+            old_head) != old_head);
+}
+
+#ifndef DGL_NO_HASH
+
+#include <stdio.h> // fopen, fwrite
+#if DGL_OS_UNIX || DGL_OS_OSX
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#elif DGL_OS_WINDOWS
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h> // CreateFileA, VirtualAlloc
+#endif
+
+internal DGL_Mem_Index
+dgl__mem_page_align(DGL_Mem_Index size)
+{
+    DGL_Mem_Index result = dgl__align_forward_memory_index(size, DGL_MEM_ARENA_IMAGE_HEADER_SIZE);
+    return(result);
+}
+
+internal bool32
+dgl__mem_arena_image_header_valid(DGL_Mem_Arena_Image_Header *header, uint64 file_size)
+{
+    bool32 result = header->magic == DGL_MEM_ARENA_IMAGE_MAGIC &&
+                    header->version == DGL_MEM_ARENA_IMAGE_VERSION &&
+                    header->header_size == DGL_MEM_ARENA_IMAGE_HEADER_SIZE &&
+                    header->used_size <= header->arena_size &&
+                    file_size >= header->header_size + header->used_size;
+    return(result);
+}
+
+internal void
+dgl__mem_arena_image_release(void *base, DGL_Mem_Index reserve_size)
+{
+#if DGL_OS_UNIX || DGL_OS_OSX
+    munmap(base, reserve_size);
+#elif DGL_OS_WINDOWS
+    VirtualFree(base, 0, MEM_RELEASE);
+#endif
+}
+
+DGL_DEF bool32
+dgl_mem_arena_save_image(DGL_Mem_Arena *arena, char *path)
+{
+    dgl_assert((dgl_cast(uintptr)arena->base & (DEFAULT_ALIGNMENT - 1)) == 0, "Arena base has to be aligned to be relocatable");
+    bool32 result = false;
+
+    DGL_Mem_Arena_Image_Header header = {};
+    header.magic = DGL_MEM_ARENA_IMAGE_MAGIC;
+    header.version = DGL_MEM_ARENA_IMAGE_VERSION;
+    header.header_size = DGL_MEM_ARENA_IMAGE_HEADER_SIZE;
+    header.used_size = arena->curr_offset;
+    header.arena_size = arena->size;
+    header.checksum = dgl_hash_bytes(arena->base, arena->curr_offset, DGL_MEM_ARENA_IMAGE_VERSION);
+
+    FILE *file = fopen(path, "wb");
+    if(file)
+    {
+        result = fwrite(&header, sizeof(header), 1, file) == 1;
+
+        // NOTE(dgl): Pad the header with zeros up to the data.
+        uint8 zeros[1024] = {};
+        for(usize padding = sizeof(header); result && padding < DGL_MEM_ARENA_IMAGE_HEADER_SIZE; padding += sizeof(zeros))
+        {
+            usize size = dgl_min(sizeof(zeros), DGL_MEM_ARENA_IMAGE_HEADER_SIZE - padding);
+            result = fwrite(zeros, size, 1, file) == 1;
+        }
+
+        if(result && arena->curr_offset > 0)
+        {
+            result = fwrite(arena->base, arena->curr_offset, 1, file) == 1;
+        }
+        result = (fclose(file) == 0) && result;
+    }
+
+    if(!result)
+    {
+        DGL_LOG("Failed to save arena image %s", path);
+    }
+
+    return(result);
+}
+
+DGL_DEF bool32
+dgl_mem_arena_load_image(DGL_Mem_Arena *arena, char *path, bool32 verify_checksum)
+{
+    bool32 result = false;
+    DGL_Mem_Arena_Image_Header header = {};
+    uint64 file_size = 0;
+    void *base = 0;
+    DGL_Mem_Index reserve_size = 0;
+
+#if DGL_OS_UNIX || DGL_OS_OSX
+    int file = open(path, O_RDONLY);
+    if(file >= 0)
+    {
+        struct stat file_stat;
+        if((pread(file, &header, sizeof(header), 0) == sizeof(header)) && (fstat(file, &file_stat) == 0))
+        {
+            file_size = dgl_cast(uint64)file_stat.st_size;
+        }
+
+        if(dgl__mem_arena_image_header_valid(&header, file_size))
+        {
+            // NOTE(dgl): Reserve the whole arena first and map the file over the beginning of it.
+            reserve_size = dgl__mem_page_align(dgl_max(header.arena_size, 1));
+            void *memory = mmap(0, reserve_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if(memory != MAP_FAILED)
+            {
+                base = memory;
+                if(header.used_size > 0 &&
+                   mmap(base, header.used_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, file, dgl_cast(off_t)header.header_size) == MAP_FAILED)
+                {
+                    dgl__mem_arena_image_release(base, reserve_size);
+                    base = 0;
+                }
+            }
+        }
+        close(file);
+    }
+#elif DGL_OS_WINDOWS
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    if(file != INVALID_HANDLE_VALUE)
+    {
+        DWORD bytes_read = 0;
+        LARGE_INTEGER size;
+        if(ReadFile(file, &header, sizeof(header), &bytes_read, 0) && bytes_read == sizeof(header) && GetFileSizeEx(file, &size))
+        {
+            file_size = dgl_cast(uint64)size.QuadPart;
+        }
+
+        if(dgl__mem_arena_image_header_valid(&header, file_size))
+        {
+            // NOTE(dgl): File views cannot be placed inside a reservation, so the used part is read
+            // instead of mapped.
+            reserve_size = dgl__mem_page_align(dgl_max(header.arena_size, 1));
+            base = VirtualAlloc(0, reserve_size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+            if(base)
+            {
+                LARGE_INTEGER offset;
+                offset.QuadPart = dgl_cast(LONGLONG)header.header_size;
+                bool32 valid = SetFilePointerEx(file, offset, 0, FILE_BEGIN) != 0;
+                uint64 read_size = 0;
+                while(valid && read_size < header.used_size)
+                {
+                    DWORD chunk_size = dgl_cast(DWORD)dgl_min(header.used_size - read_size, dgl_cast(uint64)gigabytes(1));
+                    valid = ReadFile(file, dgl_cast(uint8 *)base + read_size, chunk_size, &bytes_read, 0) && bytes_read == chunk_size;
+                    read_size += chunk_size;
+                }
+
+                if(!valid)
+                {
+                    dgl__mem_arena_image_release(base, reserve_size);
+                    base = 0;
+                }
+            }
+        }
+        CloseHandle(file);
+    }
+#endif
+
+    if(base)
+    {
+        if(!verify_checksum || dgl_hash_bytes(base, header.used_size, DGL_MEM_ARENA_IMAGE_VERSION) == header.checksum)
+        {
+            arena->base = dgl_cast(uint8 *)base;
+            arena->size = header.arena_size;
+            arena->curr_offset = header.used_size;
+            arena->prev_offset = header.used_size;
+            result = true;
+        }
+        else
+        {
+            dgl__mem_arena_image_release(base, reserve_size);
+        }
+    }
+
+    if(!result)
+    {
+        DGL_LOG("Failed to load arena image %s", path);
+    }
+
+    return(result);
+}
+
+DGL_DEF void
+dgl_mem_arena_unload_image(DGL_Mem_Arena *arena)
+{
+    dgl__mem_arena_image_release(arena->base, dgl__mem_page_align(dgl_max(arena->size, 1)));
+    dgl_mem_arena_init(arena, 0, 0);
+}
+
+#endif // DGL_NO_HASH
+
+DGL_DEF void
+dgl_epoch_init(DGL_Epoch *epoch)
+{
+    epoch->global_epoch = 0;
+    epoch->first_thread = 0;
+}
+
+DGL_DEF void
+dgl_epoch_thread_register(DGL_Epoch *epoch, DGL_Epoch_Thread *thread, uint8 *base, DGL_Mem_Index size)
+{
+    dgl_memset(thread, 0, sizeof(*thread));
+    thread->epoch = epoch;
+    dgl_mem_arena_init(&thread->arena, base, size);
+
+    // NOTE(dgl): Threads are only ever added, so a simple lock free push is enough.
+    uintptr old_head;
+    do
+    {
+        old_head = dgl_atomic_load_uintptr(dgl_cast(uintptr volatile *)&epoch->first_thread);
+        thread->next = dgl_cast(DGL_Epoch_Thread *)old_head;
+    } while(dgl_atomic_compare_exchange_uintptr(dgl_cast(uintptr volatile *)&epoch->first_thread,
+                                                dgl_cast(uintptr)thread, old_head) != old_head);
+}
+
+DGL_DEF bool32
+dgl_epoch_try_advance(DGL_Epoch *epoch)
+{
+    bool32 result = true;
+    uint64 global_epoch = dgl_atomic_load_uint64(&epoch->global_epoch);
+    DGL_Epoch_Thread *thread = dgl_cast(DGL_Epoch_Thread *)dgl_atomic_load_uintptr(dgl_cast(uintptr volatile *)&epoch->first_thread);
+    for(; thread && result; thread = thread->next)
+    {
+        uint64 announced = dgl_atomic_load_uint64(&thread->announced);
+        result = !(announced & 1) || (announced >> 1) == global_epoch;
+    }
+
+    if(result)
+    {
+        // NOTE(dgl): Losing the race is fine, somebody else advanced it.
+        dgl_atomic_compare_exchange_uint64(&epoch->global_epoch, global_epoch + 1, global_epoch);
+    }
+    return(result);
+}
+
+internal usize
+dgl__epoch_release_bag(DGL_Epoch_Thread *thread, uint32 bag_index)
+{
+    usize result = 0;
+    DGL_Epoch_Block *block = thread->bags[bag_index];
+    while(block)
+    {
+        DGL_Epoch_Block *next = block->next;
+        for(uint32 index = 0; index < block->count; ++index)
+        {
+            dgl_mem_pool_release(block->items[index].pool, block->items[index].ptr);
+        }
+        result += block->count;
+
+        block->next = thread->free_blocks;
+        thread->free_blocks = block;
+        block = next;
+    }
+    thread->bags[bag_index] = 0;
+    thread->retired_count -= result;
+    return(result);
+}
+
+DGL_DEF usize
+dgl_epoch_collect(DGL_Epoch_Thread *thread)
+{
+    usize result = 0;
+    dgl_epoch_try_advance(thread->epoch);
+
+    uint64 global_epoch = dgl_atomic_load_uint64(&thread->epoch->global_epoch);
+    for(uint32 bag_index = 0; bag_index < DGL_EPOCH_BAG_COUNT; ++bag_index)
+    {
+        if(thread->bags[bag_index] && thread->bag_epochs[bag_index] + 2 <= global_epoch)
+        {
+            result += dgl__epoch_release_bag(thread, bag_index);
+        }
+    }
+    return(result);
+}
+
+DGL_DEF bool32
+dgl_epoch_retire(DGL_Epoch_Thread *thread, void *ptr, DGL_Mem_Pool *pool)
+{
+    bool32 result = false;
+    // NOTE(dgl): The chunk is already unlinked, so only readers that entered before the global
+    // epoch moved past this one can still see it. The fence keeps the unlink (a release store)
+    // from being reordered after the epoch load. Otherwise a reader of the next epoch could still
+    // get the chunk while it goes into the bag of this epoch and is released one epoch too early.
+    dgl_atomic_fence();
+    uint64 global_epoch = dgl_atomic_load_uint64(&thread->epoch->global_epoch);
+    uint32 bag_index = dgl_cast(uint32)(global_epoch % DGL_EPOCH_BAG_COUNT);
+    if(thread->bag_epochs[bag_index] != global_epoch)
+    {
+        // NOTE(dgl): The bag is from at least DGL_EPOCH_BAG_COUNT epochs ago, everything in it is safe.
+        dgl__epoch_release_bag(thread, bag_index);
+        thread->bag_epochs[bag_index] = global_epoch;
+    }
+
+    DGL_Epoch_Block *block = thread->bags[bag_index];
+    if(!block || block->count == DGL_EPOCH_BLOCK_CAPACITY)
+    {
+        // NOTE(dgl): The arena does not fail gracefully, so check if a new block still fits.
+        DGL_Mem_Arena *arena = &thread->arena;
+        uintptr next_block = dgl__align_forward_uintptr(dgl_cast(uintptr)(arena->base + arena->curr_offset), DEFAULT_ALIGNMENT);
+        bool32 block_fits = arena->base && next_block + sizeof(DGL_Epoch_Block) <= dgl_cast(uintptr)(arena->base + arena->size);
+        if(!thread->free_blocks && !block_fits)
+        {
+            dgl_epoch_collect(thread);
+        }
+
+        DGL_Epoch_Block *new_block = thread->free_blocks;
+        if(new_block)
+        {
+            thread->free_blocks = new_block->next;
+        }
+        else if(block_fits)
+        {
+            new_block = dgl_mem_arena_push_struct(arena, DGL_Epoch_Block);
+        }
+
+        if(new_block)
+        {
+            // NOTE(dgl): Collecting can release the current bag, so reload it.
+            new_block->next = thread->bags[bag_index];
+            new_block->count = 0;
+            thread->bags[bag_index] = new_block;
+        }
+        block = new_block;
+    }
+
+    if(block)
+    {
+        block->items[block->count].ptr = ptr;
+        block->items[block->count].pool = pool;
+        ++block->count;
+        ++thread->retired_count;
+        result = true;
+
+        if(thread->retired_count >= DGL_EPOCH_RECLAIM_THRESHOLD)
+        {
+            dgl_epoch_collect(thread);
+        }
+    }
+    else
+    {
+        dgl_assert(block, "Epoch retire list memory is exhausted");
+    }
+    return(result);
+}
+
+DGL_DEF void
+dgl_epoch_thread_end(DGL_Epoch_Thread *thread)
+{
+    dgl_assert(thread->nesting == 0, "Thread is still inside a critical section");
+    thread->nesting = 0;
+    dgl_atomic_store_uint64(&thread->announced, 0);
+    dgl_epoch_collect(thread);
+}
+
+#endif // DGL_NO_MEMORY
+
+//
+//  String
+//
+
+#ifndef DGL_NO_STRING
+
+DGL_DEF DGL_String_Builder
+dgl_string_builder_init(DGL_Mem_Arena *arena, usize capacity)
+{
+    DGL_String_Builder result = {};
+    result.arena = arena;
+    result.data = dgl_mem_arena_push_array(arena, uint8, capacity);
+    result.count = 0;
+    result.capacity = capacity;
+
+    return(result);
+}
+
+DGL_DEF void
+dgl__string_append_internal(DGL_String_Builder *builder, char *fmt, ...)
+{
+    DGL_Mem_Arena *a = builder->arena;
+    va_list ap;
+retry:
+    va_start(ap, fmt);
+    int32 size = vsnprintf(dgl_cast(char *)(builder->data + builder->count), builder->capacity - builder->count, fmt, ap);
+    if(size < 0)
+    {
+        DGL_LOG("Failed to append string to %p", builder->data);
+    }
+    else
+    {
+        usize required_cap = builder->count + dgl_cast(usize)size;
+        if(builder->capacity <= required_cap)
+        {
+            usize new_capacity = builder->capacity;
+            while(new_capacity <= required_cap)
+            {
+                new_capacity *= 2;
+            }
+            // NOTE(dgl): If the current buffer size is too small,
+            // we resize the buffer with double the size.
+
+            builder->data = dgl_cast(uint8 *)dgl_mem_arena_resize(a, builder->data, builder->capacity, new_capacity);
+            builder->capacity = new_capacity;
+            goto retry;
+        }
+        builder->count += dgl_cast(usize)size;
+        builder->data[builder->count] = '\0';
+    }
+}
+
+DGL_DEF char *
+dgl_string_c_style(DGL_String_Builder *builder)
+{
+   // TODO(dgl): copy into memory and add nullbyte
+   char *result = builder->string;
+   return(result);
+}
+
+DGL_DEF bool32
+dgl_utf8_validate_scalar(uint8 *data, usize size)
+{
+    bool32 result = true;
+    usize index = 0;
+    while(index < size && result)
+    {
+        uint8 lead = data[index];
+        usize length = 1;
+        uint8 min_second = 0x80;
+        uint8 max_second = 0xBF;
+        if(lead < 0x80) { length = 1; }
+        else if(lead >= 0xC2 && lead <= 0xDF) { length = 2; }
+        else if(lead >= 0xE0 && lead <= 0xEF)
+        {
+            length = 3;
+            if(lead == 0xE0) { min_second = 0xA0; }
+            if(lead == 0xED) { max_second = 0x9F; }
+        }
+        else if(lead >= 0xF0 && lead <= 0xF4)
+        {
+            length = 4;
+            if(lead == 0xF0) { min_second = 0x90; }
+            if(lead == 0xF4) { max_second = 0x8F; }
+        }
+        else { result = false; }
+
+        if(result && length > 1)
+        {
+            result = index + length <= size && data[index + 1] >= min_second && data[index + 1] <= max_second;
+            for(usize next = 2; result && next < length; ++next)
+            {
+                result = (data[index + next] & 0xC0) == 0x80;
+            }
+        }
+        index += length;
+    }
+    return(result);
+}
+
+#if DGL_SIMD_SSE4_1
+// NOTE(dgl): Error classes of the UTF-8 lookup tables (Keiser and Lemire, "Validating UTF-8 In
+// Less Than One Instruction Per Byte"). A byte pair is invalid if the classes of the high nibble
+// and low nibble of the first byte and the high nibble of the second byte share a bit.
+#define DGL__UTF8_TOO_SHORT (1 << 0)
+#define DGL__UTF8_TOO_LONG (1 << 1)
+#define DGL__UTF8_OVERLONG_3 (1 << 2)
+#define DGL__UTF8_TOO_LARGE (1 << 3)
+#define DGL__UTF8_SURROGATE (1 << 4)
+#define DGL__UTF8_OVERLONG_2 (1 << 5)
+#define DGL__UTF8_TOO_LARGE_1000 (1 << 6)
+#define DGL__UTF8_OVERLONG_4 (1 << 6)
+#define DGL__UTF8_TWO_CONTS (1 << 7)
+#define DGL__UTF8_CARRY (DGL__UTF8_TOO_SHORT | DGL__UTF8_TOO_LONG | DGL__UTF8_TWO_CONTS)
+
+global uint8 dgl__utf8_byte_1_high[16] =
+{
+    // NOTE(dgl): 0___ (ASCII)
+    DGL__UTF8_TOO_LONG, DGL__UTF8_TOO_LONG, DGL__UTF8_TOO_LONG, DGL__UTF8_TOO_LONG,
+    DGL__UTF8_TOO_LONG, DGL__UTF8_TOO_LONG, DGL__UTF8_TOO_LONG, DGL__UTF8_TOO_LONG,
+    // NOTE(dgl): 10__ (continuation)
+    DGL__UTF8_TWO_CONTS, DGL__UTF8_TWO_CONTS, DGL__UTF8_TWO_CONTS, DGL__UTF8_TWO_CONTS,
+    // NOTE(dgl): 1100, 1101 (two byte lead)
+    DGL__UTF8_TOO_SHORT | DGL__UTF8_OVERLONG_2,
+    DGL__UTF8_TOO_SHORT,
+    // NOTE(dgl): 1110 (three byte lead)
+    DGL__UTF8_TOO_SHORT | DGL__UTF8_OVERLONG_3 | DGL__UTF8_SURROGATE,
+    // NOTE(dgl): 1111 (four byte lead)
+    DGL__UTF8_TOO_SHORT | DGL__UTF8_TOO_LARGE | DGL__UTF8_TOO_LARGE_1000 | DGL__UTF8_OVERLONG_4,
+};
+
+global uint8 dgl__utf8_byte_1_low[16] =
+{
+    DGL__UTF8_CARRY | DGL__UTF8_OVERLONG_3 | DGL__UTF8_OVERLONG_2 | DGL__UTF8_OVERLONG_4,
+    DGL__UTF8_CARRY | DGL__UTF8_OVERLONG_2,
+    DGL__UTF8_CARRY,
+    DGL__UTF8_CARRY,
+    DGL__UTF8_CARRY | DGL__UTF8_TOO_LARGE,
+    DGL__UTF8_CARRY | DGL__UTF8_TOO_LARGE | DGL__UTF8_TOO_LARGE_1000,
+    DGL__UTF8_CARRY | DGL__UTF8_TOO_LARGE | DGL__UTF8_TOO_LARGE_1000,
+    DGL__UTF8_CARRY | DGL__UTF8_TOO_LARGE | DGL__UTF8_TOO_LARGE_1000,
+    DGL__UTF8_CARRY | DGL__UTF8_TOO_LARGE | DGL__UTF8_TOO_LARGE_1000,
+    DGL__UTF8_CARRY | DGL__UTF8_TOO_LARGE | DGL__UTF8_TOO_LARGE_1000,
+    DGL__UTF8_CARRY | DGL__UTF8_TOO_LARGE | DGL__UTF8_TOO_LARGE_1000,
+    DGL__UTF8_CARRY | DGL__UTF8_TOO_LARGE | DGL__UTF8_TOO_LARGE_1000,
+    DGL__UTF8_CARRY | DGL__UTF8_TOO_LARGE | DGL__UTF8_TOO_LARGE_1000,
+    DGL__UTF8_CARRY | DGL__UTF8_TOO_LARGE | DGL__UTF8_TOO_LARGE_1000 | DGL__UTF8_SURROGATE,
+    DGL__UTF8_CARRY | DGL__UTF8_TOO_LARGE | DGL__UTF8_TOO_LARGE_1000,
+    DGL__UTF8_CARRY | DGL__UTF8_TOO_LARGE | DGL__UTF8_TOO_LARGE_1000,
+};
+
+global uint8 dgl__utf8_byte_2_high[16] =
+{
+    // NOTE(dgl): 0___ (ASCII)
+    DGL__UTF8_TOO_SHORT, DGL__UTF8_TOO_SHORT, DGL__UTF8_TOO_SHORT, DGL__UTF8_TOO_SHORT,
+    DGL__UTF8_TOO_SHORT, DGL__UTF8_TOO_SHORT, DGL__UTF8_TOO_SHORT, DGL__UTF8_TOO_SHORT,
+    // NOTE(dgl): 1000, 1001, 101_ (continuation)
+    DGL__UTF8_TOO_LONG | DGL__UTF8_OVERLONG_2 | DGL__UTF8_TWO_CONTS | DGL__UTF8_OVERLONG_3 | DGL__UTF8_TOO_LARGE_1000 | DGL__UTF8_OVERLONG_4,
+    DGL__UTF8_TOO_LONG | DGL__UTF8_OVERLONG_2 | DGL__UTF8_TWO_CONTS | DGL__UTF8_OVERLONG_3 | DGL__UTF8_TOO_LARGE,
+    DGL__UTF8_TOO_LONG | DGL__UTF8_OVERLONG_2 | DGL__UTF8_TWO_CONTS | DGL__UTF8_SURROGATE | DGL__UTF8_TOO_LARGE,
+    DGL__UTF8_TOO_LONG | DGL__UTF8_OVERLONG_2 | DGL__UTF8_TWO_CONTS | DGL__UTF8_SURROGATE | DGL__UTF8_TOO_LARGE,
+    // NOTE(dgl): 11__ (lead)
+    DGL__UTF8_TOO_SHORT, DGL__UTF8_TOO_SHORT, DGL__UTF8_TOO_SHORT, DGL__UTF8_TOO_SHORT,
+};
+
+// NOTE(dgl): A block is incomplete if one of its last three bytes starts a sequence that does not
+// fit. Subtracting these with saturation leaves a non zero byte exactly in that case.
+global uint8 dgl__utf8_max_value[16] =
+{
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xF0 - 1, 0xE0 - 1, 0xC0 - 1,
+};
+
+local_inline __m128i
+dgl__utf8_check_block(__m128i input, __m128i prev_input)
+{
+    __m128i low_nibble = _mm_set1_epi8(0x0F);
+    __m128i prev1 = _mm_alignr_epi8(input, prev_input, 15);
+    __m128i byte_1_high = _mm_shuffle_epi8(_mm_loadu_si128(dgl_cast(__m128i *)dgl__utf8_byte_1_high),
+                                           _mm_and_si128(_mm_srli_epi16(prev1, 4), low_nibble));
+    __m128i byte_1_low = _mm_shuffle_epi8(_mm_loadu_si128(dgl_cast(__m128i *)dgl__utf8_byte_1_low),
+                                          _mm_and_si128(prev1, low_nibble));
+    __m128i byte_2_high = _mm_shuffle_epi8(_mm_loadu_si128(dgl_cast(__m128i *)dgl__utf8_byte_2_high),
+                                           _mm_and_si128(_mm_srli_epi16(input, 4), low_nibble));
+    __m128i special = _mm_and_si128(_mm_and_si128(byte_1_high, byte_1_low), byte_2_high);
+
+    // NOTE(dgl): The third and fourth byte of a sequence must be continuations (and nothing else).
+    __m128i prev2 = _mm_alignr_epi8(input, prev_input, 14);
+    __m128i prev3 = _mm_alignr_epi8(input, prev_input, 13);
+    __m128i is_third_byte = _mm_subs_epu8(prev2, _mm_set1_epi8(0xE0 - 0x80));
+    __m128i is_fourth_byte = _mm_subs_epu8(prev3, _mm_set1_epi8(0xF0 - 0x80));
+    __m128i must_be_continuation = _mm_and_si128(_mm_or_si128(is_third_byte, is_fourth_byte), _mm_set1_epi8(dgl_cast(char)0x80));
+    __m128i result = _mm_xor_si128(must_be_continuation, special);
+    return(result);
+}
+
+DGL_TARGET_AVX2 local_inline __m256i
+dgl__utf8_check_block_avx2(__m256i input, __m256i prev_input)
+{
+    __m256i low_nibble = _mm256_set1_epi8(0x0F);
+    // NOTE(dgl): alignr works per 128 bit lane, so the lower lane needs the upper lane of prev_input.
+    __m256i shifted = _mm256_permute2x128_si256(prev_input, input, 0x21);
+    __m256i prev1 = _mm256_alignr_epi8(input, shifted, 15);
+    __m256i byte_1_high = _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_loadu_si128(dgl_cast(__m128i *)dgl__utf8_byte_1_high)),
+                                              _mm256_and_si256(_mm256_srli_epi16(prev1, 4), low_nibble));
+    __m256i byte_1_low = _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_loadu_si128(dgl_cast(__m128i *)dgl__utf8_byte_1_low)),
+                                             _mm256_and_si256(prev1, low_nibble));
+    __m256i byte_2_high = _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_loadu_si128(dgl_cast(__m128i *)dgl__utf8_byte_2_high)),
+                                              _mm256_and_si256(_mm256_srli_epi16(input, 4), low_nibble));
+    __m256i special = _mm256_and_si256(_mm256_and_si256(byte_1_high, byte_1_low), byte_2_high);
+
+    __m256i prev2 = _mm256_alignr_epi8(input, shifted, 14);
+    __m256i prev3 = _mm256_alignr_epi8(input, shifted, 13);
+    __m256i is_third_byte = _mm256_subs_epu8(prev2, _mm256_set1_epi8(0xE0 - 0x80));
+    __m256i is_fourth_byte = _mm256_subs_epu8(prev3, _mm256_set1_epi8(0xF0 - 0x80));
+    __m256i must_be_continuation = _mm256_and_si256(_mm256_or_si256(is_third_byte, is_fourth_byte), _mm256_set1_epi8(dgl_cast(char)0x80));
+    __m256i result = _mm256_xor_si256(must_be_continuation, special);
+    return(result);
+}
+
+// NOTE(dgl): Validates blocks of 32 bytes and returns how many bytes it checked. The state is
+// handed over to the sse loop, which checks the rest.
+DGL_TARGET_AVX2 internal usize
+dgl__utf8_validate_avx2(uint8 *data, usize size, __m128i *error, __m128i *prev_input, __m128i *prev_incomplete)
+{
+    usize index = 0;
+    __m256i error_256 = _mm256_setzero_si256();
+    __m256i prev_input_256 = _mm256_setzero_si256();
+    __m256i prev_incomplete_256 = _mm256_setzero_si256();
+    __m256i max_value = _mm256_setr_m128i(_mm_set1_epi8(dgl_cast(char)0xFF), _mm_loadu_si128(dgl_cast(__m128i *)dgl__utf8_max_value));
+    for(; index + 32 <= size; index += 32)
+    {
+        __m256i input = _mm256_loadu_si256(dgl_cast(__m256i *)(data + index));
+        if(_mm256_movemask_epi8(input) == 0)
+        {
+            error_256 = _mm256_or_si256(error_256, prev_incomplete_256);
+            prev_incomplete_256 = _mm256_setzero_si256();
+        }
+        else
+        {
+            error_256 = _mm256_or_si256(error_256, dgl__utf8_check_block_avx2(input, prev_input_256));
+            prev_incomplete_256 = _mm256_subs_epu8(input, max_value);
+        }
+        prev_input_256 = input;
+    }
+
+    *error = _mm_or_si128(_mm256_castsi256_si128(error_256), _mm256_extracti128_si256(error_256, 1));
+    *prev_input = _mm256_extracti128_si256(prev_input_256, 1);
+    *prev_incomplete = _mm256_extracti128_si256(prev_incomplete_256, 1);
+    return(index);
+}
+
+DGL_TARGET_AVX2 internal usize
+dgl__utf8_count_code_points_avx2(uint8 *data, usize size, usize *count)
+{
+    usize index = 0;
+    usize result = 0;
+    __m256i last_continuation = _mm256_set1_epi8(-65); // NOTE(dgl): 0xBF
+    for(; index + 32 <= size; index += 32)
+    {
+        __m256i input = _mm256_loadu_si256(dgl_cast(__m256i *)(data + index));
+        uint32 leads = dgl_cast(uint32)_mm256_movemask_epi8(_mm256_cmpgt_epi8(input, last_continuation));
+        result += dgl_count_set_bits_uint64(leads);
+    }
+    *count = result;
+    return(index);
+}
+#endif // DGL_SIMD_SSE4_1
+
+DGL_DEF bool32
+dgl_utf8_validate(uint8 *data, usize size)
+{
+    bool32 result;
+#if DGL_SIMD_SSE4_1
+    usize index = 0;
+    __m128i error = _mm_setzero_si128();
+    __m128i prev_input = _mm_setzero_si128();
+    __m128i prev_incomplete = _mm_setzero_si128();
+    __m128i max_value = _mm_loadu_si128(dgl_cast(__m128i *)dgl__utf8_max_value);
+    if(dgl_cpu_features() & DGL_CPU_FEATURE_AVX2)
+    {
+        index = dgl__utf8_validate_avx2(data, size, &error, &prev_input, &prev_incomplete);
+    }
+
+    // NOTE(dgl): The tail is padded with zeros, which are ASCII and end every open sequence.
+    uint8 tail[16];
+    for(; index < size; index += 16)
+    {
+        __m128i input;
+        if(index + 16 <= size)
+        {
+            input = _mm_loadu_si128(dgl_cast(__m128i *)(data + index));
+        }
+        else
+        {
+            dgl_memset(tail, 0, sizeof(tail));
+            for(usize tail_index = 0; index + tail_index < size; ++tail_index)
+            {
+                tail[tail_index] = data[index + tail_index];
+            }
+            input = _mm_loadu_si128(dgl_cast(__m128i *)tail);
+        }
+
+        if(_mm_movemask_epi8(input) == 0)
+        {
+            error = _mm_or_si128(error, prev_incomplete);
+            prev_incomplete = _mm_setzero_si128();
+        }
+        else
+        {
+            error = _mm_or_si128(error, dgl__utf8_check_block(input, prev_input));
+            prev_incomplete = _mm_subs_epu8(input, max_value);
+        }
+        prev_input = input;
+    }
+    error = _mm_or_si128(error, prev_incomplete);
+    result = _mm_testz_si128(error, error);
+#else
+    result = dgl_utf8_validate_scalar(data, size);
+#endif
+    return(result);
+}
+
+DGL_DEF usize
+dgl_utf8_count_code_points(uint8 *data, usize size)
+{
+    usize result = 0;
+    usize index = 0;
+#if DGL_SIMD_SSE4_1
+    if(dgl_cpu_features() & DGL_CPU_FEATURE_AVX2)
+    {
+        index = dgl__utf8_count_code_points_avx2(data, size, &result);
+    }
+    // NOTE(dgl): Every byte that is not a continuation (0x80 - 0xBF) starts a code point.
+    __m128i last_continuation = _mm_set1_epi8(-65);
+    for(; index + 16 <= size; index += 16)
+    {
+        __m128i input = _mm_loadu_si128(dgl_cast(__m128i *)(data + index));
+        uint32 leads = dgl_cast(uint32)_mm_movemask_epi8(_mm_cmpgt_epi8(input, last_continuation));
+        result += dgl_count_set_bits_uint64(leads);
+    }
+#endif
+    for(; index < size; ++index)
+    {
+        result += (data[index] & 0xC0) != 0x80;
+    }
+    return(result);
+}
+
+// NOTE(dgl): Expects a complete and valid sequence.
+local_inline usize
+dgl__utf8_decode(uint8 *data, uint32 *code_point)
+{
+    usize result;
+    uint32 lead = data[0];
+    if(lead < 0x80)
+    {
+        *code_point = lead;
+        result = 1;
+    }
+    else if(lead < 0xE0)
+    {
+        *code_point = ((lead & 0x1F) << 6) | (data[1] & 0x3Fu);
+        result = 2;
+    }
+    else if(lead < 0xF0)
+    {
+        *code_point = ((lead & 0x0F) << 12) | ((data[1] & 0x3Fu) << 6) | (data[2] & 0x3Fu);
+        result = 3;
+    }
+    else
+    {
+        *code_point = ((lead & 0x07) << 18) | ((data[1] & 0x3Fu) << 12) | ((data[2] & 0x3Fu) << 6) | (data[3] & 0x3Fu);
+        result = 4;
+    }
+    return(result);
+}
+
+// NOTE(dgl): Expects a valid code point.
+local_inline usize
+dgl__utf8_encode(uint8 *dest, uint32 code_point)
+{
+    usize result;
+    if(code_point < 0x80)
+    {
+        dest[0] = dgl_cast(uint8)code_point;
+        result = 1;
+    }
+    else if(code_point < 0x800)
+    {
+        dest[0] = dgl_cast(uint8)(0xC0 | (code_point >> 6));
+        dest[1] = dgl_cast(uint8)(0x80 | (code_point & 0x3F));
+        result = 2;
+    }
+    else if(code_point < 0x10000)
+    {
+        dest[0] = dgl_cast(uint8)(0xE0 | (code_point >> 12));
+        dest[1] = dgl_cast(uint8)(0x80 | ((code_point >> 6) & 0x3F));
+        dest[2] = dgl_cast(uint8)(0x80 | (code_point & 0x3F));
+        result = 3;
+    }
+    else
+    {
+        dest[0] = dgl_cast(uint8)(0xF0 | (code_point >> 18));
+        dest[1] = dgl_cast(uint8)(0x80 | ((code_point >> 12) & 0x3F));
+        dest[2] = dgl_cast(uint8)(0x80 | ((code_point >> 6) & 0x3F));
+        dest[3] = dgl_cast(uint8)(0x80 | (code_point & 0x3F));
+        result = 4;
+    }
+    return(result);
+}
+
+DGL_DEF uint16 *
+dgl_utf8_to_utf16(DGL_Mem_Arena *arena, uint8 *data, usize size, usize *count)
+{
+    uint16 *result = 0;
+    *count = 0;
+    if(dgl_utf8_validate(data, size))
+    {
+        // NOTE(dgl): Every byte becomes at most one unit (four bytes become a surrogate pair).
+        uint16 *dest = dgl_mem_arena_push_array_no_zero(arena, uint16, size + 1);
+        usize out = 0;
+        usize index = 0;
+        while(index < size)
+        {
+#if DGL_SIMD_SSE4_1
+            if(index + 16 <= size)
+            {
+                // NOTE(dgl): Widen the whole block, but only keep the ASCII prefix. The output has
+                // room for it, because no sequence takes more units than bytes.
+                __m128i input = _mm_loadu_si128(dgl_cast(__m128i *)(data + index));
+                uint32 non_ascii = dgl_cast(uint32)_mm_movemask_epi8(input);
+                usize ascii_count = non_ascii ? dgl_count_trailing_zeros_uint64(non_ascii) : 16;
+                if(ascii_count > 0)
+                {
+                    _mm_storeu_si128(dgl_cast(__m128i *)(dest + out), _mm_cvtepu8_epi16(input));
+                    _mm_storeu_si128(dgl_cast(__m128i *)(dest + out + 8), _mm_cvtepu8_epi16(_mm_srli_si128(input, 8)));
+                    index += ascii_count;
+                    out += ascii_count;
+                    continue;
+                }
+            }
+            // NOTE(dgl): Decode up to the next ASCII byte (or the end of the block) before
+            // checking for ASCII again. The tail is decoded completely.
+            bool32 stop_at_ascii = index + 16 <= size;
+#else
+            bool32 stop_at_ascii = false;
+#endif
+            usize block_end = dgl_min(index + 16, size);
+            while(index < block_end && !(stop_at_ascii && data[index] < 0x80))
+            {
+                uint32 code_point;
+                index += dgl__utf8_decode(data + index, &code_point);
+                if(code_point < 0x10000)
+                {
+                    dest[out++] = dgl_cast(uint16)code_point;
+                }
+                else
+                {
+                    code_point -= 0x10000;
+                    dest[out++] = dgl_cast(uint16)(0xD800 | (code_point >> 10));
+                    dest[out++] = dgl_cast(uint16)(0xDC00 | (code_point & 0x3FF));
+                }
+            }
+        }
+        dest[out] = 0;
+        result = dgl_mem_arena_resize_array(arena, uint16, dest, size + 1, out + 1);
+        *count = out;
+    }
+    return(result);
+}
+
+DGL_DEF uint32 *
+dgl_utf8_to_utf32(DGL_Mem_Arena *arena, uint8 *data, usize size, usize *count)
+{
+    uint32 *result = 0;
+    *count = 0;
+    if(dgl_utf8_validate(data, size))
+    {
+        uint32 *dest = dgl_mem_arena_push_array_no_zero(arena, uint32, size + 1);
+        usize out = 0;
+        usize index = 0;
+        while(index < size)
+        {
+#if DGL_SIMD_SSE4_1
+            if(index + 16 <= size)
+            {
+                __m128i input = _mm_loadu_si128(dgl_cast(__m128i *)(data + index));
+                uint32 non_ascii = dgl_cast(uint32)_mm_movemask_epi8(input);
+                usize ascii_count = non_ascii ? dgl_count_trailing_zeros_uint64(non_ascii) : 16;
+                if(ascii_count > 0)
+                {
+                    _mm_storeu_si128(dgl_cast(__m128i *)(dest + out), _mm_cvtepu8_epi32(input));
+                    _mm_storeu_si128(dgl_cast(__m128i *)(dest + out + 4), _mm_cvtepu8_epi32(_mm_srli_si128(input, 4)));
+                    _mm_storeu_si128(dgl_cast(__m128i *)(dest + out + 8), _mm_cvtepu8_epi32(_mm_srli_si128(input, 8)));
+                    _mm_storeu_si128(dgl_cast(__m128i *)(dest + out + 12), _mm_cvtepu8_epi32(_mm_srli_si128(input, 12)));
+                    index += ascii_count;
+                    out += ascii_count;
+                    continue;
+                }
+            }
+            bool32 stop_at_ascii = index + 16 <= size;
+#else
+            bool32 stop_at_ascii = false;
+#endif
+            usize block_end = dgl_min(index + 16, size);
+            while(index < block_end && !(stop_at_ascii && data[index] < 0x80))
+            {
+                index += dgl__utf8_decode(data + index, dest + out);
+                ++out;
+            }
+        }
+        dest[out] = 0;
+        result = dgl_mem_arena_resize_array(arena, uint32, dest, size + 1, out + 1);
+        *count = out;
+    }
+    return(result);
+}
+
+DGL_DEF uint8 *
+dgl_utf16_to_utf8(DGL_Mem_Arena *arena, uint16 *data, usize count, usize *size)
+{
+    uint8 *result = 0;
+    *size = 0;
+
+    // NOTE(dgl): Every unit becomes at most three bytes (a surrogate pair becomes four).
+    DGL_Mem_Temp_Arena temp = dgl_mem_arena_begin_temp(arena);
+    uint8 *dest = dgl_mem_arena_push_array_no_zero(arena, uint8, count * 3 + 1);
+    bool32 valid = true;
+    usize out = 0;
+    usize index = 0;
+    while(index < count && valid)
+    {
+#if DGL_SIMD_SSE4_1
+        if(index + 8 <= count)
+        {
+            // NOTE(dgl): packus saturates signed values, so clamp the units to 0x80 first. That leaves
+            // the top bit set for every unit that is not ASCII.
+            __m128i input = _mm_min_epu16(_mm_loadu_si128(dgl_cast(__m128i *)(data + index)), _mm_set1_epi16(0x80));
+            __m128i packed = _mm_packus_epi16(input, _mm_setzero_si128());
+            uint32 non_ascii = dgl_cast(uint32)_mm_movemask_epi8(packed);
+            usize ascii_count = non_ascii ? dgl_count_trailing_zeros_uint64(non_ascii) : 8;
+            if(ascii_count > 0)
+            {
+                _mm_storel_epi64(dgl_cast(__m128i *)(dest + out), packed);
+                index += ascii_count;
+                out += ascii_count;
+                continue;
+            }
+        }
+        bool32 stop_at_ascii = index + 8 <= count;
+#else
+        bool32 stop_at_ascii = false;
+#endif
+        usize block_end = dgl_min(index + 8, count);
+        while(index < block_end && valid && !(stop_at_ascii && data[index] < 0x80))
+        {
+            uint32 code_point = data[index++];
+            if(code_point >= 0xD800 && code_point <= 0xDFFF)
+            {
+                valid = code_point <= 0xDBFF && index < count && data[index] >= 0xDC00 && data[index] <= 0xDFFF;
+                if(valid)
+                {
+                    code_point = 0x10000 + ((code_point - 0xD800) << 10) + (data[index++] - 0xDC00u);
+                }
+            }
+            if(valid) { out += dgl__utf8_encode(dest + out, code_point); }
+        }
+    }
+
+    if(valid)
+    {
+        dest[out] = 0;
+        result = dgl_mem_arena_resize_array(arena, uint8, dest, count * 3 + 1, out + 1);
+        *size = out;
+    }
+    else
+    {
+        dgl_mem_arena_end_temp(temp);
+    }
+    return(result);
+}
+
+DGL_DEF uint8 *
+dgl_utf32_to_utf8(DGL_Mem_Arena *arena, uint32 *data, usize count, usize *size)
+{
+    uint8 *result = 0;
+    *size = 0;
+
+    DGL_Mem_Temp_Arena temp = dgl_mem_arena_begin_temp(arena);
+    uint8 *dest = dgl_mem_arena_push_array_no_zero(arena, uint8, count * 4 + 1);
+    bool32 valid = true;
+    usize out = 0;
+    usize index = 0;
+    while(index < count && valid)
+    {
+#if DGL_SIMD_SSE4_1
+        if(index + 8 <= count)
+        {
+            __m128i low = _mm_loadu_si128(dgl_cast(__m128i *)(data + index));
+            __m128i high = _mm_loadu_si128(dgl_cast(__m128i *)(data + index + 4));
+            __m128i high_bits = _mm_set1_epi32(dgl_cast(int32)0xFFFFFF80);
+            __m128i low_ascii = _mm_cmpeq_epi32(_mm_and_si128(low, high_bits), _mm_setzero_si128());
+            __m128i high_ascii = _mm_cmpeq_epi32(_mm_and_si128(high, high_bits), _mm_setzero_si128());
+            uint32 ascii = dgl_cast(uint32)(_mm_movemask_ps(_mm_castsi128_ps(low_ascii)) | (_mm_movemask_ps(_mm_castsi128_ps(high_ascii)) << 4));
+            usize ascii_count = ascii == 0xFF ? 8 : dgl_count_trailing_zeros_uint64(~ascii);
+            if(ascii_count > 0)
+            {
+                // NOTE(dgl): Only the ASCII prefix is kept, so the saturation of the rest does not matter.
+                __m128i packed = _mm_packus_epi32(low, high);
+                _mm_storel_epi64(dgl_cast(__m128i *)(dest + out), _mm_packus_epi16(packed, packed));
+                index += ascii_count;
+                out += ascii_count;
+                continue;
+            }
+        }
+        bool32 stop_at_ascii = index + 8 <= count;
+#else
+        bool32 stop_at_ascii = false;
+#endif
+        usize block_end = dgl_min(index + 8, count);
+        while(index < block_end && valid && !(stop_at_ascii && data[index] < 0x80))
+        {
+            uint32 code_point = data[index++];
+            valid = code_point <= 0x10FFFF && (code_point < 0xD800 || code_point > 0xDFFF);
+            if(valid) { out += dgl__utf8_encode(dest + out, code_point); }
+        }
+    }
+
+    if(valid)
+    {
+        dest[out] = 0;
+        result = dgl_mem_arena_resize_array(arena, uint8, dest, count * 4 + 1, out + 1);
+        *size = out;
+    }
+    else
+    {
+        dgl_mem_arena_end_temp(temp);
+    }
+    return(result);
+}
+
+#endif // DGL_NO_STRING
+
+//
+//  Hash
+//
+
+#ifndef DGL_NO_HASH
+
+#include <string.h>
+
+#define DGL__HASH_SECRET0 0x2D358DCCAA6C78A5ULL
+#define DGL__HASH_SECRET1 0x8BB84B93962EACC9ULL
+#define DGL__HASH_SECRET2 0x4B33A62ED433D4A3ULL
+#define DGL__HASH_SECRET3 0x4D5A2DA51DE1AA47ULL
+
+local_inline void
+dgl__hash_multiply(uint64 *a, uint64 *b)
+{
+#if COMPILER_MSVC
+    uint64 high;
+    *a = _umul128(*a, *b, &high);
+    *b = high;
+#else
+    __uint128_t product = dgl_cast(__uint128_t)*a * *b;
+    *a = dgl_cast(uint64)product;
+    *b = dgl_cast(uint64)(product >> 64);
+#endif
+}
+
+local_inline uint64
+dgl__hash_mix(uint64 a, uint64 b)
+{
+    dgl__hash_multiply(&a, &b);
+    uint64 result = a ^ b;
+    return(result);
+}
+
+local_inline uint64
+dgl__hash_read64(uint8 *data)
+{
+    uint64 result;
+    memcpy(&result, data, sizeof(result));
+    return(result);
+}
+
+local_inline uint64
+dgl__hash_read32(uint8 *data)
+{
+    uint32 result;
+    memcpy(&result, data, sizeof(result));
+    return(result);
+}
+
+local_inline uint64
+dgl__hash_finish(uint64 a, uint64 b, uint64 seed, uint64 size)
+{
+    a ^= DGL__HASH_SECRET1;
+    b ^= seed;
+    dgl__hash_multiply(&a, &b);
+    uint64 result = dgl__hash_mix(a ^ DGL__HASH_SECRET0 ^ size, b ^ DGL__HASH_SECRET1);
+    return(result);
+}
+
+internal uint64
+dgl__hash_short(uint8 *data, usize size, uint64 seed)
+{
+    dgl_assert(size <= 16, "Short hash only handles up to 16 bytes");
+    uint64 a = 0;
+    uint64 b = 0;
+    if(size >= 4)
+    {
+        // NOTE(dgl): Two (possibly overlapping) reads from the front and two from the back.
+        usize middle = (size >> 3) << 2;
+        a = (dgl__hash_read32(data) << 32) | dgl__hash_read32(data + middle);
+        b = (dgl__hash_read32(data + size - 4) << 32) | dgl__hash_read32(data + size - 4 - middle);
+    }
+    else if(size > 0)
+    {
+        a = (dgl_cast(uint64)data[0] << 16) | (dgl_cast(uint64)data[size >> 1] << 8) | data[size - 1];
+    }
+    uint64 result = dgl__hash_finish(a, b, seed, size);
+    return(result);
+}
+
+local_inline void
+dgl__hash_block(uint8 *data, uint64 *seed, uint64 *see1, uint64 *see2)
+{
+    *seed = dgl__hash_mix(dgl__hash_read64(data) ^ DGL__HASH_SECRET1, dgl__hash_read64(data + 8) ^ *seed);
+    *see1 = dgl__hash_mix(dgl__hash_read64(data + 16) ^ DGL__HASH_SECRET2, dgl__hash_read64(data + 24) ^ *see1);
+    *see2 = dgl__hash_mix(dgl__hash_read64(data + 32) ^ DGL__HASH_SECRET3, dgl__hash_read64(data + 40) ^ *see2);
+}
+
+// NOTE(dgl): Hashes the last 1-48 bytes. The final read may start up to 16 bytes before data.
+internal uint64
+dgl__hash_tail(uint8 *data, usize remaining, uint64 seed, uint64 total_size)
+{
+    while(remaining > 16)
+    {
+        seed = dgl__hash_mix(dgl__hash_read64(data) ^ DGL__HASH_SECRET1, dgl__hash_read64(data + 8) ^ seed);
+        data += 16;
+        remaining -= 16;
+    }
+    uint64 a = dgl__hash_read64(data + remaining - 16);
+    uint64 b = dgl__hash_read64(data + remaining - 8);
+    uint64 result = dgl__hash_finish(a, b, seed, total_size);
+    return(result);
+}
+
+DGL_DEF uint64
+dgl_hash_bytes(void *data, usize size, uint64 seed)
+{
+    uint8 *at = dgl_cast(uint8 *)data;
+    uint64 result;
+    seed ^= dgl__hash_mix(seed ^ DGL__HASH_SECRET0, DGL__HASH_SECRET1);
+
+    if(size <= 16)
+    {
+        result = dgl__hash_short(at, size, seed);
+    }
+    else
+    {
+        usize remaining = size;
+        if(remaining > 48)
+        {
+            uint64 see1 = seed;
+            uint64 see2 = seed;
+            do
+            {
+                dgl__hash_block(at, &seed, &see1, &see2);
+                at += 48;
+                remaining -= 48;
+            } while(remaining > 48);
+            seed ^= see1 ^ see2;
+        }
+        result = dgl__hash_tail(at, remaining, seed, size);
+    }
+
+    return(result);
+}
+
+DGL_DEF void
+dgl_hash_begin(DGL_Hash_State *state, uint64 seed)
 {
-    dgl_logger.get_time = time_func;
-    dgl_logger.lock = lock_func;
-    dgl_logger.initialized = true;
+    state->seed = seed ^ dgl__hash_mix(seed ^ DGL__HASH_SECRET0, DGL__HASH_SECRET1);
+    state->see1 = state->seed;
+    state->see2 = state->seed;
+    state->total_size = 0;
+    state->buffer_count = 0;
+    state->processed_blocks = false;
+}
+
+DGL_DEF void
+dgl_hash_update(DGL_Hash_State *state, void *data, usize size)
+{
+    uint8 *at = dgl_cast(uint8 *)data;
+    uint8 *pending = state->buffer + 16;
+    state->total_size += size;
+
+    // NOTE(dgl): A block is only processed if more input follows it, like the > 48 loop in
+    // dgl_hash_bytes.
+    if(state->buffer_count + size > 48)
+    {
+        if(state->buffer_count > 0)
+        {
+            usize fill = 48 - state->buffer_count;
+            memcpy(pending + state->buffer_count, at, fill);
+            at += fill;
+            size -= fill;
+            dgl__hash_block(pending, &state->seed, &state->see1, &state->see2);
+            memcpy(state->buffer, pending + 32, 16);
+            state->buffer_count = 0;
+            state->processed_blocks = true;
+        }
+
+        if(size > 48)
+        {
+            do
+            {
+                dgl__hash_block(at, &state->seed, &state->see1, &state->see2);
+                at += 48;
+                size -= 48;
+            } while(size > 48);
+            memcpy(state->buffer, at - 16, 16);
+            state->processed_blocks = true;
+        }
+    }
+
+    memcpy(pending + state->buffer_count, at, size);
+    state->buffer_count += size;
+}
+
+DGL_DEF uint64
+dgl_hash_end(DGL_Hash_State *state)
+{
+    uint64 result;
+    uint8 *pending = state->buffer + 16;
+    if(state->total_size <= 16)
+    {
+        result = dgl__hash_short(pending, state->buffer_count, state->seed);
+    }
+    else
+    {
+        uint64 seed = state->seed;
+        if(state->processed_blocks)
+        {
+            seed ^= state->see1 ^ state->see2;
+        }
+        result = dgl__hash_tail(pending, state->buffer_count, seed, state->total_size);
+    }
+    return(result);
+}
+
+#if DGL_SIMD_SSE4_1
+// NOTE(dgl): Four lanes absorb 64 bytes per iteration with one aes round each. The finalization
+// runs at least three more rounds over every lane before folding to 64 bits.
+DGL_TARGET_AES internal uint64
+dgl__hash_bytes_aes(uint8 *data, usize size, uint64 seed)
+{
+    __m128i key = _mm_set_epi64x(dgl_cast(int64)(seed ^ DGL__HASH_SECRET1), dgl_cast(int64)(seed ^ (size * DGL__HASH_SECRET0)));
+    __m128i lane0 = _mm_xor_si128(key, _mm_set_epi64x(dgl_cast(int64)DGL__HASH_SECRET0, dgl_cast(int64)DGL__HASH_SECRET1));
+    __m128i lane1 = _mm_xor_si128(key, _mm_set_epi64x(dgl_cast(int64)DGL__HASH_SECRET1, dgl_cast(int64)DGL__HASH_SECRET2));
+    __m128i lane2 = _mm_xor_si128(key, _mm_set_epi64x(dgl_cast(int64)DGL__HASH_SECRET2, dgl_cast(int64)DGL__HASH_SECRET3));
+    __m128i lane3 = _mm_xor_si128(key, _mm_set_epi64x(dgl_cast(int64)DGL__HASH_SECRET3, dgl_cast(int64)DGL__HASH_SECRET0));
+
+    if(size < 16)
+    {
+        uint8 block[16] = {};
+        memcpy(block, data, size);
+        lane0 = _mm_aesenc_si128(lane0, _mm_loadu_si128(dgl_cast(__m128i *)block));
+    }
+    else if(size <= 64)
+    {
+        // NOTE(dgl): Overlapping loads from both ends cover every byte.
+        uint8 *end = data + size;
+        uint8 *second = size > 32 ? data + 16 : data;
+        uint8 *third = size > 32 ? end - 32 : end - 16;
+        lane0 = _mm_aesenc_si128(lane0, _mm_loadu_si128(dgl_cast(__m128i *)data));
+        lane1 = _mm_aesenc_si128(lane1, _mm_loadu_si128(dgl_cast(__m128i *)second));
+        lane2 = _mm_aesenc_si128(lane2, _mm_loadu_si128(dgl_cast(__m128i *)third));
+        lane3 = _mm_aesenc_si128(lane3, _mm_loadu_si128(dgl_cast(__m128i *)(end - 16)));
+    }
+    else
+    {
+        uint8 *end = data + size;
+        while(data + 64 < end)
+        {
+            lane0 = _mm_aesenc_si128(lane0, _mm_loadu_si128(dgl_cast(__m128i *)data));
+            lane1 = _mm_aesenc_si128(lane1, _mm_loadu_si128(dgl_cast(__m128i *)(data + 16)));
+            lane2 = _mm_aesenc_si128(lane2, _mm_loadu_si128(dgl_cast(__m128i *)(data + 32)));
+            lane3 = _mm_aesenc_si128(lane3, _mm_loadu_si128(dgl_cast(__m128i *)(data + 48)));
+            data += 64;
+        }
+        lane0 = _mm_aesenc_si128(lane0, _mm_loadu_si128(dgl_cast(__m128i *)(end - 64)));
+        lane1 = _mm_aesenc_si128(lane1, _mm_loadu_si128(dgl_cast(__m128i *)(end - 48)));
+        lane2 = _mm_aesenc_si128(lane2, _mm_loadu_si128(dgl_cast(__m128i *)(end - 32)));
+        lane3 = _mm_aesenc_si128(lane3, _mm_loadu_si128(dgl_cast(__m128i *)(end - 16)));
+    }
+
+    __m128i combined = _mm_aesenc_si128(_mm_aesenc_si128(lane0, lane1), _mm_aesenc_si128(lane2, lane3));
+    combined = _mm_aesenc_si128(combined, key);
+    combined = _mm_aesenc_si128(combined, lane0);
+    combined = _mm_aesenc_si128(combined, key);
+    uint64 result = dgl_cast(uint64)(_mm_cvtsi128_si64(combined) ^ _mm_extract_epi64(combined, 1));
+    return(result);
+}
+#endif
+
+DGL_DEF uint64
+dgl_hash_bytes_aes(void *data, usize size, uint64 seed)
+{
+    dgl_assert(dgl_cpu_features() & DGL_CPU_FEATURE_AES, "The cpu does not support AES-NI");
+    uint64 result;
+#if DGL_SIMD_SSE4_1
+    result = dgl__hash_bytes_aes(dgl_cast(uint8 *)data, size, seed);
+#else
+    result = dgl_hash_bytes(data, size, seed);
+#endif
+    return(result);
+}
+
+DGL_DEF uint64
+dgl_hash_bytes_fast(void *data, usize size, uint64 seed)
+{
+    uint64 result;
+#if DGL_SIMD_SSE4_1
+    // NOTE(dgl): The aes variant only pays off for longer keys.
+    if(size > 128 && (dgl_cpu_features() & DGL_CPU_FEATURE_AES))
+    {
+        result = dgl__hash_bytes_aes(dgl_cast(uint8 *)data, size, seed);
+    }
+    else
+#endif
+    {
+        result = dgl_hash_bytes(data, size, seed);
+    }
+    return(result);
+}
+
+#endif // DGL_NO_HASH
+
+//
+//  Intern
+//
+
+#ifndef DGL_NO_INTERN
+
+#include <string.h> // memcmp
+
+#define DGL__INTERN_EMPTY 0x80
+#define DGL__INTERN_GROUP_SIZE 16
+#define DGL__INTERN_SEED 0x1D8E4E27C47D124FULL
+
+// NOTE(dgl): Bit i is set if control byte i of the group equals tag.
+internal uint32
+dgl__intern_match_group(uint8 *group, uint8 tag)
+{
+#if DGL_SIMD_SSE4_1
+    __m128i control = _mm_loadu_si128(dgl_cast(__m128i *)group);
+    uint32 result = dgl_cast(uint32)_mm_movemask_epi8(_mm_cmpeq_epi8(control, _mm_set1_epi8(dgl_cast(char)tag)));
+#else
+    uint32 result = 0;
+    for(uint32 index = 0; index < DGL__INTERN_GROUP_SIZE; ++index)
+    {
+        result |= dgl_cast(uint32)(group[index] == tag) << index;
+    }
+#endif
+    return(result);
+}
+
+internal usize
+dgl__intern_capacity_for(usize count)
+{
+    // NOTE(dgl): Keep the load factor at or below 7/8.
+    usize result = DGL__INTERN_GROUP_SIZE;
+    while(result * 7 < count * 8) { result *= 2; }
+    return(result);
+}
+
+internal void
+dgl__intern_set_control(DGL_Intern_Table *table, usize slot, uint8 tag)
+{
+    table->control[slot] = tag;
+    if(slot < DGL__INTERN_GROUP_SIZE) { table->control[table->capacity + slot] = tag; }
+}
+
+internal void
+dgl__intern_alloc_slots(DGL_Intern_Table *table, usize capacity)
+{
+    table->capacity = capacity;
+    table->control = dgl_mem_arena_push_array_no_zero(table->arena, uint8, capacity + DGL__INTERN_GROUP_SIZE);
+    table->slots = dgl_mem_arena_push_array_no_zero(table->arena, DGL_Intern_Id, capacity);
+    dgl_memset(table->control, DGL__INTERN_EMPTY, capacity + DGL__INTERN_GROUP_SIZE);
+}
+
+internal void
+dgl__intern_reserve(DGL_Intern_Table *table, usize count)
+{
+    if(count > table->entry_capacity)
+    {
+        usize entry_capacity = dgl_max(count, table->entry_capacity * 2);
+        table->entries = dgl_mem_arena_resize_array(table->arena, DGL_Intern_Entry, table->entries, table->entry_capacity, entry_capacity);
+        table->entry_capacity = entry_capacity;
+    }
+
+    usize capacity = dgl__intern_capacity_for(count);
+    if(capacity > table->capacity)
+    {
+        // NOTE(dgl): Strings are unique, so the entries can be placed without comparing.
+        dgl__intern_alloc_slots(table, capacity);
+        usize mask = capacity - 1;
+        for(usize index = 0; index < table->count; ++index)
+        {
+            uint64 hash = table->entries[index].hash;
+            usize position = hash & mask;
+            uint32 empty;
+            while(!(empty = dgl__intern_match_group(table->control + position, DGL__INTERN_EMPTY)))
+            {
+                position = (position + DGL__INTERN_GROUP_SIZE) & mask;
+            }
+            usize slot = (position + dgl_count_trailing_zeros_uint64(empty)) & mask;
+            dgl__intern_set_control(table, slot, dgl_cast(uint8)(hash >> 57));
+            table->slots[slot] = dgl_cast(DGL_Intern_Id)(index + 1);
+        }
+    }
+}
+
+internal DGL_Intern_Id
+dgl__intern_lookup(DGL_Intern_Table *table, char *string, usize length, uint64 hash, bool32 insert)
+{
+    DGL_Intern_Id result = 0;
+    if(insert) { dgl__intern_reserve(table, table->count + 1); }
+
+    usize mask = table->capacity - 1;
+    uint8 tag = dgl_cast(uint8)(hash >> 57);
+    usize position = hash & mask;
+    for(;;)
+    {
+        uint8 *group = table->control + position;
+        for(uint32 matches = dgl__intern_match_group(group, tag); matches && !result; matches &= matches - 1)
+        {
+            usize slot = (position + dgl_count_trailing_zeros_uint64(matches)) & mask;
+            DGL_Intern_Entry *entry = table->entries + (table->slots[slot] - 1);
+            if(entry->hash == hash && entry->length == length && memcmp(entry->string, string, length) == 0)
+            {
+                result = table->slots[slot];
+            }
+        }
+
+        uint32 empty = result ? 0 : dgl__intern_match_group(group, DGL__INTERN_EMPTY);
+        if(result || empty)
+        {
+            if(!result && insert)
+            {
+                DGL_Intern_Entry *entry = table->entries + table->count++;
+                entry->string = dgl_mem_arena_push_array_no_zero(table->arena, char, length + 1);
+                dgl_memcpy(entry->string, string, length);
+                entry->string[length] = '\0';
+                entry->length = length;
+                entry->hash = hash;
+
+                usize slot = (position + dgl_count_trailing_zeros_uint64(empty)) & mask;
+                result = dgl_cast(DGL_Intern_Id)table->count;
+                dgl__intern_set_control(table, slot, tag);
+                table->slots[slot] = result;
+            }
+            break;
+        }
+        position = (position + DGL__INTERN_GROUP_SIZE) & mask;
+    }
+    return(result);
+}
+
+DGL_DEF void
+dgl_intern_init(DGL_Intern_Table *table, DGL_Mem_Arena *arena, usize initial_count)
+{
+    table->arena = arena;
+    table->count = 0;
+    table->entry_capacity = dgl_max(initial_count, DGL__INTERN_GROUP_SIZE);
+    table->entries = dgl_mem_arena_push_array_no_zero(arena, DGL_Intern_Entry, table->entry_capacity);
+    dgl__intern_alloc_slots(table, dgl__intern_capacity_for(initial_count));
+}
+
+DGL_DEF DGL_Intern_Id
+dgl_intern(DGL_Intern_Table *table, char *string, usize length)
+{
+    uint64 hash = dgl_hash_bytes(string, length, DGL__INTERN_SEED);
+    DGL_Intern_Id result = dgl__intern_lookup(table, string, length, hash, true);
+    return(result);
+}
+
+DGL_DEF DGL_Intern_Id
+dgl_intern_find(DGL_Intern_Table *table, char *string, usize length)
+{
+    uint64 hash = dgl_hash_bytes(string, length, DGL__INTERN_SEED);
+    DGL_Intern_Id result = dgl__intern_lookup(table, string, length, hash, false);
+    return(result);
+}
+
+DGL_DEF void
+dgl_intern_bulk(DGL_Intern_Table *table, char **strings, usize *lengths, usize count, DGL_Intern_Id *ids)
+{
+    dgl__intern_reserve(table, table->count + count);
+
+    // NOTE(dgl): Hash one string ahead and prefetch its group while the current one is probed.
+    usize next_length = count > 0 ? (lengths ? lengths[0] : dgl_string_length(strings[0])) : 0;
+    uint64 next_hash = count > 0 ? dgl_hash_bytes(strings[0], next_length, DGL__INTERN_SEED) : 0;
+    for(usize index = 0; index < count; ++index)
+    {
+        usize length = next_length;
+        uint64 hash = next_hash;
+        if(index + 1 < count)
+        {
+            next_length = lengths ? lengths[index + 1] : dgl_string_length(strings[index + 1]);
+            next_hash = dgl_hash_bytes(strings[index + 1], next_length, DGL__INTERN_SEED);
+            _mm_prefetch(dgl_cast(char *)(table->control + (next_hash & (table->capacity - 1))), _MM_HINT_T0);
+        }
+        ids[index] = dgl__intern_lookup(table, strings[index], length, hash, true);
+    }
+}
+
+// NOTE(dgl): The shard comes from the middle bits, the table uses the low bits for the position
+// and the high bits for the tag.
+#define dgl__intern_shard_of(hash) (dgl_cast(uint32)((hash) >> 32) & (DGL_INTERN_SHARD_COUNT - 1))
+
+local_inline DGL_Intern_Id
+dgl__intern_shared_id(DGL_Intern_Id id, uint32 shard)
+{
+    dgl_assert(id <= DGL_INTERN_SHARD_ID_MAX, "Intern shard is full, the shared id would wrap");
+    DGL_Intern_Id result = id ? (id << DGL_INTERN_SHARD_BITS) | shard : 0;
+    return(result);
+}
+
+internal void
+dgl__intern_lock(uint32 volatile *lock)
+{
+    while(dgl_atomic_compare_exchange_uint32(lock, 1, 0) != 0) { _mm_pause(); }
+}
+
+internal void
+dgl__intern_unlock(uint32 volatile *lock)
+{
+    dgl_atomic_compare_exchange_uint32(lock, 0, 1);
+}
+
+DGL_DEF void
+dgl_intern_shared_init(DGL_Intern_Shared *shared, uint8 *base, usize size, usize initial_count)
+{
+    usize shard_size = size / DGL_INTERN_SHARD_COUNT;
+    for(uint32 index = 0; index < DGL_INTERN_SHARD_COUNT; ++index)
+    {
+        dgl_mem_arena_init(shared->arenas + index, base + index * shard_size, shard_size);
+        dgl_intern_init(shared->shards + index, shared->arenas + index, initial_count / DGL_INTERN_SHARD_COUNT);
+        shared->locks[index] = 0;
+    }
+}
+
+internal DGL_Intern_Id
+dgl__intern_shared_lookup(DGL_Intern_Shared *shared, char *string, usize length, bool32 insert)
+{
+    uint64 hash = dgl_hash_bytes(string, length, DGL__INTERN_SEED);
+    uint32 shard = dgl__intern_shard_of(hash);
+
+    dgl__intern_lock(shared->locks + shard);
+    DGL_Intern_Id id = dgl__intern_lookup(shared->shards + shard, string, length, hash, insert);
+    dgl__intern_unlock(shared->locks + shard);
+
+    DGL_Intern_Id result = dgl__intern_shared_id(id, shard);
+    return(result);
+}
+
+DGL_DEF DGL_Intern_Id
+dgl_intern_shared(DGL_Intern_Shared *shared, char *string, usize length)
+{
+    DGL_Intern_Id result = dgl__intern_shared_lookup(shared, string, length, true);
+    return(result);
+}
+
+DGL_DEF DGL_Intern_Id
+dgl_intern_shared_find(DGL_Intern_Shared *shared, char *string, usize length)
+{
+    DGL_Intern_Id result = dgl__intern_shared_lookup(shared, string, length, false);
+    return(result);
+}
+
+DGL_DEF void
+dgl_intern_shared_bulk(DGL_Intern_Shared *shared, char **strings, usize *lengths, usize count, DGL_Intern_Id *ids)
+{
+    // NOTE(dgl): First store the shard of every string in ids, then take every lock only once.
+    // Final ids are always larger than the shard count, so both can share the array.
+    usize shard_counts[DGL_INTERN_SHARD_COUNT] = {};
+    for(usize index = 0; index < count; ++index)
+    {
+        usize length = lengths ? lengths[index] : dgl_string_length(strings[index]);
+        uint32 shard = dgl__intern_shard_of(dgl_hash_bytes(strings[index], length, DGL__INTERN_SEED));
+        ids[index] = shard;
+        ++shard_counts[shard];
+    }
+
+    for(uint32 shard = 0; shard < DGL_INTERN_SHARD_COUNT; ++shard)
+    {
+        if(shard_counts[shard] == 0) { continue; }
+
+        DGL_Intern_Table *table = shared->shards + shard;
+        dgl__intern_lock(shared->locks + shard);
+        dgl__intern_reserve(table, table->count + shard_counts[shard]);
+        for(usize index = 0; index < count; ++index)
+        {
+            if(ids[index] == shard)
+            {
+                usize length = lengths ? lengths[index] : dgl_string_length(strings[index]);
+                uint64 hash = dgl_hash_bytes(strings[index], length, DGL__INTERN_SEED);
+                DGL_Intern_Id id = dgl__intern_lookup(table, strings[index], length, hash, true);
+                ids[index] = dgl__intern_shared_id(id, shard);
+            }
+        }
+        dgl__intern_unlock(shared->locks + shard);
+    }
+}
+
+DGL_DEF char *
+dgl_intern_shared_string(DGL_Intern_Shared *shared, DGL_Intern_Id id)
+{
+    uint32 shard = id & (DGL_INTERN_SHARD_COUNT - 1);
+    dgl__intern_lock(shared->locks + shard);
+    char *result = dgl_intern_string(shared->shards + shard, id >> DGL_INTERN_SHARD_BITS);
+    dgl__intern_unlock(shared->locks + shard);
+    return(result);
 }
 
-DGL_DEF void
-dgl_log_init(dgl_time_in_ms_F time_func)
+#endif // DGL_NO_INTERN
+
+//
+//  Bitset
+//
+
+#ifndef DGL_NO_BITSET
+
+#define DGL__BITSET_OP_AND 0
+#define DGL__BITSET_OP_OR 1
+#define DGL__BITSET_OP_XOR 2
+#define DGL__BITSET_OP_ANDNOT 3
+
+DGL_DEF DGL_Bitset
+dgl_bitset_init(DGL_Mem_Arena *arena, usize bit_count)
 {
-    dgl_log_init_threadsafe(time_func, 0);
+    DGL_Bitset result;
+    result.bit_count = bit_count;
+    result.word_count = (((bit_count + 63) / 64) + 3) & ~dgl_cast(usize)3;
+    result.words = dgl_cast(uint64 *)dgl_mem_arena_alloc_align(arena, result.word_count * sizeof(uint64), 32);
+    return(result);
 }
 
-
 DGL_DEF void
-dgl__lock()
+dgl_bitset_clear_all(DGL_Bitset *bitset)
 {
-  if (dgl_logger.lock) { dgl_logger.lock(true); }
+    dgl_memset(bitset->words, 0, bitset->word_count * sizeof(uint64));
 }
 
 DGL_DEF void
-dgl__unlock()
+dgl_bitset_set_all(DGL_Bitset *bitset)
 {
-    if (dgl_logger.lock) { dgl_logger.lock(false); }
+    usize full_words = bitset->bit_count / 64;
+    dgl_memset(bitset->words, 0xFF, full_words * sizeof(uint64));
+    dgl_memset(bitset->words + full_words, 0, (bitset->word_count - full_words) * sizeof(uint64));
+    if(bitset->bit_count % 64)
+    {
+        bitset->words[full_words] = (1ULL << (bitset->bit_count % 64)) - 1;
+    }
 }
 
-void
-dgl__log_internal(char *file, int32 line, char *fmt, ...)
+local_inline uint64
+dgl__bitset_op(uint64 a, uint64 b, uint32 op)
 {
-    if(dgl_logger.initialized)
+    uint64 result;
+    switch(op)
     {
-       dgl_assert(dgl_logger.get_time, "time_in_ms must be a valid function");
-       int64 milliseconds = dgl_logger.get_time();
-       int32 seconds = dgl_cast(int32)(milliseconds / 1000);
-       milliseconds = milliseconds % 1000;
-       int32 minutes = seconds / 60;
-       seconds = seconds % 60;
-       int32 hours = minutes / 60;
-       minutes = minutes % 60;
+        case DGL__BITSET_OP_AND: { result = a & b; } break;
+        case DGL__BITSET_OP_OR: { result = a | b; } break;
+        case DGL__BITSET_OP_XOR: { result = a ^ b; } break;
+        default: { result = a & ~b; } break;
+    }
+    return(result);
+}
 
-       dgl__lock();
-       if(file)
-       {
-           fprintf(stdout, "%02d:%02d:%02d.%04lld %s:%d: ", hours, minutes, seconds, milliseconds, file, line);
-       }
-       else
-       {
-           fprintf(stdout, "%02d:%02d:%02d.%04lld: ", hours, minutes, seconds, milliseconds);
-       }
+#if DGL_SIMD_SSE4_1
+// NOTE(dgl): Population count of every byte with a lookup of the two nibbles. The byte counts are
+// summed into the two 64 bit lanes with psadbw.
+local_inline __m128i
+dgl__bitset_popcount_128(__m128i value)
+{
+    __m128i lookup = _mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    __m128i low_mask = _mm_set1_epi8(0x0F);
+    __m128i low = _mm_shuffle_epi8(lookup, _mm_and_si128(value, low_mask));
+    __m128i high = _mm_shuffle_epi8(lookup, _mm_and_si128(_mm_srli_epi16(value, 4), low_mask));
+    __m128i result = _mm_sad_epu8(_mm_add_epi8(low, high), _mm_setzero_si128());
+    return(result);
+}
 
-       va_list ap;
-       va_start(ap, fmt);
-       vfprintf(stdout, fmt, ap);
-       fprintf(stdout, "\n");
-       fflush(stdout);
-       va_end(ap);
-       dgl__unlock();
-    }
-    else
+local_inline __m128i
+dgl__bitset_op_128(__m128i a, __m128i b, uint32 op)
+{
+    __m128i result;
+    switch(op)
     {
-       //fprintf(stdout, "Failed to write log at %s:%d (Logger must be initialized)\n", file, line);
+        case DGL__BITSET_OP_AND: { result = _mm_and_si128(a, b); } break;
+        case DGL__BITSET_OP_OR: { result = _mm_or_si128(a, b); } break;
+        case DGL__BITSET_OP_XOR: { result = _mm_xor_si128(a, b); } break;
+        default: { result = _mm_andnot_si128(b, a); } break;
     }
+    return(result);
+}
 
+DGL_TARGET_AVX2 internal __m256i
+dgl__bitset_popcount_256(__m256i value)
+{
+    __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                      0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    __m256i low_mask = _mm256_set1_epi8(0x0F);
+    __m256i low = _mm256_shuffle_epi8(lookup, _mm256_and_si256(value, low_mask));
+    __m256i high = _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(value, 4), low_mask));
+    __m256i result = _mm256_sad_epu8(_mm256_add_epi8(low, high), _mm256_setzero_si256());
+    return(result);
 }
 
-#endif // DGL_NO_LOG
+DGL_TARGET_AVX2 internal uint64
+dgl__bitset_sum_256(__m256i value)
+{
+    __m128i sum = _mm_add_epi64(_mm256_castsi256_si128(value), _mm256_extracti128_si256(value, 1));
+    uint64 result = dgl_cast(uint64)_mm_cvtsi128_si64(sum) + dgl_cast(uint64)_mm_extract_epi64(sum, 1);
+    return(result);
+}
 
-//
-// Memory
-//
-#ifndef DGL_NO_MEMORY
+// NOTE(dgl): Counts blocks of four words and returns how many words it counted.
+DGL_TARGET_AVX2 internal usize
+dgl__bitset_count_avx2(uint64 *words, usize word_count, usize *count)
+{
+    usize index = 0;
+    __m256i total = _mm256_setzero_si256();
+    for(; index + 4 <= word_count; index += 4)
+    {
+        __m256i value = _mm256_loadu_si256(dgl_cast(__m256i *)(words + index));
+        total = _mm256_add_epi64(total, dgl__bitset_popcount_256(value));
+    }
+    *count += dgl__bitset_sum_256(total);
+    return(index);
+}
 
-#ifndef DGL_LOG
-#define DGL_LOG(...)
+DGL_TARGET_AVX2 internal usize
+dgl__bitset_combine_avx2(uint64 *dest, uint64 *a, uint64 *b, usize word_count, uint32 op, usize *count)
+{
+    usize index = 0;
+    __m256i total = _mm256_setzero_si256();
+    for(; index + 4 <= word_count; index += 4)
+    {
+        __m256i value_a = _mm256_loadu_si256(dgl_cast(__m256i *)(a + index));
+        __m256i value_b = _mm256_loadu_si256(dgl_cast(__m256i *)(b + index));
+        __m256i value;
+        switch(op)
+        {
+            case DGL__BITSET_OP_AND: { value = _mm256_and_si256(value_a, value_b); } break;
+            case DGL__BITSET_OP_OR: { value = _mm256_or_si256(value_a, value_b); } break;
+            case DGL__BITSET_OP_XOR: { value = _mm256_xor_si256(value_a, value_b); } break;
+            default: { value = _mm256_andnot_si256(value_b, value_a); } break;
+        }
+        _mm256_storeu_si256(dgl_cast(__m256i *)(dest + index), value);
+        total = _mm256_add_epi64(total, dgl__bitset_popcount_256(value));
+    }
+    *count += dgl__bitset_sum_256(total);
+    return(index);
+}
+#endif // DGL_SIMD_SSE4_1
+
+internal usize
+dgl__bitset_count_words(uint64 *words, usize word_count)
+{
+    usize result = 0;
+    usize index = 0;
+#if DGL_SIMD_SSE4_1
+    if(dgl_cpu_features() & DGL_CPU_FEATURE_AVX2)
+    {
+        index = dgl__bitset_count_avx2(words, word_count, &result);
+    }
+    __m128i total = _mm_setzero_si128();
+    for(; index + 2 <= word_count; index += 2)
+    {
+        __m128i value = _mm_loadu_si128(dgl_cast(__m128i *)(words + index));
+        total = _mm_add_epi64(total, dgl__bitset_popcount_128(value));
+    }
+    result += dgl_cast(usize)(_mm_cvtsi128_si64(total) + _mm_extract_epi64(total, 1));
 #endif
+    for(; index < word_count; ++index)
+    {
+        result += dgl_count_set_bits_uint64(words[index]);
+    }
+    return(result);
+}
 
-#ifndef DGL_LOG_DEBUG
-#define DGL_LOG_DEBUG(...)
+internal usize
+dgl__bitset_combine(DGL_Bitset *dest, DGL_Bitset *a, DGL_Bitset *b, uint32 op)
+{
+    dgl_assert(dest->bit_count == a->bit_count && a->bit_count == b->bit_count, "Bitsets need the same size");
+    usize result = 0;
+    usize index = 0;
+    usize word_count = a->word_count;
+#if DGL_SIMD_SSE4_1
+    if(dgl_cpu_features() & DGL_CPU_FEATURE_AVX2)
+    {
+        index = dgl__bitset_combine_avx2(dest->words, a->words, b->words, word_count, op, &result);
+    }
+    __m128i total = _mm_setzero_si128();
+    for(; index + 2 <= word_count; index += 2)
+    {
+        __m128i value_a = _mm_loadu_si128(dgl_cast(__m128i *)(a->words + index));
+        __m128i value_b = _mm_loadu_si128(dgl_cast(__m128i *)(b->words + index));
+        __m128i value = dgl__bitset_op_128(value_a, value_b, op);
+        _mm_storeu_si128(dgl_cast(__m128i *)(dest->words + index), value);
+        total = _mm_add_epi64(total, dgl__bitset_popcount_128(value));
+    }
+    result += dgl_cast(usize)(_mm_cvtsi128_si64(total) + _mm_extract_epi64(total, 1));
 #endif
+    for(; index < word_count; ++index)
+    {
+        uint64 value = dgl__bitset_op(a->words[index], b->words[index], op);
+        dest->words[index] = value;
+        result += dgl_count_set_bits_uint64(value);
+    }
+    return(result);
+}
 
-#include <string.h>
-DGL_DEF uintptr
-dgl__align_forward_uintptr(uintptr base, usize align)
+DGL_DEF usize
+dgl_bitset_count(DGL_Bitset *bitset)
 {
-    uintptr result = base;
+    usize result = dgl__bitset_count_words(bitset->words, bitset->word_count);
+    return(result);
+}
 
-    dgl_assert((align & (align - 1)) == 0, "Alignment has to be a power of two");
-    // Same as (base % align) but faster as 'align' is a power of two
-    uintptr modulo = base & (dgl_cast(uintptr)align - 1);
+DGL_DEF usize
+dgl_bitset_rank(DGL_Bitset *bitset, usize index)
+{
+    dgl_assert(index <= bitset->bit_count, "Bit index out of range");
+    usize word_index = index / 64;
+    usize result = dgl__bitset_count_words(bitset->words, word_index);
+    if(index % 64)
+    {
+        result += dgl_count_set_bits_uint64(bitset->words[word_index] & ((1ULL << (index % 64)) - 1));
+    }
+    return(result);
+}
 
-    if(modulo != 0)
+DGL_DEF usize
+dgl_bitset_select(DGL_Bitset *bitset, usize rank)
+{
+    usize result = bitset->bit_count;
+    for(usize word_index = 0; word_index < bitset->word_count; ++word_index)
     {
-        result += (align - modulo);
+        uint64 word = bitset->words[word_index];
+        usize count = dgl_count_set_bits_uint64(word);
+        if(rank < count)
+        {
+            for(; rank > 0; --rank)
+            {
+                word &= word - 1;
+            }
+            result = word_index * 64 + dgl_count_trailing_zeros_uint64(word);
+            break;
+        }
+        rank -= count;
     }
+    return(result);
+}
 
+DGL_DEF usize
+dgl_bitset_find_next_set(DGL_Bitset *bitset, usize from)
+{
+    usize result = bitset->bit_count;
+    if(from < bitset->bit_count)
+    {
+        usize word_index = from / 64;
+        uint64 word = bitset->words[word_index] & (~0ULL << (from % 64));
+        while(!word && ++word_index < bitset->word_count)
+        {
+            word = bitset->words[word_index];
+        }
+        if(word)
+        {
+            result = word_index * 64 + dgl_count_trailing_zeros_uint64(word);
+        }
+    }
     return(result);
 }
 
-DGL_DEF DGL_Mem_Index
-dgl__align_forward_memory_index(DGL_Mem_Index size, usize align)
+DGL_DEF usize
+dgl_bitset_find_next_unset(DGL_Bitset *bitset, usize from)
 {
-    DGL_Mem_Index result = size;
+    usize result = bitset->bit_count;
+    if(from < bitset->bit_count)
+    {
+        usize word_index = from / 64;
+        uint64 word = ~bitset->words[word_index] & (~0ULL << (from % 64));
+        while(!word && ++word_index < bitset->word_count)
+        {
+            word = ~bitset->words[word_index];
+        }
+        // NOTE(dgl): The bits after bit_count are zero, they can be found here and are clamped.
+        if(word)
+        {
+            result = dgl_min(word_index * 64 + dgl_count_trailing_zeros_uint64(word), bitset->bit_count);
+        }
+    }
+    return(result);
+}
 
-    dgl_assert((align & (align - 1)) == 0, "Alignment has to be a power of two");
+DGL_DEF usize
+dgl_bitset_and(DGL_Bitset *dest, DGL_Bitset *a, DGL_Bitset *b)
+{
+    usize result = dgl__bitset_combine(dest, a, b, DGL__BITSET_OP_AND);
+    return(result);
+}
 
-    DGL_Mem_Index modulo = size & (align - 1);
+DGL_DEF usize
+dgl_bitset_or(DGL_Bitset *dest, DGL_Bitset *a, DGL_Bitset *b)
+{
+    usize result = dgl__bitset_combine(dest, a, b, DGL__BITSET_OP_OR);
+    return(result);
+}
 
-    if(modulo != 0)
+DGL_DEF usize
+dgl_bitset_xor(DGL_Bitset *dest, DGL_Bitset *a, DGL_Bitset *b)
+{
+    usize result = dgl__bitset_combine(dest, a, b, DGL__BITSET_OP_XOR);
+    return(result);
+}
+
+DGL_DEF usize
+dgl_bitset_andnot(DGL_Bitset *dest, DGL_Bitset *a, DGL_Bitset *b)
+{
+    usize result = dgl__bitset_combine(dest, a, b, DGL__BITSET_OP_ANDNOT);
+    return(result);
+}
+
+#endif // DGL_NO_BITSET
+
+//
+//  Sort
+//
+
+#ifndef DGL_NO_SORT
+
+#define DGL__SORT_KEYS_UNSIGNED 0
+#define DGL__SORT_KEYS_SIGNED 1
+#define DGL__SORT_KEYS_REAL 2
+
+internal void
+dgl__sort_map_keys_uint32(uint32 *keys, usize count, uint32 key_type, bool32 inverse)
+{
+    if(key_type == DGL__SORT_KEYS_SIGNED)
     {
-        result += (align - modulo);
+        for(usize index = 0; index < count; ++index) { keys[index] ^= 0x80000000u; }
+    }
+    else if(key_type == DGL__SORT_KEYS_REAL)
+    {
+        // NOTE(dgl): Flip all bits of negative values and only the sign bit of positive values.
+        for(usize index = 0; index < count; ++index)
+        {
+            uint32 key = keys[index];
+            uint32 mask = inverse ? ((key >> 31) - 1) | 0x80000000u : dgl_cast(uint32)(dgl_cast(int32)key >> 31) | 0x80000000u;
+            keys[index] = key ^ mask;
+        }
     }
+}
 
-    return(result);
+internal void
+dgl__sort_map_keys_uint64(uint64 *keys, usize count, uint32 key_type, bool32 inverse)
+{
+    if(key_type == DGL__SORT_KEYS_SIGNED)
+    {
+        for(usize index = 0; index < count; ++index) { keys[index] ^= 0x8000000000000000ULL; }
+    }
+    else if(key_type == DGL__SORT_KEYS_REAL)
+    {
+        for(usize index = 0; index < count; ++index)
+        {
+            uint64 key = keys[index];
+            uint64 mask = inverse ? ((key >> 63) - 1) | 0x8000000000000000ULL : dgl_cast(uint64)(dgl_cast(int64)key >> 63) | 0x8000000000000000ULL;
+            keys[index] = key ^ mask;
+        }
+    }
 }
 
-void
-dgl_mem_arena_init(DGL_Mem_Arena *arena, uint8 *base, DGL_Mem_Index size)
+internal void
+dgl__insertion_sort_uint32(uint32 *keys, uint32 *values, usize count)
 {
-    arena->size = size;
-    arena->base = base;
-    arena->curr_offset = 0;
-    arena->prev_offset = 0;
+    for(usize index = 1; index < count; ++index)
+    {
+        uint32 key = keys[index];
+        uint32 value = values ? values[index] : 0;
+        usize at = index;
+        while(at > 0 && keys[at - 1] > key)
+        {
+            keys[at] = keys[at - 1];
+            if(values) { values[at] = values[at - 1]; }
+            --at;
+        }
+        keys[at] = key;
+        if(values) { values[at] = value; }
+    }
 }
 
-DGL_DEF void *
-dgl_mem_arena_alloc_align(DGL_Mem_Arena *arena, DGL_Mem_Index size, usize align)
+internal void
+dgl__insertion_sort_uint64(uint64 *keys, uint64 *values, usize count)
 {
-    uintptr curr_ptr = dgl_cast(uintptr)(arena->base + arena->curr_offset);
-    uintptr new_ptr = dgl__align_forward_uintptr(curr_ptr, align);
+    for(usize index = 1; index < count; ++index)
+    {
+        uint64 key = keys[index];
+        uint64 value = values ? values[index] : 0;
+        usize at = index;
+        while(at > 0 && keys[at - 1] > key)
+        {
+            keys[at] = keys[at - 1];
+            if(values) { values[at] = values[at - 1]; }
+            --at;
+        }
+        keys[at] = key;
+        if(values) { values[at] = value; }
+    }
+}
 
-    DGL_Mem_Index offset = dgl_cast(DGL_Mem_Index)(new_ptr - dgl_cast(uintptr)arena->base); // revert back to relative offset
+// NOTE(dgl): Turns the digit counts into start offsets. Returns false if all keys have the same
+// digit, in which case the pass does not change the order and can be skipped.
+internal bool32
+dgl__sort_prefix_sum(usize *histogram, usize count)
+{
+    bool32 result = true;
+    usize offset = 0;
+    for(uint32 digit = 0; digit < 256; ++digit)
+    {
+        usize digit_count = histogram[digit];
+        if(digit_count == count) { result = false; }
+        histogram[digit] = offset;
+        offset += digit_count;
+    }
+    return(result);
+}
 
-    dgl_assert((offset + size) <= arena->size, "Arena overflow. Cannot allocate size");
+internal void
+dgl__radix_sort_uint32(uint32 *keys, uint32 *values, usize count, DGL_Mem_Arena *scratch)
+{
+    if(count <= DGL_SORT_INSERTION_THRESHOLD)
+    {
+        dgl__insertion_sort_uint32(keys, values, count);
+        return;
+    }
 
-    void *result = arena->base + offset;
-    arena->prev_offset = offset;
-    arena->curr_offset = offset + size;
+    DGL_Mem_Temp_Arena temp = dgl_mem_arena_begin_temp(scratch);
+    usize *histograms = dgl_mem_arena_push_array(scratch, usize, 4 * 256);
+    uint32 *key_buffer = dgl_mem_arena_push_array_no_zero(scratch, uint32, count);
+    uint32 *value_buffer = values ? dgl_mem_arena_push_array_no_zero(scratch, uint32, count) : 0;
 
-    // Zero new memory by default (we do not zero the memory on init or free_all)
-    dgl_memset(result, 0, size);
+    for(usize index = 0; index < count; ++index)
+    {
+        uint32 key = keys[index];
+        ++histograms[0*256 + (key & 0xFF)];
+        ++histograms[1*256 + ((key >> 8) & 0xFF)];
+        ++histograms[2*256 + ((key >> 16) & 0xFF)];
+        ++histograms[3*256 + (key >> 24)];
+    }
 
-    return(result);
+    uint32 *source_keys = keys;
+    uint32 *source_values = values;
+    uint32 *dest_keys = key_buffer;
+    uint32 *dest_values = value_buffer;
+    for(uint32 pass = 0; pass < 4; ++pass)
+    {
+        usize *offsets = histograms + pass*256;
+        if(dgl__sort_prefix_sum(offsets, count))
+        {
+            uint32 shift = pass*8;
+            if(values)
+            {
+                for(usize index = 0; index < count; ++index)
+                {
+                    uint32 key = source_keys[index];
+                    usize at = offsets[(key >> shift) & 0xFF]++;
+                    dest_keys[at] = key;
+                    dest_values[at] = source_values[index];
+                }
+            }
+            else
+            {
+                for(usize index = 0; index < count; ++index)
+                {
+                    uint32 key = source_keys[index];
+                    dest_keys[offsets[(key >> shift) & 0xFF]++] = key;
+                }
+            }
+
+            uint32 *swap = source_keys; source_keys = dest_keys; dest_keys = swap;
+            swap = source_values; source_values = dest_values; dest_values = swap;
+        }
+    }
+
+    if(source_keys != keys)
+    {
+        dgl_memcpy(keys, source_keys, count * sizeof(uint32));
+        if(values) { dgl_memcpy(values, source_values, count * sizeof(uint32)); }
+    }
+
+    dgl_mem_arena_end_temp(temp);
 }
 
-DGL_DEF void *
-dgl_mem_arena_resize_align(DGL_Mem_Arena *arena, uint8 *current_base, DGL_Mem_Index current_size, DGL_Mem_Index new_size, usize align)
+internal void
+dgl__radix_sort_uint64(uint64 *keys, uint64 *values, usize count, DGL_Mem_Arena *scratch)
 {
-    void *result = 0;
-    dgl_assert(arena->base <= current_base && current_base < arena->base + arena->size, "This allocation does not belong to the arena");
+    if(count <= DGL_SORT_INSERTION_THRESHOLD)
+    {
+        dgl__insertion_sort_uint64(keys, values, count);
+        return;
+    }
 
-    if(current_size == new_size)
+    DGL_Mem_Temp_Arena temp = dgl_mem_arena_begin_temp(scratch);
+    usize *histograms = dgl_mem_arena_push_array(scratch, usize, 8 * 256);
+    uint64 *key_buffer = dgl_mem_arena_push_array_no_zero(scratch, uint64, count);
+    uint64 *value_buffer = values ? dgl_mem_arena_push_array_no_zero(scratch, uint64, count) : 0;
+
+    for(usize index = 0; index < count; ++index)
     {
-        result = current_base;
+        uint64 key = keys[index];
+        for(uint32 pass = 0; pass < 8; ++pass)
+        {
+            ++histograms[pass*256 + ((key >> (pass*8)) & 0xFF)];
+        }
     }
-    else if(arena->base + arena->prev_offset == current_base)
+
+    uint64 *source_keys = keys;
+    uint64 *source_values = values;
+    uint64 *dest_keys = key_buffer;
+    uint64 *dest_values = value_buffer;
+    for(uint32 pass = 0; pass < 8; ++pass)
     {
-        dgl_assert((arena->prev_offset + new_size) <= arena->size, "Arena overflow. Cannot allocate new size");
-        arena->curr_offset = arena->prev_offset + new_size;
-        if (new_size > current_size)
+        usize *offsets = histograms + pass*256;
+        if(dgl__sort_prefix_sum(offsets, count))
         {
-            // Zero the newly allocated memory
-            dgl_memset(arena->base + arena->prev_offset + current_size, 0, new_size - current_size);
+            uint32 shift = pass*8;
+            if(values)
+            {
+                for(usize index = 0; index < count; ++index)
+                {
+                    uint64 key = source_keys[index];
+                    usize at = offsets[(key >> shift) & 0xFF]++;
+                    dest_keys[at] = key;
+                    dest_values[at] = source_values[index];
+                }
+            }
+            else
+            {
+                for(usize index = 0; index < count; ++index)
+                {
+                    uint64 key = source_keys[index];
+                    dest_keys[offsets[(key >> shift) & 0xFF]++] = key;
+                }
+            }
+
+            uint64 *swap = source_keys; source_keys = dest_keys; dest_keys = swap;
+            swap = source_values; source_values = dest_values; dest_values = swap;
         }
-        result = current_base;
-        DGL_LOG_DEBUG("Resize allocation at 0x%p from %d to %d (%d bytes)", current_base, current_size, new_size, new_size - current_size);
     }
-    else
+
+    if(source_keys != keys)
     {
-        void *new_base = dgl_mem_arena_alloc_align(arena, new_size, align);
-        // NOTE(dgl): copy the existing data to the new location
-        usize copy_size = new_size < current_size ? new_size : current_size;
-        dgl_memcpy(new_base, current_base, copy_size);
-        result = new_base;
-        DGL_LOG_DEBUG("New allocation for resizing 0x%p from %d to %d (%d bytes). New address is 0x%p", current_base, current_size, new_size, new_size - current_size, new_base);
+        dgl_memcpy(keys, source_keys, count * sizeof(uint64));
+        if(values) { dgl_memcpy(values, source_values, count * sizeof(uint64)); }
     }
 
-    return(result);
+    dgl_mem_arena_end_temp(temp);
+}
+
+internal void
+dgl__sort_uint32_internal(uint32 *keys, uint32 *values, usize count, DGL_Mem_Arena *scratch, uint32 key_type)
+{
+    dgl__sort_map_keys_uint32(keys, count, key_type, false);
+    dgl__radix_sort_uint32(keys, values, count, scratch);
+    dgl__sort_map_keys_uint32(keys, count, key_type, true);
+}
+
+internal void
+dgl__sort_uint64_internal(uint64 *keys, uint64 *values, usize count, DGL_Mem_Arena *scratch, uint32 key_type)
+{
+    dgl__sort_map_keys_uint64(keys, count, key_type, false);
+    dgl__radix_sort_uint64(keys, values, count, scratch);
+    dgl__sort_map_keys_uint64(keys, count, key_type, true);
 }
 
 DGL_DEF void
-dgl_mem_arena_free_all(DGL_Mem_Arena *arena)
+dgl_sort_uint32(uint32 *keys, usize count, DGL_Mem_Arena *scratch)
 {
-    arena->curr_offset = 0;
-    arena->prev_offset = 0;
+    dgl__sort_uint32_internal(keys, 0, count, scratch, DGL__SORT_KEYS_UNSIGNED);
 }
 
-DGL_DEF DGL_Mem_Temp_Arena
-dgl_mem_arena_begin_temp(DGL_Mem_Arena *arena)
+DGL_DEF void
+dgl_sort_int32(int32 *keys, usize count, DGL_Mem_Arena *scratch)
 {
-    DGL_Mem_Temp_Arena result;
-    result.arena = arena;
-    result.prev_offset = arena->prev_offset;
-    result.curr_offset = arena->curr_offset;
-    return(result);
+    dgl__sort_uint32_internal(dgl_cast(uint32 *)keys, 0, count, scratch, DGL__SORT_KEYS_SIGNED);
 }
 
 DGL_DEF void
-dgl_mem_arena_end_temp(DGL_Mem_Temp_Arena temp)
+dgl_sort_real32(real32 *keys, usize count, DGL_Mem_Arena *scratch)
 {
-    temp.arena->prev_offset = temp.prev_offset;
-    temp.arena->curr_offset = temp.curr_offset;
+    dgl__sort_uint32_internal(dgl_cast(uint32 *)keys, 0, count, scratch, DGL__SORT_KEYS_REAL);
 }
 
 DGL_DEF void
-dgl_mem_pool_free_all(DGL_Mem_Pool *arena)
+dgl_sort_uint64(uint64 *keys, usize count, DGL_Mem_Arena *scratch)
 {
-    DGL_Mem_Index chunk_count = arena->size / arena->chunk_size;
+    dgl__sort_uint64_internal(keys, 0, count, scratch, DGL__SORT_KEYS_UNSIGNED);
+}
 
-    for(DGL_Mem_Index index = 0; index < chunk_count; ++index)
-    {
-        void *chunk = arena->base + (arena->chunk_size * index);
+DGL_DEF void
+dgl_sort_int64(int64 *keys, usize count, DGL_Mem_Arena *scratch)
+{
+    dgl__sort_uint64_internal(dgl_cast(uint64 *)keys, 0, count, scratch, DGL__SORT_KEYS_SIGNED);
+}
 
-        DGL_Mem_Pool_Free_Node *node = dgl_cast(DGL_Mem_Pool_Free_Node *)(chunk);
-        node->next = arena->head;
-        arena->head = node;
-    }
+DGL_DEF void
+dgl_sort_real64(real64 *keys, usize count, DGL_Mem_Arena *scratch)
+{
+    dgl__sort_uint64_internal(dgl_cast(uint64 *)keys, 0, count, scratch, DGL__SORT_KEYS_REAL);
 }
 
 DGL_DEF void
-dgl_mem_pool_init_align(DGL_Mem_Pool *arena, uint8 *base, DGL_Mem_Index size, DGL_Mem_Index chunk_size, usize chunk_alignment)
+dgl_sort_uint32_kv(uint32 *keys, uint32 *values, usize count, DGL_Mem_Arena *scratch)
 {
-    uintptr initial_base = (uintptr)base;
-    uintptr new_base = dgl__align_forward_uintptr(initial_base, chunk_alignment);
-    size -= dgl_cast(DGL_Mem_Index)(new_base - initial_base);
+    dgl__sort_uint32_internal(keys, values, count, scratch, DGL__SORT_KEYS_UNSIGNED);
+}
 
-    // NOTE(dgl): Align the size of each memory chunk
-    DGL_Mem_Index aligned_chunk_size = dgl__align_forward_memory_index(chunk_size, chunk_alignment);
+DGL_DEF void
+dgl_sort_int32_kv(int32 *keys, uint32 *values, usize count, DGL_Mem_Arena *scratch)
+{
+    dgl__sort_uint32_internal(dgl_cast(uint32 *)keys, values, count, scratch, DGL__SORT_KEYS_SIGNED);
+}
 
-    // NOTE(dgl): dgl_assert if everything fits
-    dgl_assert(chunk_size >= sizeof(DGL_Mem_Pool_Free_Node), "Chunk size is too small");
-    dgl_assert(size >= chunk_size, "Backing buffer length is smaller than the chunk size");
+DGL_DEF void
+dgl_sort_real32_kv(real32 *keys, uint32 *values, usize count, DGL_Mem_Arena *scratch)
+{
+    dgl__sort_uint32_internal(dgl_cast(uint32 *)keys, values, count, scratch, DGL__SORT_KEYS_REAL);
+}
 
-    arena->size = size;
-    arena->base = dgl_cast(uint8 *)new_base;
-    arena->chunk_size = aligned_chunk_size;
-    arena->head = 0;
+DGL_DEF void
+dgl_sort_uint64_kv(uint64 *keys, uint64 *values, usize count, DGL_Mem_Arena *scratch)
+{
+    dgl__sort_uint64_internal(keys, values, count, scratch, DGL__SORT_KEYS_UNSIGNED);
+}
 
-    dgl_mem_pool_free_all(arena);
+DGL_DEF void
+dgl_sort_int64_kv(int64 *keys, uint64 *values, usize count, DGL_Mem_Arena *scratch)
+{
+    dgl__sort_uint64_internal(dgl_cast(uint64 *)keys, values, count, scratch, DGL__SORT_KEYS_SIGNED);
 }
 
-DGL_DEF void *
-dgl__mem_pool_alloc_internal(DGL_Mem_Pool *arena)
+DGL_DEF void
+dgl_sort_real64_kv(real64 *keys, uint64 *values, usize count, DGL_Mem_Arena *scratch)
 {
-    void *result = 0;
-    DGL_Mem_Pool_Free_Node *node = arena->head;
+    dgl__sort_uint64_internal(dgl_cast(uint64 *)keys, values, count, scratch, DGL__SORT_KEYS_REAL);
+}
 
-    if(node) {
-        result = node;
-        arena->head->next = arena->head->next;
-        dgl_memset(result, 0, arena->chunk_size);
+typedef struct DGL__Sort_Task
+{
+    uint8 *source;
+    uint8 *dest;
+    usize begin;
+    usize end;
+    usize key_size;
+    uint32 shift;
+    usize offsets[256];
+} DGL__Sort_Task;
+
+internal void
+dgl__sort_histogram_task(void *data)
+{
+    DGL__Sort_Task *task = dgl_cast(DGL__Sort_Task *)data;
+    dgl_memset(task->offsets, 0, sizeof(task->offsets));
+    if(task->key_size == sizeof(uint32))
+    {
+        uint32 *keys = dgl_cast(uint32 *)task->source;
+        for(usize index = task->begin; index < task->end; ++index) { ++task->offsets[(keys[index] >> task->shift) & 0xFF]; }
     }
     else
     {
-        // TODO(dgl): logging
-        dgl_assert(!node, "No free node in memory pool");
+        uint64 *keys = dgl_cast(uint64 *)task->source;
+        for(usize index = task->begin; index < task->end; ++index) { ++task->offsets[(keys[index] >> task->shift) & 0xFF]; }
     }
-
-    return(result);
 }
 
-DGL_DEF void
-dgl__mem_pool_free_internal(DGL_Mem_Pool *arena, void *ptr)
+internal void
+dgl__sort_scatter_task(void *data)
 {
-    dgl_assert((ptr >= dgl_cast(void *)arena->base) &&
-           (ptr < dgl_cast(void *)(arena->base + arena->size)), "Pointer is not in memory pool range");
-
-    DGL_Mem_Pool_Free_Node *node = dgl_cast(DGL_Mem_Pool_Free_Node *)ptr;
-    node->next = arena->head;
-    arena->head = node;
+    DGL__Sort_Task *task = dgl_cast(DGL__Sort_Task *)data;
+    if(task->key_size == sizeof(uint32))
+    {
+        uint32 *source = dgl_cast(uint32 *)task->source;
+        uint32 *dest = dgl_cast(uint32 *)task->dest;
+        for(usize index = task->begin; index < task->end; ++index)
+        {
+            uint32 key = source[index];
+            dest[task->offsets[(key >> task->shift) & 0xFF]++] = key;
+        }
+    }
+    else
+    {
+        uint64 *source = dgl_cast(uint64 *)task->source;
+        uint64 *dest = dgl_cast(uint64 *)task->dest;
+        for(usize index = task->begin; index < task->end; ++index)
+        {
+            uint64 key = source[index];
+            dest[task->offsets[(key >> task->shift) & 0xFF]++] = key;
+        }
+    }
 }
 
-DGL_DEF void *
-dgl__mem_pool_alloc_threadsafe_internal(DGL_Mem_Pool *arena)
+// NOTE(dgl): Every pass counts digits per chunk in parallel, computes the start offset of every
+// (digit, chunk) pair and scatters the chunks in parallel. Chunks are ordered, so the sort stays stable.
+internal void
+dgl__radix_sort_parallel(uint8 *keys, usize key_size, usize count, DGL_Mem_Arena *scratch, uint32 task_count, dgl_sort_dispatch_F dispatch)
 {
-    void *result = 0;
-    DGL_Mem_Pool_Free_Node *node = arena->head;
+    DGL_Mem_Temp_Arena temp = dgl_mem_arena_begin_temp(scratch);
+    DGL__Sort_Task *tasks = dgl_mem_arena_push_array(scratch, DGL__Sort_Task, task_count);
+    void **task_data = dgl_mem_arena_push_array(scratch, void *, task_count);
+    uint8 *buffer = dgl_mem_arena_push_array_no_zero(scratch, uint8, count * key_size);
 
-    if(node) {
-        uintptr old_head = dgl_cast(uintptr)node;
-        uintptr new_head = dgl_cast(uintptr)arena->head->next;
-        uintptr head = dgl_cast(uintptr)arena->head;
+    usize chunk_size = (count + task_count - 1) / task_count;
+    for(uint32 task_index = 0; task_index < task_count; ++task_index)
+    {
+        DGL__Sort_Task *task = tasks + task_index;
+        task->begin = dgl_min(count, task_index * chunk_size);
+        task->end = dgl_min(count, task->begin + chunk_size);
+        task->key_size = key_size;
+        task_data[task_index] = task;
+    }
 
-        if(dgl_atomic_compare_exchange_uintptr(&head,
-           new_head,
-           old_head) == old_head)
+    uint8 *source = keys;
+    uint8 *dest = buffer;
+    uint32 pass_count = dgl_cast(uint32)key_size;
+    for(uint32 pass = 0; pass < pass_count; ++pass)
+    {
+        for(uint32 task_index = 0; task_index < task_count; ++task_index)
         {
-            result = node;
-            dgl_memset(result, 0, arena->chunk_size);
+            tasks[task_index].source = source;
+            tasks[task_index].dest = dest;
+            tasks[task_index].shift = pass*8;
         }
-        else
+        dispatch(dgl__sort_histogram_task, task_data, task_count);
+
+        bool32 skip_pass = false;
+        usize offset = 0;
+        for(uint32 digit = 0; digit < 256; ++digit)
         {
-           // TODO(dgl): logging
-            printf("compare exchange failed.");
+            usize digit_begin = offset;
+            for(uint32 task_index = 0; task_index < task_count; ++task_index)
+            {
+                usize digit_count = tasks[task_index].offsets[digit];
+                tasks[task_index].offsets[digit] = offset;
+                offset += digit_count;
+            }
+            if(offset - digit_begin == count) { skip_pass = true; }
+        }
+
+        if(!skip_pass)
+        {
+            dispatch(dgl__sort_scatter_task, task_data, task_count);
+            uint8 *swap = source; source = dest; dest = swap;
         }
     }
-    else
+
+    if(source != keys)
     {
-        // TODO(dgl): logging
-        dgl_assert(!node, "No free node in memory pool");
+        dgl_memcpy(keys, source, count * key_size);
     }
 
-    return(result);
+    dgl_mem_arena_end_temp(temp);
 }
 
 DGL_DEF void
-dgl__mem_pool_free_threadsafe_internal(DGL_Mem_Pool *arena, void *ptr)
+dgl_sort_uint32_parallel(uint32 *keys, usize count, DGL_Mem_Arena *scratch, uint32 task_count, dgl_sort_dispatch_F dispatch)
 {
-    dgl_assert((ptr >= dgl_cast(void *)arena->base) &&
-           (ptr < dgl_cast(void *)(arena->base + arena->size)), "Pointer is not in memory pool range");
-
-    DGL_Mem_Pool_Free_Node *node = dgl_cast(DGL_Mem_Pool_Free_Node *)ptr;
+    if(count < DGL_SORT_PARALLEL_THRESHOLD || task_count <= 1)
+    {
+        dgl__radix_sort_uint32(keys, 0, count, scratch);
+    }
+    else
+    {
+        dgl__radix_sort_parallel(dgl_cast(uint8 *)keys, sizeof(uint32), count, scratch, task_count, dispatch);
+    }
+}
 
-    uintptr old_head;
-    uintptr new_head;
-    uintptr head;
-    do
+DGL_DEF void
+dgl_sort_uint64_parallel(uint64 *keys, usize count, DGL_Mem_Arena *scratch, uint32 task_count, dgl_sort_dispatch_F dispatch)
+{
+    if(count < DGL_SORT_PARALLEL_THRESHOLD || task_count <= 1)
     {
-        node->next = arena->head;
-        head = dgl_cast(uintptr)arena->head;
-        old_head = head;
-        new_head = dgl_cast(uintptr)node;
-    } while(dgl_atomic_compare_exchange_uintptr(&head,
-            new_head,
-            old_head) != old_head);
+        dgl__radix_sort_uint64(keys, 0, count, scratch);
+    }
+    else
+    {
+        dgl__radix_sort_parallel(dgl_cast(uint8 *)keys, sizeof(uint64), count, scratch, task_count, dispatch);
+    }
 }
 
-#endif // DGL_NO_MEMORY
+#endif // DGL_NO_SORT
 
 //
-//  String
+//  Profiler
 //
 
-#ifndef DGL_NO_STRING
+#ifndef DGL_NO_PROFILER
 
-DGL_DEF DGL_String_Builder
-dgl_string_builder_init(DGL_Mem_Arena *arena, usize capacity)
+#if DGL_OS_WINDOWS
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h> // QueryPerformanceCounter
+#endif
+
+dgl_thread_local DGL_Profile_Thread *dgl__profile_thread;
+
+global struct DGL_Profiler
 {
-    DGL_String_Builder result = {};
-    result.arena = arena;
-    result.data = dgl_mem_arena_push_array(arena, uint8, capacity);
-    result.count = 0;
-    result.capacity = capacity;
+    DGL_Profile_Thread * volatile first_thread;
+    uint32 volatile thread_count;
+} dgl_profiler;
 
-    return(result);
+DGL_DEF void
+dgl_profiler_thread_begin(DGL_Profile_Thread *thread, DGL_Profile_Event *events, uint32 event_count, char *name)
+{
+    dgl_assert(event_count > 0 && (event_count & (event_count - 1)) == 0, "Event count has to be a power of two");
+
+    if(!thread->registered)
+    {
+        thread->events = events;
+        thread->event_mask = event_count - 1;
+        thread->write_index = 0;
+        thread->name = name;
+
+        uint32 id;
+        do
+        {
+            id = dgl_profiler.thread_count;
+        } while(dgl_atomic_compare_exchange_uint32(&dgl_profiler.thread_count, id + 1, id) != id);
+        thread->id = id;
+
+        // NOTE(dgl): Threads are only ever added, so a simple lock free push is enough.
+        uintptr old_head;
+        do
+        {
+            old_head = dgl_cast(uintptr)dgl_profiler.first_thread;
+            thread->next = dgl_cast(DGL_Profile_Thread *)old_head;
+        } while(dgl_atomic_compare_exchange_uintptr(dgl_cast(uintptr volatile *)&dgl_profiler.first_thread,
+                                                    dgl_cast(uintptr)thread, old_head) != old_head);
+        thread->registered = true;
+    }
+
+    dgl__profile_thread = thread;
 }
 
 DGL_DEF void
-dgl__string_append_internal(DGL_String_Builder *builder, char *fmt, ...)
+dgl_profiler_thread_end(void)
 {
-    DGL_Mem_Arena *a = builder->arena;
-    va_list ap;
-retry:
-    va_start(ap, fmt);
-    int32 size = vsnprintf(dgl_cast(char *)(builder->data + builder->count), builder->capacity - builder->count, fmt, ap);
-    if(size < 0)
+    dgl__profile_thread = 0;
+}
+
+DGL_DEF DGL_Profile_Thread *
+dgl_profiler_threads(void)
+{
+    DGL_Profile_Thread *result = dgl_profiler.first_thread;
+    return(result);
+}
+
+DGL_DEF uint64
+dgl_profiler_estimate_cpu_timer_frequency(uint32 milliseconds_to_wait)
+{
+    uint64 result = 0;
+#if DGL_OS_UNIX || DGL_OS_OSX
+    struct timespec start;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    uint64 cpu_start = dgl_read_cpu_timer();
+
+    uint64 wait_ns = dgl_cast(uint64)milliseconds_to_wait * 1000000ULL;
+    uint64 elapsed_ns = 0;
+    while(elapsed_ns < wait_ns)
     {
-        DGL_LOG("Failed to append string to %p", builder->data);
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        elapsed_ns = dgl_cast(uint64)(now.tv_sec - start.tv_sec) * 1000000000ULL + dgl_cast(uint64)now.tv_nsec - dgl_cast(uint64)start.tv_nsec;
     }
-    else
+
+    uint64 cpu_elapsed = dgl_read_cpu_timer() - cpu_start;
+    if(elapsed_ns)
     {
-        usize required_cap = builder->count + dgl_cast(usize)size;
-        if(builder->capacity <= required_cap)
+        result = dgl_cast(uint64)(dgl_cast(real64)cpu_elapsed * 1e9 / dgl_cast(real64)elapsed_ns);
+    }
+#elif DGL_OS_WINDOWS
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER start;
+    LARGE_INTEGER now;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&start);
+    uint64 cpu_start = dgl_read_cpu_timer();
+
+    uint64 wait_ticks = dgl_cast(uint64)frequency.QuadPart * milliseconds_to_wait / 1000;
+    uint64 elapsed_ticks = 0;
+    while(elapsed_ticks < wait_ticks)
+    {
+        QueryPerformanceCounter(&now);
+        elapsed_ticks = dgl_cast(uint64)(now.QuadPart - start.QuadPart);
+    }
+
+    uint64 cpu_elapsed = dgl_read_cpu_timer() - cpu_start;
+    if(elapsed_ticks)
+    {
+        result = dgl_cast(uint64)(dgl_cast(real64)cpu_elapsed * dgl_cast(real64)frequency.QuadPart / dgl_cast(real64)elapsed_ticks);
+    }
+#endif
+    return(result);
+}
+
+internal uint64
+dgl__profile_first_event_index(DGL_Profile_Thread *thread)
+{
+    uint64 capacity = thread->event_mask + 1;
+    uint64 result = thread->write_index > capacity ? thread->write_index - capacity : 0;
+    return(result);
+}
+
+internal bool32
+dgl__profile_same_name(char *a, char *b)
+{
+    // NOTE(dgl): Names are usually string literals, so the pointer compare hits most of the time.
+    bool32 result = (a == b) || (a && b && strcmp(a, b) == 0);
+    return(result);
+}
+
+DGL_DEF DGL_Profile_Node *
+dgl_profiler_build_tree(DGL_Mem_Arena *arena, DGL_Profile_Thread *thread)
+{
+    DGL_Profile_Node *root = dgl_mem_arena_push_struct(arena, DGL_Profile_Node);
+    root->name = thread->name;
+
+    DGL_Profile_Node *node_stack[DGL_PROFILE_MAX_DEPTH];
+    uint64 begin_stack[DGL_PROFILE_MAX_DEPTH];
+    uint32 depth = 0;
+    // NOTE(dgl): Scopes deeper than DGL_PROFILE_MAX_DEPTH are not tracked, only counted to keep the
+    // begin/end pairs in sync.
+    uint32 skipped_depth = 0;
+    DGL_Profile_Node *current = root;
+
+    uint64 write_index = thread->write_index;
+    for(uint64 index = dgl__profile_first_event_index(thread); index < write_index; ++index)
+    {
+        DGL_Profile_Event *event = thread->events + (index & thread->event_mask);
+        if(event->type == DGL_PROFILE_EVENT_BEGIN)
         {
-            usize new_capacity = builder->capacity;
-            while(new_capacity <= required_cap)
+            if(depth < DGL_PROFILE_MAX_DEPTH && skipped_depth == 0)
             {
-                new_capacity *= 2;
+                DGL_Profile_Node *child = current->first_child;
+                while(child && !dgl__profile_same_name(child->name, event->name))
+                {
+                    child = child->next_sibling;
+                }
+
+                if(!child)
+                {
+                    child = dgl_mem_arena_push_struct(arena, DGL_Profile_Node);
+                    child->name = event->name;
+                    child->parent = current;
+                    child->next_sibling = current->first_child;
+                    current->first_child = child;
+                }
+
+                node_stack[depth] = child;
+                begin_stack[depth] = event->cpu_time;
+                ++depth;
+                current = child;
+            }
+            else
+            {
+                ++skipped_depth;
+            }
+        }
+        else if(skipped_depth > 0)
+        {
+            --skipped_depth;
+        }
+        else if(depth > 0 && dgl__profile_same_name(current->name, event->name))
+        {
+            // NOTE(dgl): Unmatched end events (the begin was overwritten in the ring buffer) are skipped.
+            --depth;
+            uint64 cycles = event->cpu_time - begin_stack[depth];
+            DGL_Profile_Node *node = node_stack[depth];
+            node->hit_count += 1;
+            node->inclusive_cycles += cycles;
+            node->self_cycles += cycles;
+
+            current = node->parent;
+            if(current == root)
+            {
+                root->inclusive_cycles += cycles;
+            }
+            else
+            {
+                current->self_cycles -= cycles;
             }
-            // NOTE(dgl): If the current buffer size is too small,
-            // we resize the buffer with double the size.
-
-            builder->data = dgl_cast(uint8 *)dgl_mem_arena_resize(a, builder->data, builder->capacity, new_capacity);
-            builder->capacity = new_capacity;
-            goto retry;
         }
-        builder->count += dgl_cast(usize)size;
-        builder->data[builder->count] = '\0';
     }
+
+    return(root);
 }
 
-DGL_DEF char *
-dgl_string_c_style(DGL_String_Builder *builder)
+DGL_DEF void
+dgl_profiler_export_chrome_trace(DGL_String_Builder *builder, uint64 cpu_timer_frequency)
 {
-   // TODO(dgl): copy into memory and add nullbyte
-   char *result = builder->string;
-   return(result);
+    dgl_assert(cpu_timer_frequency > 0, "Cpu timer frequency is required to convert to microseconds");
+    real64 microseconds_per_cycle = 1e6 / dgl_cast(real64)cpu_timer_frequency;
+
+    uint64 start_time = 0xFFFFFFFFFFFFFFFFULL;
+    for(DGL_Profile_Thread *thread = dgl_profiler_threads(); thread; thread = thread->next)
+    {
+        uint64 first = dgl__profile_first_event_index(thread);
+        if(first < thread->write_index)
+        {
+            uint64 cpu_time = thread->events[first & thread->event_mask].cpu_time;
+            start_time = dgl_min(start_time, cpu_time);
+        }
+    }
+
+    // NOTE(dgl): Event names are written as they are. They must not contain quotes or backslashes.
+    dgl_string_append(builder, "{\"traceEvents\":[");
+    bool32 first_event = true;
+    for(DGL_Profile_Thread *thread = dgl_profiler_threads(); thread; thread = thread->next)
+    {
+        dgl_string_append(builder, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                          first_event ? "" : ",", thread->id, thread->name ? thread->name : "");
+        first_event = false;
+
+        uint32 depth = 0;
+        uint64 write_index = thread->write_index;
+        for(uint64 index = dgl__profile_first_event_index(thread); index < write_index; ++index)
+        {
+            DGL_Profile_Event *event = thread->events + (index & thread->event_mask);
+            bool32 is_begin = event->type == DGL_PROFILE_EVENT_BEGIN;
+            if(is_begin || depth > 0)
+            {
+                depth = is_begin ? depth + 1 : depth - 1;
+                real64 timestamp = dgl_cast(real64)(event->cpu_time - start_time) * microseconds_per_cycle;
+                dgl_string_append(builder, ",\n{\"name\":\"%s\",\"ph\":\"%s\",\"ts\":%.3f,\"pid\":0,\"tid\":%u}",
+                                  event->name, is_begin ? "B" : "E", timestamp, thread->id);
+            }
+        }
+    }
+    dgl_string_append(builder, "\n]}\n");
 }
 
-#endif // DGL_NO_STRING
+#endif // DGL_NO_PROFILER
 
 #endif // DGL_IMPLEMENTATION
@@ -0,0 +1,511 @@
+/* dgl.hpp - v0.1
+   No warranty is offered or implied; Use this code at your own risk
+
+   This file is written mostly for my self and a work in progress!
+
+ ============================================================================
+   Optional C++ layer over dgl.h. It only contains templates and inline
+   functions, the implementation still comes from dgl.h:
+      #define DGL_IMPLEMENTATION
+      #include "dgl.hpp"
+   in EXACTLY _one_ C++ file, all other files just #include "dgl.hpp".
+   Needs C++11 and works without exceptions and RTTI.
+ ============================================================================
+
+LICENSE
+   This software is dual-licensed (MIT and public domain) -- See the LICENSE file in this repository
+   (https://github.com/0xd61/dgl/blob/main/LICENSE) for more information.
+
+CREDITS
+ Written by Daniel Glinka.
+
+ Credits to Sean Barrett and his stb style libraries which inspired this library.
+*/
+
+#ifndef DGL_HPP
+#define DGL_HPP
+
+#include "dgl.h"
+
+#include <new>     // placement new
+#include <utility> // std::forward
+
+#ifndef DGL_NO_MEMORY
+
+namespace dgl
+{
+
+// NOTE(dgl): The C functions take chunk size and alignment at runtime. Here they are template
+// parameters, so the alignment math and the memset size fold to constants and the allocation is
+// inlined.
+constexpr usize
+align_forward(usize value, usize align)
+{
+    return((value + align - 1) & ~(align - 1));
+}
+
+constexpr bool
+is_power_of_two(usize value)
+{
+    return(value != 0 && (value & (value - 1)) == 0);
+}
+
+template<typename T>
+struct Default_Align
+{
+    static constexpr usize value = alignof(T) > alignof(DGL_Mem_Pool_Free_Node) ? alignof(T) : alignof(DGL_Mem_Pool_Free_Node);
+};
+
+//
+// Arena
+//
+
+// NOTE(dgl): Same as dgl_mem_arena_alloc_align(_no_zero), but inlined with a constant alignment.
+template<usize Align, bool Zero>
+void *
+arena_alloc(DGL_Mem_Arena *arena, DGL_Mem_Index size)
+{
+    static_assert(is_power_of_two(Align), "Alignment has to be a power of two");
+    uintptr curr_ptr = dgl_cast(uintptr)(arena->base + arena->curr_offset);
+    uintptr new_ptr = (curr_ptr + (Align - 1)) & ~dgl_cast(uintptr)(Align - 1);
+    DGL_Mem_Index offset = dgl_cast(DGL_Mem_Index)(new_ptr - dgl_cast(uintptr)arena->base);
+    dgl_assert((offset + size) <= arena->size, "Arena overflow. Cannot allocate size");
+
+    void *result = arena->base + offset;
+    arena->prev_offset = offset;
+    arena->curr_offset = offset + size;
+    if(Zero) { dgl_memset(result, 0, size); }
+    return(result);
+}
+
+// NOTE(dgl): Wraps a DGL_Mem_Arena, arena.raw can be passed to every C function.
+struct Arena
+{
+    DGL_Mem_Arena raw;
+
+    Arena()
+    {
+        dgl_mem_arena_init(&raw, 0, 0);
+    }
+
+    Arena(uint8 *base, DGL_Mem_Index size)
+    {
+        dgl_mem_arena_init(&raw, base, size);
+    }
+
+    template<usize Size, usize Align, bool Zero = true>
+    void *
+    alloc()
+    {
+        void *result = arena_alloc<Align, Zero>(&raw, Size);
+        return(result);
+    }
+
+    template<usize Align, bool Zero = true>
+    void *
+    alloc(DGL_Mem_Index size)
+    {
+        void *result = arena_alloc<Align, Zero>(&raw, size);
+        return(result);
+    }
+
+    // NOTE(dgl): Zeroed like dgl_mem_arena_push_struct, but aligned to alignof(T).
+    template<typename T>
+    T *
+    push()
+    {
+        T *result = dgl_cast(T *)alloc<sizeof(T), alignof(T)>();
+        return(result);
+    }
+
+    template<typename T, usize Count>
+    T *
+    push_array()
+    {
+        T *result = dgl_cast(T *)alloc<Count * sizeof(T), alignof(T)>();
+        return(result);
+    }
+
+    template<typename T>
+    T *
+    push_array(usize count)
+    {
+        T *result = dgl_cast(T *)alloc<alignof(T)>(count * sizeof(T));
+        return(result);
+    }
+
+    template<typename T>
+    T *
+    push_array_no_zero(usize count)
+    {
+        T *result = dgl_cast(T *)alloc<alignof(T), false>(count * sizeof(T));
+        return(result);
+    }
+
+    // NOTE(dgl): Constructs the object. The arena never calls destructors, use it for types that
+    // do not need one or call it yourself.
+    template<typename T, typename... Args>
+    T *
+    make(Args&&... args)
+    {
+        T *result = new(alloc<sizeof(T), alignof(T), false>()) T(std::forward<Args>(args)...);
+        return(result);
+    }
+
+    void
+    free_all()
+    {
+        dgl_mem_arena_free_all(&raw);
+    }
+};
+
+//
+// Temp scopes
+//
+
+// NOTE(dgl): Ends the temp arena when the scope is left. Usage:
+//    {
+//        dgl::Temp_Scope temp(arena);
+//        int32 *values = arena.push_array<int32>(count);
+//    }
+struct Temp_Scope
+{
+    DGL_Mem_Temp_Arena temp;
+
+    explicit Temp_Scope(DGL_Mem_Arena *arena) : temp(dgl_mem_arena_begin_temp(arena)) {}
+    explicit Temp_Scope(Arena &arena) : temp(dgl_mem_arena_begin_temp(&arena.raw)) {}
+    ~Temp_Scope() { dgl_mem_arena_end_temp(temp); }
+
+    Temp_Scope(const Temp_Scope &) = delete;
+    Temp_Scope &operator=(const Temp_Scope &) = delete;
+};
+
+// NOTE(dgl): Same for dgl_mem_scratch_begin. The thread needs dgl_mem_scratch_thread_init first.
+// Usage:
+//    dgl::Scratch_Scope scratch(&output_arena.raw);
+//    real32 *temporary = dgl_mem_arena_push_array(scratch.arena(), real32, count);
+struct Scratch_Scope
+{
+    DGL_Mem_Temp_Arena temp;
+
+    Scratch_Scope() : temp(dgl_mem_scratch_begin(0, 0)) {}
+    explicit Scratch_Scope(DGL_Mem_Arena *conflict) : temp(dgl_mem_scratch_begin(&conflict, 1)) {}
+    Scratch_Scope(DGL_Mem_Arena **conflicts, uint32 conflict_count) : temp(dgl_mem_scratch_begin(conflicts, conflict_count)) {}
+    ~Scratch_Scope() { dgl_mem_scratch_end(temp); }
+
+    Scratch_Scope(const Scratch_Scope &) = delete;
+    Scratch_Scope &operator=(const Scratch_Scope &) = delete;
+
+    DGL_Mem_Arena *
+    arena()
+    {
+        DGL_Mem_Arena *result = temp.arena;
+        return(result);
+    }
+};
+
+//
+// Allocator
+//
+
+// NOTE(dgl): Standard allocator on top of an arena for STL containers. Deallocating does
+// nothing, the memory comes back with the arena (or its temp scope). Usage:
+//    dgl::Arena_Allocator<int32> allocator(&arena);
+//    std::vector<int32, dgl::Arena_Allocator<int32>> values(allocator);
+template<typename T>
+struct Arena_Allocator
+{
+    typedef T value_type;
+
+    DGL_Mem_Arena *arena;
+
+    Arena_Allocator(DGL_Mem_Arena *arena) noexcept : arena(arena) {}
+    Arena_Allocator(Arena *arena) noexcept : arena(&arena->raw) {}
+    template<typename U>
+    Arena_Allocator(const Arena_Allocator<U> &other) noexcept : arena(other.arena) {}
+
+    T *
+    allocate(usize count)
+    {
+        T *result = dgl_cast(T *)arena_alloc<alignof(T), false>(arena, count * sizeof(T));
+        return(result);
+    }
+
+    void
+    deallocate(T *, usize)
+    {
+    }
+};
+
+template<typename T, typename U>
+bool
+operator==(const Arena_Allocator<T> &a, const Arena_Allocator<U> &b)
+{
+    return(a.arena == b.arena);
+}
+
+template<typename T, typename U>
+bool
+operator!=(const Arena_Allocator<T> &a, const Arena_Allocator<U> &b)
+{
+    return(a.arena != b.arena);
+}
+
+//
+// Pool
+//
+
+// NOTE(dgl): Typed DGL_Mem_Pool. Chunk size and alignment are constants, so push and release
+// are inlined free list operations and push zeroes a constant size.
+template<typename T, usize Align = Default_Align<T>::value>
+struct Pool
+{
+    static_assert(is_power_of_two(Align), "Alignment has to be a power of two");
+    static constexpr usize chunk_size = align_forward(sizeof(T) > sizeof(DGL_Mem_Pool_Free_Node) ? sizeof(T) : sizeof(DGL_Mem_Pool_Free_Node), Align);
+
+    DGL_Mem_Pool raw;
+
+    Pool()
+    {
+        raw.base = 0;
+        raw.size = 0;
+        raw.chunk_size = chunk_size;
+        raw.head = 0;
+    }
+
+    Pool(uint8 *base, DGL_Mem_Index size)
+    {
+        init(base, size);
+    }
+
+    void
+    init(uint8 *base, DGL_Mem_Index size)
+    {
+        dgl_mem_pool_init_align(&raw, base, size, chunk_size, Align);
+    }
+
+    // NOTE(dgl): Returns 0 if the pool is full, like the C pools.
+    template<bool Zero = true>
+    T *
+    alloc()
+    {
+        T *result = 0;
+        DGL_Mem_Pool_Free_Node *node = raw.head;
+        if(node)
+        {
+            raw.head = node->next;
+            if(Zero) { dgl_memset(node, 0, chunk_size); }
+            result = dgl_cast(T *)dgl_cast(void *)node;
+        }
+        return(result);
+    }
+
+    T *
+    push()
+    {
+        T *result = alloc<true>();
+        return(result);
+    }
+
+    template<typename... Args>
+    T *
+    make(Args&&... args)
+    {
+        T *result = alloc<false>();
+        if(result) { result = new(result) T(std::forward<Args>(args)...); }
+        return(result);
+    }
+
+    void
+    release(T *ptr)
+    {
+        dgl_assert((dgl_cast(uint8 *)ptr >= raw.base) && (dgl_cast(uint8 *)ptr < raw.base + raw.size), "Pointer is not in memory pool range");
+        DGL_Mem_Pool_Free_Node *node = dgl_cast(DGL_Mem_Pool_Free_Node *)dgl_cast(void *)ptr;
+        node->next = raw.head;
+        raw.head = node;
+    }
+
+    void
+    destroy(T *ptr)
+    {
+        ptr->~T();
+        release(ptr);
+    }
+
+    void
+    free_all()
+    {
+        dgl_mem_pool_free_all(&raw);
+    }
+};
+
+// NOTE(dgl): Owns one object of a pool and destroys it when it goes out of scope. Move only.
+template<typename T, usize Align = Default_Align<T>::value>
+struct Pool_Ptr
+{
+    Pool<T, Align> *pool;
+    T *ptr;
+
+    Pool_Ptr() : pool(0), ptr(0) {}
+    Pool_Ptr(Pool<T, Align> *pool, T *ptr) : pool(pool), ptr(ptr) {}
+    Pool_Ptr(Pool_Ptr &&other) : pool(other.pool), ptr(other.ptr) { other.ptr = 0; }
+    ~Pool_Ptr() { reset(); }
+
+    Pool_Ptr(const Pool_Ptr &) = delete;
+    Pool_Ptr &operator=(const Pool_Ptr &) = delete;
+
+    Pool_Ptr &
+    operator=(Pool_Ptr &&other)
+    {
+        if(this != &other)
+        {
+            reset();
+            pool = other.pool;
+            ptr = other.ptr;
+            other.ptr = 0;
+        }
+        return(*this);
+    }
+
+    void
+    reset()
+    {
+        if(ptr)
+        {
+            pool->destroy(ptr);
+            ptr = 0;
+        }
+    }
+
+    // NOTE(dgl): Gives up ownership without destroying the object.
+    T *
+    release()
+    {
+        T *result = ptr;
+        ptr = 0;
+        return(result);
+    }
+
+    T *get() const { return(ptr); }
+    T *operator->() const { return(ptr); }
+    T &operator*() const { return(*ptr); }
+    explicit operator bool() const { return(ptr != 0); }
+};
+
+template<typename T, usize Align, typename... Args>
+Pool_Ptr<T, Align>
+make_pool_ptr(Pool<T, Align> *pool, Args&&... args)
+{
+    Pool_Ptr<T, Align> result(pool, pool->make(std::forward<Args>(args)...));
+    return(result);
+}
+
+//
+// Handle pool
+//
+
+// NOTE(dgl): Typed DGL_Mem_Handle_Pool. Handles stay plain 32 bit values, get returns 0 for
+// stale handles.
+template<typename T, usize Align = Default_Align<T>::value>
+struct Handle_Pool
+{
+    static_assert(is_power_of_two(Align), "Alignment has to be a power of two");
+
+    DGL_Mem_Handle_Pool raw;
+
+    Handle_Pool(uint8 *base, DGL_Mem_Index size)
+    {
+        dgl_mem_handle_pool_init_align(&raw, base, size, sizeof(T), Align);
+    }
+
+    // NOTE(dgl): Returns the null handle if the pool is full.
+    template<typename... Args>
+    DGL_Mem_Handle
+    make(Args&&... args)
+    {
+        DGL_Mem_Handle result = dgl_mem_handle_pool_alloc(&raw);
+        if(result) { new(dgl_mem_handle_pool_resolve(&raw, result)) T(std::forward<Args>(args)...); }
+        return(result);
+    }
+
+    T *
+    get(DGL_Mem_Handle handle)
+    {
+        T *result = dgl_cast(T *)dgl_mem_handle_pool_resolve(&raw, handle);
+        return(result);
+    }
+
+    bool32
+    destroy(DGL_Mem_Handle handle)
+    {
+        T *object = get(handle);
+        if(object) { object->~T(); }
+        bool32 result = dgl_mem_handle_pool_release(&raw, handle);
+        return(result);
+    }
+};
+
+// NOTE(dgl): Owns a handle and destroys its object when it goes out of scope. Move only.
+template<typename T, usize Align = Default_Align<T>::value>
+struct Unique_Handle
+{
+    Handle_Pool<T, Align> *pool;
+    DGL_Mem_Handle handle;
+
+    Unique_Handle() : pool(0), handle(0) {}
+    Unique_Handle(Handle_Pool<T, Align> *pool, DGL_Mem_Handle handle) : pool(pool), handle(handle) {}
+    Unique_Handle(Unique_Handle &&other) : pool(other.pool), handle(other.handle) { other.handle = 0; }
+    ~Unique_Handle() { reset(); }
+
+    Unique_Handle(const Unique_Handle &) = delete;
+    Unique_Handle &operator=(const Unique_Handle &) = delete;
+
+    Unique_Handle &
+    operator=(Unique_Handle &&other)
+    {
+        if(this != &other)
+        {
+            reset();
+            pool = other.pool;
+            handle = other.handle;
+            other.handle = 0;
+        }
+        return(*this);
+    }
+
+    void
+    reset()
+    {
+        if(handle)
+        {
+            pool->destroy(handle);
+            handle = 0;
+        }
+    }
+
+    DGL_Mem_Handle
+    release()
+    {
+        DGL_Mem_Handle result = handle;
+        handle = 0;
+        return(result);
+    }
+
+    T *get() const { return(handle ? pool->get(handle) : 0); }
+    T *operator->() const { return(get()); }
+    explicit operator bool() const { return(handle != 0); }
+};
+
+template<typename T, usize Align, typename... Args>
+Unique_Handle<T, Align>
+make_unique_handle(Handle_Pool<T, Align> *pool, Args&&... args)
+{
+    Unique_Handle<T, Align> result(pool, pool->make(std::forward<Args>(args)...));
+    return(result);
+}
+
+} // namespace dgl
+
+#endif // DGL_NO_MEMORY
+
+#endif // DGL_HPP
@@ -1,8 +1,340 @@
 #define DGL_IMPLEMENTATION
+#define DGL_PROFILE 1
 #include "dgl.h"
 
 #include "dgl_test_helpers.h"
 
+#include <stdlib.h> // qsort
+#include <string.h> // strcmp
+#include <pthread.h>
+#include <sched.h> // sched_yield
+
+internal int
+compare_uint64(const void *a, const void *b)
+{
+    uint64 value_a = *dgl_cast(const uint64 *)a;
+    uint64 value_b = *dgl_cast(const uint64 *)b;
+    return((value_a > value_b) - (value_a < value_b));
+}
+
+typedef uint64 (*hash_bytes_F)(void *data, usize size, uint64 seed);
+
+// NOTE(dgl): Flips every input bit of random keys and returns the worst deviation from a 50% flip
+// probability of any output bit (SMHasher style avalanche sanity check).
+internal real64
+hash_avalanche_bias(hash_bytes_F hash, usize key_size, uint32 key_count)
+{
+    uint32 flips[64] = {};
+    uint32 trials = 0;
+    uint8 key[128];
+    uint32 seed = 42;
+    for(uint32 key_index = 0; key_index < key_count; ++key_index)
+    {
+        for(usize byte_index = 0; byte_index < key_size; ++byte_index)
+        {
+            seed = seed * 1664525 + 1013904223;
+            key[byte_index] = dgl_cast(uint8)(seed >> 24);
+        }
+        uint64 base = hash(key, key_size, 0);
+        for(usize bit = 0; bit < key_size * 8; ++bit)
+        {
+            key[bit / 8] ^= dgl_cast(uint8)(1 << (bit % 8));
+            uint64 diff = base ^ hash(key, key_size, 0);
+            key[bit / 8] ^= dgl_cast(uint8)(1 << (bit % 8));
+            for(uint32 out = 0; out < 64; ++out) { flips[out] += dgl_cast(uint32)((diff >> out) & 1); }
+            ++trials;
+        }
+    }
+
+    real64 result = 0;
+    for(uint32 out = 0; out < 64; ++out)
+    {
+        real64 bias = dgl_cast(real64)flips[out] / dgl_cast(real64)trials - 0.5;
+        result = dgl_max(result, bias < 0 ? -bias : bias);
+    }
+    return(result);
+}
+
+internal void
+run_tasks_serial(dgl_sort_task_F task, void **task_data, uint32 task_count)
+{
+    for(uint32 index = 0; index < task_count; ++index) { task(task_data[index]); }
+}
+
+internal void *
+scratch_thread(void *data)
+{
+    uint8 memory[1024];
+    dgl_mem_scratch_thread_init(memory, sizeof(memory));
+    DGL_Mem_Arena *scratch = dgl_mem_get_scratch(0, 0);
+    *dgl_cast(bool32 *)data = scratch->base == memory;
+    return(0);
+}
+
+typedef struct Atomic_Arena_Work
+{
+    DGL_Mem_Atomic_Arena *arena;
+    bool32 use_local_blocks;
+    uint8 fill;
+    uint32 allocation_count;
+    uint8 *allocations[2000];
+    usize sizes[2000];
+    uint32 misaligned;
+} Atomic_Arena_Work;
+
+internal void *
+atomic_arena_thread(void *data)
+{
+    Atomic_Arena_Work *work = dgl_cast(Atomic_Arena_Work *)data;
+    DGL_Mem_Arena local = {};
+    for(uint32 index = 0; index < array_count(work->allocations); ++index)
+    {
+        usize size = 1 + dgl_hash_uint32(index + work->fill * 10000u) % 200;
+        usize align = dgl_cast(usize)1 << (index % 7);
+        uint8 *memory = work->use_local_blocks ?
+            dgl_cast(uint8 *)dgl_mem_atomic_arena_alloc_local(work->arena, &local, size, align) :
+            dgl_cast(uint8 *)dgl_mem_atomic_arena_alloc_align(work->arena, size, align);
+        work->misaligned += (dgl_cast(uintptr)memory & (align - 1)) != 0;
+        dgl_memset(memory, work->fill, size);
+        work->allocations[index] = memory;
+        work->sizes[index] = size;
+        ++work->allocation_count;
+    }
+    return(0);
+}
+
+internal void
+sum_live_chunks(void *chunk, void *user_data)
+{
+    *dgl_cast(uint64 *)user_data += *dgl_cast(uint64 *)chunk;
+}
+
+#define EPOCH_WRITER_COUNT 2
+#define EPOCH_READER_COUNT 2
+#define EPOCH_SLOT_COUNT 16
+#define EPOCH_NODE_CHECK 0x5BD1E9955BD1E995ULL
+
+typedef struct Epoch_Node { uint64 value; uint64 check; } Epoch_Node;
+
+typedef struct Epoch_Stress
+{
+    DGL_Epoch epoch;
+    // NOTE(dgl): Every writer owns one row and replaces the nodes in it, readers read all rows.
+    uintptr volatile slots[EPOCH_WRITER_COUNT][EPOCH_SLOT_COUNT];
+    uint32 volatile readers_started;
+    uint32 volatile writers_done;
+    uint32 iterations;
+} Epoch_Stress;
+
+typedef struct Epoch_Stress_Thread
+{
+    Epoch_Stress *stress;
+    uint32 index;
+    DGL_Epoch_Thread record;
+    DGL_Mem_Pool pool;
+    uint64 reads;
+    uint64 corrupted;
+    uint8 pool_memory[512 * sizeof(Epoch_Node)];
+    uint8 retire_memory[kilobytes(32)];
+} Epoch_Stress_Thread;
+
+internal void *
+epoch_writer_thread(void *data)
+{
+    Epoch_Stress_Thread *thread = dgl_cast(Epoch_Stress_Thread *)data;
+    Epoch_Stress *stress = thread->stress;
+    uintptr volatile *slots = stress->slots[thread->index];
+    while(dgl_atomic_add_uint32(&stress->readers_started, 0) < EPOCH_READER_COUNT) { sched_yield(); }
+    for(uint32 index = 0; index < stress->iterations; ++index)
+    {
+        // NOTE(dgl): Readers can hold back the reclamation, wait until they let go.
+        while(!thread->pool.head)
+        {
+            dgl_epoch_collect(&thread->record);
+            sched_yield();
+        }
+
+        Epoch_Node *node = dgl_mem_pool_push(&thread->pool, Epoch_Node);
+        node->value = dgl_hash_uint64(index + (dgl_cast(uint64)thread->index << 32));
+        node->check = node->value ^ EPOCH_NODE_CHECK;
+
+        uintptr volatile *slot = slots + (index % EPOCH_SLOT_COUNT);
+        Epoch_Node *old_node = dgl_cast(Epoch_Node *)dgl_atomic_load_uintptr(slot);
+        dgl_atomic_store_uintptr(slot, dgl_cast(uintptr)node);
+        if(old_node) { dgl_epoch_retire(&thread->record, old_node, &thread->pool); }
+    }
+    dgl_epoch_thread_end(&thread->record);
+    dgl_atomic_add_uint32(&stress->writers_done, 1);
+    return(0);
+}
+
+internal void *
+epoch_reader_thread(void *data)
+{
+    Epoch_Stress_Thread *thread = dgl_cast(Epoch_Stress_Thread *)data;
+    Epoch_Stress *stress = thread->stress;
+    dgl_atomic_add_uint32(&stress->readers_started, 1);
+    // NOTE(dgl): One more pass after the writers are done, so every reader reads something.
+    for(bool32 done = false; !done;)
+    {
+        done = dgl_atomic_add_uint32(&stress->writers_done, 0) == EPOCH_WRITER_COUNT;
+        dgl_epoch_enter(&thread->record);
+        for(uint32 writer = 0; writer < EPOCH_WRITER_COUNT; ++writer)
+        {
+            for(uint32 index = 0; index < EPOCH_SLOT_COUNT; ++index)
+            {
+                Epoch_Node *node = dgl_cast(Epoch_Node *)dgl_atomic_load_uintptr(&stress->slots[writer][index]);
+                if(node)
+                {
+                    thread->corrupted += (node->value ^ EPOCH_NODE_CHECK) != node->check;
+                    ++thread->reads;
+                }
+            }
+        }
+        dgl_epoch_exit(&thread->record);
+    }
+    dgl_epoch_thread_end(&thread->record);
+    return(0);
+}
+
+internal usize
+pool_free_count(DGL_Mem_Pool *pool)
+{
+    usize result = 0;
+    for(DGL_Mem_Pool_Free_Node *node = pool->head; node; node = node->next) { ++result; }
+    return(result);
+}
+
+typedef struct Intern_Work
+{
+    DGL_Intern_Shared *shared;
+    char (*keys)[16];
+    uint32 key_count;
+    uint32 offset;
+    DGL_Intern_Id ids[4000];
+} Intern_Work;
+
+internal void *
+intern_thread(void *data)
+{
+    Intern_Work *work = dgl_cast(Intern_Work *)data;
+    for(uint32 index = 0; index < work->key_count; ++index)
+    {
+        // NOTE(dgl): Every thread starts at another key, so they race on the same strings.
+        uint32 key = (index + work->offset) % work->key_count;
+        work->ids[key] = dgl_intern_shared(work->shared, work->keys[key], dgl_string_length(work->keys[key]));
+    }
+    return(0);
+}
+
+// NOTE(dgl): Writes random text with the given share of ASCII, two, three and four byte code
+// points (in percent) and returns its size.
+internal usize
+random_utf8(uint8 *dest, usize code_point_count, uint32 *random, uint32 ascii, uint32 two, uint32 three)
+{
+    usize result = 0;
+    for(usize index = 0; index < code_point_count; ++index)
+    {
+        *random = dgl_hash_uint32(*random + 1);
+        uint32 kind = *random % 100;
+        uint32 value = *random >> 8;
+        uint32 code_point;
+        if(kind < ascii) { code_point = value % 0x80; }
+        else if(kind < ascii + two) { code_point = 0x80 + value % (0x800 - 0x80); }
+        else if(kind < ascii + two + three)
+        {
+            code_point = 0x800 + value % (0x10000 - 0x800 - 0x800);
+            if(code_point >= 0xD800) { code_point += 0x800; }
+        }
+        else { code_point = 0x10000 + value % (0x110000 - 0x10000); }
+        uint8 *bytes = dest + result;
+        if(code_point < 0x80) { bytes[0] = dgl_cast(uint8)code_point; result += 1; }
+        else if(code_point < 0x800)
+        {
+            bytes[0] = dgl_cast(uint8)(0xC0 | (code_point >> 6));
+            bytes[1] = dgl_cast(uint8)(0x80 | (code_point & 0x3F));
+            result += 2;
+        }
+        else if(code_point < 0x10000)
+        {
+            bytes[0] = dgl_cast(uint8)(0xE0 | (code_point >> 12));
+            bytes[1] = dgl_cast(uint8)(0x80 | ((code_point >> 6) & 0x3F));
+            bytes[2] = dgl_cast(uint8)(0x80 | (code_point & 0x3F));
+            result += 3;
+        }
+        else
+        {
+            bytes[0] = dgl_cast(uint8)(0xF0 | (code_point >> 18));
+            bytes[1] = dgl_cast(uint8)(0x80 | ((code_point >> 12) & 0x3F));
+            bytes[2] = dgl_cast(uint8)(0x80 | ((code_point >> 6) & 0x3F));
+            bytes[3] = dgl_cast(uint8)(0x80 | (code_point & 0x3F));
+            result += 4;
+        }
+    }
+    return(result);
+}
+
+// NOTE(dgl): Hashes all keys and returns the number of duplicate 64 bit hashes.
+internal uint32
+hash_collisions(uint64 *hashes, usize count)
+{
+    qsort(hashes, count, sizeof(uint64), compare_uint64);
+    uint32 result = 0;
+    for(usize index = 1; index < count; ++index) { result += hashes[index] == hashes[index - 1]; }
+    return(result);
+}
+
+typedef struct Log_File_Work
+{
+    DGL_Log_File *log_file;
+    uint32 thread_index;
+    uint32 line_count;
+} Log_File_Work;
+
+internal void *
+log_file_thread(void *data)
+{
+    Log_File_Work *work = dgl_cast(Log_File_Work *)data;
+    char line[64];
+    for(uint32 index = 0; index < work->line_count; ++index)
+    {
+        int32 length = snprintf(line, sizeof(line), "thread %u line %u\n", work->thread_index, index);
+        dgl_log_file_write(work->log_file, line, dgl_cast(usize)length);
+    }
+    return(0);
+}
+
+internal int64
+log_time_in_ms()
+{
+    return(1234);
+}
+
+typedef struct Log_Capture
+{
+    usize length;
+    char last;
+} Log_Capture;
+
+internal void
+log_capture_sink(void *user_data, char *line, usize length)
+{
+    Log_Capture *capture = dgl_cast(Log_Capture *)user_data;
+    capture->length = length;
+    capture->last = line[length - 1];
+}
+
+internal void
+remove_log_segments(char *base_path)
+{
+    char path[512];
+    for(uint32 index = 0;; ++index)
+    {
+        snprintf(path, sizeof(path), "%s.%06u.log", base_path, index);
+        if(remove(path) != 0) { break; }
+    }
+}
+
 int
 main(int argc, char **argv)
 {
@@ -25,6 +357,1194 @@ main(int argc, char **argv)
     }
     DGL_END_TEST();
 
+    DGL_BEGIN_TEST("Profiler call tree");
+    {
+        // NOTE(dgl): Thread records stay in the global list, so they cannot live on the stack.
+        local_persist DGL_Profile_Event events[256];
+        local_persist DGL_Profile_Thread thread;
+        dgl_profiler_thread_begin(&thread, events, array_count(events), "main");
+
+        for(int32 outer_index = 0; outer_index < 3; ++outer_index)
+        {
+            DGL_TIMED_BLOCK("outer");
+            for(int32 inner_index = 0; inner_index < 2; ++inner_index)
+            {
+                DGL_TIMED_BLOCK("inner");
+            }
+        }
+        dgl_profiler_thread_end();
+        DGL_TIMED_BLOCK("not recorded");
+
+        uint8 memory[4096] = {};
+        DGL_Mem_Arena arena = {};
+        dgl_mem_arena_init(&arena, memory, array_count(memory));
+
+        DGL_Profile_Node *root = dgl_profiler_build_tree(&arena, &thread);
+        DGL_Profile_Node *outer = root->first_child;
+        DGL_Profile_Node *inner = outer->first_child;
+
+        DGL_EXPECT_uint64(thread.write_index, ==, 18);
+        DGL_EXPECT_ptr(outer->next_sibling, ==, 0);
+        DGL_EXPECT_uint64(outer->hit_count, ==, 3);
+        DGL_EXPECT_uint64(inner->hit_count, ==, 6);
+        DGL_EXPECT_uint64(outer->self_cycles + inner->inclusive_cycles, ==, outer->inclusive_cycles);
+        DGL_EXPECT_uint64(inner->self_cycles, ==, inner->inclusive_cycles);
+        DGL_EXPECT_uint64(root->inclusive_cycles, ==, outer->inclusive_cycles);
+
+        DGL_String_Builder builder = dgl_string_builder_init(&arena, 256);
+        dgl_profiler_export_chrome_trace(&builder, 1000000);
+        DGL_EXPECT_bool32(strstr(builder.string, "{\"traceEvents\":[") == builder.string, ==, true);
+        DGL_EXPECT_bool32(strstr(builder.string, "\"name\":\"inner\",\"ph\":\"E\"") != 0, ==, true);
+    }
+    DGL_END_TEST();
+
+    DGL_BEGIN_TEST("Profiler ring buffer wrap");
+    {
+        local_persist DGL_Profile_Event events[8];
+        local_persist DGL_Profile_Thread thread;
+        dgl_profiler_thread_begin(&thread, events, array_count(events), "wrap");
+
+        for(int32 index = 0; index < 5; ++index)
+        {
+            DGL_TIMED_BLOCK("outer");
+            {
+                DGL_TIMED_BLOCK("inner");
+            }
+        }
+        dgl_profiler_thread_end();
+
+        uint8 memory[1024] = {};
+        DGL_Mem_Arena arena = {};
+        dgl_mem_arena_init(&arena, memory, array_count(memory));
+
+        // NOTE(dgl): Only the last 8 events (two complete outer blocks) are left in the ring buffer.
+        DGL_Profile_Node *root = dgl_profiler_build_tree(&arena, &thread);
+        DGL_EXPECT_uint64(root->first_child->hit_count, ==, 2);
+        DGL_EXPECT_uint64(root->first_child->first_child->hit_count, ==, 2);
+
+        // NOTE(dgl): Beginning a record again that is not the list head anymore continues it and
+        // does not link it twice.
+        local_persist DGL_Profile_Event other_events[8];
+        local_persist DGL_Profile_Thread other;
+        dgl_profiler_thread_begin(&other, other_events, array_count(other_events), "other");
+        dgl_profiler_thread_end();
+        dgl_profiler_thread_begin(&thread, events, array_count(events), "wrap");
+        {
+            DGL_TIMED_BLOCK("again");
+        }
+        dgl_profiler_thread_end();
+        DGL_EXPECT_uint64(thread.write_index, ==, 22);
+
+        uint32 thread_count = 0;
+        for(DGL_Profile_Thread *at = dgl_profiler_threads(); at && thread_count < 16; at = at->next) { ++thread_count; }
+        DGL_EXPECT_uint32(thread_count, ==, 3);
+    }
+    DGL_END_TEST();
+
+    DGL_BEGIN_TEST("Batch rounding matches scalar rounding");
+    {
+        real32 special[] = { 0.5f, -0.5f, 1.5f, -1.5f, 2.5f, -2.5f, 0.49999997f, -0.49999997f, 8388607.5f,
+                             16777215.0f, -0.0f, 0.0f, 254.5f, 255.5f, 300.0f, -40000.0f, 32767.5f, -32768.5f };
+        real32 source[1037];
+        uint32 seed = 1234567;
+        for(usize index = 0; index < array_count(source); ++index)
+        {
+            seed = seed * 1664525 + 1013904223;
+            real32 unit = dgl_cast(real32)(seed >> 8) / dgl_cast(real32)(1 << 24);
+            source[index] = (index < array_count(special)) ? special[index] : (unit - 0.5f) * 100000.0f;
+        }
+
+        int32 int32_result[array_count(source)];
+        int32 int32_clamped[array_count(source)];
+        int32 int32_truncated[array_count(source)];
+        int16 int16_result[array_count(source)];
+        uint8 uint8_result[array_count(source)];
+        dgl_round_real32_to_int32_array(int32_result, source, array_count(source));
+        dgl_clamp_round_real32_to_int32_array(int32_clamped, source, array_count(source), -1000, 20000);
+        dgl_truncate_real32_to_int32_array(int32_truncated, source, array_count(source));
+        dgl_round_real32_to_int16_array(int16_result, source, array_count(source));
+        dgl_round_real32_to_uint8_array(uint8_result, source, array_count(source));
+
+        int32 mismatches = 0;
+        for(usize index = 0; index < array_count(source); ++index)
+        {
+            real32 value = source[index];
+            mismatches += int32_result[index] != dgl_round_real32_to_int32(value);
+            mismatches += int32_clamped[index] != dgl_clamp_round_real32_to_int32(value, -1000, 20000);
+            mismatches += int32_truncated[index] != dgl_truncate_real32_to_int32(value);
+            mismatches += int16_result[index] != dgl_round_real32_to_int16(value);
+            mismatches += uint8_result[index] != dgl_round_real32_to_uint8(value);
+        }
+        DGL_EXPECT_int32(mismatches, ==, 0);
+        DGL_EXPECT_int32(int32_result[0], ==, 1);
+        DGL_EXPECT_int32(int32_result[3], ==, -2);
+        DGL_EXPECT_int32(int32_result[6], ==, 0);
+        DGL_EXPECT_int32(int16_result[15], ==, -32768);
+        DGL_EXPECT_uint8(uint8_result[13], ==, 255);
+
+        real32 unsigned_source[] = { 0.5f, 1.5f, 2147483520.0f, 2147483648.0f, 3000000000.0f, 4294967040.0f,
+                                     12.49f, 7.5f, 0.0f, 1.0f, 65535.5f };
+        uint32 uint32_result[array_count(unsigned_source)];
+        dgl_round_real32_to_uint32_array(uint32_result, unsigned_source, array_count(unsigned_source));
+        mismatches = 0;
+        for(usize index = 0; index < array_count(unsigned_source); ++index)
+        {
+            mismatches += uint32_result[index] != dgl_round_real32_to_uint32(unsigned_source[index]);
+        }
+        DGL_EXPECT_int32(mismatches, ==, 0);
+        DGL_EXPECT_uint32(uint32_result[4], ==, 3000000000u);
+
+        real32 saturated[] = { 3e9f, -3e9f, 2147483648.0f };
+        int32 saturated_result[array_count(saturated)];
+        dgl_clamp_round_real32_to_int32_array(saturated_result, saturated, array_count(saturated), dgl_cast(int32)0x80000000, 0x7FFFFFFF);
+        DGL_EXPECT_int32(saturated_result[0], ==, 0x7FFFFFFF);
+        DGL_EXPECT_int32(saturated_result[1], ==, dgl_cast(int32)0x80000000);
+        DGL_EXPECT_int32(saturated_result[2], ==, dgl_clamp_round_real32_to_int32(2147483648.0f, dgl_cast(int32)0x80000000, 0x7FFFFFFF));
+
+        real32 widened[array_count(source)];
+        dgl_int16_to_real32_array(widened, int16_result, array_count(source));
+        mismatches = 0;
+        for(usize index = 0; index < array_count(source); ++index)
+        {
+            mismatches += widened[index] != dgl_cast(real32)int16_result[index];
+        }
+        dgl_uint8_to_real32_array(widened, uint8_result, array_count(source));
+        for(usize index = 0; index < array_count(source); ++index)
+        {
+            mismatches += widened[index] != dgl_cast(real32)uint8_result[index];
+        }
+        DGL_EXPECT_int32(mismatches, ==, 0);
+    }
+    DGL_END_TEST();
+
+    DGL_BEGIN_TEST("Hash sanity");
+    {
+        // NOTE(dgl): Cpus without AES-NI check the portable hash twice.
+        hash_bytes_F hash_aes = (dgl_cpu_features() & DGL_CPU_FEATURE_AES) ? dgl_hash_bytes_aes : dgl_hash_bytes;
+
+        uint8 data[300];
+        for(usize index = 0; index < array_count(data); ++index) { data[index] = dgl_cast(uint8)(index * 31 + 7); }
+
+        DGL_EXPECT_uint64(dgl_hash_bytes(data, 100, 1), ==, dgl_hash_bytes(data, 100, 1));
+        DGL_EXPECT_uint64(dgl_hash_bytes(data, 100, 1), !=, dgl_hash_bytes(data, 100, 2));
+        DGL_EXPECT_uint64(dgl_hash_bytes_fast(data, 200, 1), !=, dgl_hash_bytes_fast(data, 200, 2));
+
+        // NOTE(dgl): Keys of only zeros must still differ by length.
+        uint8 zeros[256] = {};
+        uint64 zero_hashes[257];
+        uint64 zero_hashes_aes[257];
+        for(usize size = 0; size <= 256; ++size)
+        {
+            zero_hashes[size] = dgl_hash_bytes(zeros, size, 0);
+            zero_hashes_aes[size] = hash_aes(zeros, size, 0);
+        }
+        DGL_EXPECT_uint32(hash_collisions(zero_hashes, array_count(zero_hashes)), ==, 0);
+        DGL_EXPECT_uint32(hash_collisions(zero_hashes_aes, array_count(zero_hashes_aes)), ==, 0);
+
+        // NOTE(dgl): Streaming in uneven pieces has to produce the one shot value.
+        uint32 stream_mismatches = 0;
+        for(usize size = 0; size <= array_count(data); ++size)
+        {
+            for(usize piece = 1; piece <= 67; piece += 11)
+            {
+                DGL_Hash_State state;
+                dgl_hash_begin(&state, 99);
+                for(usize offset = 0; offset < size; offset += piece)
+                {
+                    dgl_hash_update(&state, data + offset, dgl_min(piece, size - offset));
+                }
+                stream_mismatches += dgl_hash_end(&state) != dgl_hash_bytes(data, size, 99);
+            }
+        }
+        DGL_EXPECT_uint32(stream_mismatches, ==, 0);
+
+        usize key_sizes[] = { 3, 4, 8, 13, 16, 24, 33, 48, 64, 100 };
+        real64 worst_bias = 0;
+        real64 worst_bias_aes = 0;
+        for(usize index = 0; index < array_count(key_sizes); ++index)
+        {
+            worst_bias = dgl_max(worst_bias, hash_avalanche_bias(dgl_hash_bytes, key_sizes[index], 128));
+            worst_bias_aes = dgl_max(worst_bias_aes, hash_avalanche_bias(hash_aes, key_sizes[index], 128));
+        }
+        DGL_EXPECT_real64(worst_bias, <, 0.05);
+        DGL_EXPECT_real64(worst_bias_aes, <, 0.05);
+
+        usize key_count = 100000;
+        uint64 *hashes = dgl_cast(uint64 *)malloc(key_count * sizeof(uint64));
+        for(uint32 key = 0; key < key_count; ++key) { hashes[key] = dgl_hash_bytes(&key, sizeof(key), 0); }
+        DGL_EXPECT_uint32(hash_collisions(hashes, key_count), ==, 0);
+        for(uint32 key = 0; key < key_count; ++key) { hashes[key] = hash_aes(&key, sizeof(key), 0); }
+        DGL_EXPECT_uint32(hash_collisions(hashes, key_count), ==, 0);
+        for(uint32 key = 0; key < key_count; ++key) { hashes[key] = dgl_hash_uint64(key); }
+        DGL_EXPECT_uint32(hash_collisions(hashes, key_count), ==, 0);
+        for(uint32 key = 0; key < key_count; ++key) { hashes[key] = dgl_hash_uint32(key); }
+        DGL_EXPECT_uint32(hash_collisions(hashes, key_count), ==, 0);
+        free(hashes);
+    }
+    DGL_END_TEST();
+
+    DGL_BEGIN_TEST("Radix sort");
+    {
+        usize scratch_size = megabytes(8);
+        uint8 *scratch_memory = dgl_cast(uint8 *)malloc(scratch_size);
+        DGL_Mem_Arena scratch = {};
+        dgl_mem_arena_init(&scratch, scratch_memory, scratch_size);
+
+        usize count = 100000;
+        uint32 *keys32 = dgl_cast(uint32 *)malloc(count * sizeof(uint32));
+        uint32 *values32 = dgl_cast(uint32 *)malloc(count * sizeof(uint32));
+        uint64 *keys64 = dgl_cast(uint64 *)malloc(count * sizeof(uint64));
+        uint64 *values64 = dgl_cast(uint64 *)malloc(count * sizeof(uint64));
+
+        uint32 unsorted = 0;
+        usize sizes[] = { 0, 1, 7, 64, 65, 1000, 100000 };
+        for(usize size_index = 0; size_index < array_count(sizes); ++size_index)
+        {
+            usize size = sizes[size_index];
+            for(usize index = 0; index < size; ++index) { keys32[index] = dgl_hash_uint32(dgl_cast(uint32)index); }
+            dgl_sort_uint32(keys32, size, &scratch);
+            for(usize index = 1; index < size; ++index) { unsorted += keys32[index - 1] > keys32[index]; }
+
+            int32 *signed32 = dgl_cast(int32 *)keys32;
+            for(usize index = 0; index < size; ++index) { signed32[index] = dgl_cast(int32)dgl_hash_uint32(dgl_cast(uint32)index) >> 4; }
+            dgl_sort_int32(signed32, size, &scratch);
+            for(usize index = 1; index < size; ++index) { unsorted += signed32[index - 1] > signed32[index]; }
+
+            real32 *real32_keys = dgl_cast(real32 *)keys32;
+            for(usize index = 0; index < size; ++index) { real32_keys[index] = dgl_cast(real32)(dgl_cast(int32)dgl_hash_uint32(dgl_cast(uint32)index)) * 1e-3f; }
+            dgl_sort_real32(real32_keys, size, &scratch);
+            for(usize index = 1; index < size; ++index) { unsorted += real32_keys[index - 1] > real32_keys[index]; }
+
+            for(usize index = 0; index < size; ++index) { keys64[index] = dgl_hash_uint64(index); }
+            dgl_sort_uint64(keys64, size, &scratch);
+            for(usize index = 1; index < size; ++index) { unsorted += keys64[index - 1] > keys64[index]; }
+
+            int64 *signed64 = dgl_cast(int64 *)keys64;
+            for(usize index = 0; index < size; ++index) { signed64[index] = dgl_cast(int64)dgl_hash_uint64(index) >> 20; }
+            dgl_sort_int64(signed64, size, &scratch);
+            for(usize index = 1; index < size; ++index) { unsorted += signed64[index - 1] > signed64[index]; }
+
+            real64 *real64_keys = dgl_cast(real64 *)keys64;
+            for(usize index = 0; index < size; ++index) { real64_keys[index] = dgl_cast(real64)dgl_cast(int64)dgl_hash_uint64(index) * 1e-9; }
+            dgl_sort_real64(real64_keys, size, &scratch);
+            for(usize index = 1; index < size; ++index) { unsorted += real64_keys[index - 1] > real64_keys[index]; }
+        }
+        DGL_EXPECT_uint32(unsorted, ==, 0);
+        DGL_EXPECT_usize(scratch.curr_offset, ==, 0);
+
+        real32 special[] = { 3.0f, -0.0f, -1.5f, 0.0f, -100.0f, 2.5f };
+        dgl_sort_real32(special, array_count(special), &scratch);
+        DGL_EXPECT_real32(special[0], ==, -100.0f);
+        DGL_EXPECT_real32(special[1], ==, -1.5f);
+        DGL_EXPECT_real32(special[5], ==, 3.0f);
+
+        // NOTE(dgl): Few distinct keys (skewed), values are the original positions, so equal keys
+        // must keep increasing values.
+        uint32 unstable = 0;
+        for(usize index = 0; index < count; ++index)
+        {
+            keys32[index] = 0xAB000000u | (dgl_hash_uint32(dgl_cast(uint32)index) & 0xF);
+            values32[index] = dgl_cast(uint32)index;
+            keys64[index] = dgl_cast(uint64)(dgl_hash_uint32(dgl_cast(uint32)index) & 0x3) << 40;
+            values64[index] = index;
+        }
+        dgl_sort_uint32_kv(keys32, values32, count, &scratch);
+        dgl_sort_uint64_kv(keys64, values64, count, &scratch);
+        for(usize index = 1; index < count; ++index)
+        {
+            unsorted += keys32[index - 1] > keys32[index];
+            unstable += keys32[index - 1] == keys32[index] && values32[index - 1] > values32[index];
+            unstable += keys32[index] != (0xAB000000u | (dgl_hash_uint32(values32[index]) & 0xF));
+            unsorted += keys64[index - 1] > keys64[index];
+            unstable += keys64[index - 1] == keys64[index] && values64[index - 1] > values64[index];
+        }
+        DGL_EXPECT_uint32(unsorted, ==, 0);
+        DGL_EXPECT_uint32(unstable, ==, 0);
+
+        real32 real_keys[] = { 2.0f, -1.0f, 2.0f, -3.0f };
+        uint32 real_values[] = { 0, 1, 2, 3 };
+        dgl_sort_real32_kv(real_keys, real_values, array_count(real_keys), &scratch);
+        DGL_EXPECT_uint32(real_values[0], ==, 3);
+        DGL_EXPECT_uint32(real_values[1], ==, 1);
+        DGL_EXPECT_uint32(real_values[2], ==, 0);
+        DGL_EXPECT_uint32(real_values[3], ==, 2);
+
+        for(usize index = 0; index < count; ++index)
+        {
+            keys32[index] = dgl_hash_uint32(dgl_cast(uint32)index) >> 8;
+            keys64[index] = dgl_hash_uint64(index);
+        }
+        dgl_sort_uint32_parallel(keys32, count, &scratch, 4, run_tasks_serial);
+        dgl_sort_uint64_parallel(keys64, count, &scratch, 3, run_tasks_serial);
+        for(usize index = 1; index < count; ++index)
+        {
+            unsorted += keys32[index - 1] > keys32[index];
+            unsorted += keys64[index - 1] > keys64[index];
+        }
+        DGL_EXPECT_uint32(unsorted, ==, 0);
+        DGL_EXPECT_usize(scratch.curr_offset, ==, 0);
+
+        free(keys32);
+        free(values32);
+        free(keys64);
+        free(values64);
+        free(scratch_memory);
+    }
+    DGL_END_TEST();
+
+    DGL_BEGIN_TEST("Relocatable arena image");
+    {
+        typedef struct Image_Node { DGL_Rel_Ptr next; uint32 value; } Image_Node;
+        typedef struct Image_Root { DGL_Rel_Ptr first; uint32 count; } Image_Root;
+
+        usize memory_size = kilobytes(64);
+        uint8 *memory = dgl_cast(uint8 *)malloc(memory_size);
+        DGL_Mem_Arena arena = {};
+        dgl_mem_arena_init(&arena, memory, memory_size);
+
+        Image_Root *root = dgl_mem_arena_push_struct(&arena, Image_Root);
+        Image_Node *prev = 0;
+        for(uint32 index = 0; index < 100; ++index)
+        {
+            Image_Node *node = dgl_mem_arena_push_struct(&arena, Image_Node);
+            node->value = index * 3;
+            if(prev) { dgl_rel_ptr_set(prev->next, node); }
+            else { dgl_rel_ptr_set(root->first, node); }
+            prev = node;
+        }
+        root->count = 100;
+        DGL_EXPECT_usize(dgl_mem_arena_offset_of(&arena, root), ==, 0);
+
+        char *path = "dgl_test_arena.img";
+        DGL_EXPECT_bool32(dgl_mem_arena_save_image(&arena, path), ==, true);
+        dgl_memset(memory, 0xCD, memory_size);
+        free(memory);
+
+        DGL_Mem_Arena loaded = {};
+        DGL_EXPECT_bool32(dgl_mem_arena_load_image(&loaded, path, true), ==, true);
+        DGL_EXPECT_usize(loaded.size, ==, memory_size);
+
+        Image_Root *loaded_root = dgl_mem_arena_at(&loaded, Image_Root, 0);
+        uint32 node_count = 0;
+        uint32 wrong_values = 0;
+        for(Image_Node *node = dgl_rel_ptr_get(Image_Node, loaded_root->first); node; node = dgl_rel_ptr_get(Image_Node, node->next))
+        {
+            wrong_values += node->value != node_count * 3;
+            ++node_count;
+        }
+        DGL_EXPECT_uint32(loaded_root->count, ==, 100);
+        DGL_EXPECT_uint32(node_count, ==, 100);
+        DGL_EXPECT_uint32(wrong_values, ==, 0);
+
+        // NOTE(dgl): The loaded arena keeps allocating behind the image.
+        uint8 *more = dgl_cast(uint8 *)dgl_mem_arena_push(&loaded, kilobytes(32));
+        more[kilobytes(32) - 1] = 1;
+        DGL_EXPECT_bool32(more > dgl_cast(uint8 *)loaded_root, ==, true);
+        dgl_mem_arena_unload_image(&loaded);
+
+        FILE *file = fopen(path, "r+b");
+        fseek(file, DGL_MEM_ARENA_IMAGE_HEADER_SIZE + 40, SEEK_SET);
+        fputc(0xFF, file);
+        fclose(file);
+        DGL_EXPECT_bool32(dgl_mem_arena_load_image(&loaded, path, true), ==, false);
+        DGL_EXPECT_bool32(dgl_mem_arena_load_image(&loaded, "does_not_exist.img", false), ==, false);
+        remove(path);
+    }
+    DGL_END_TEST();
+
+    DGL_BEGIN_TEST("Thread local scratch arenas");
+    {
+        // NOTE(dgl): The scratch arenas of the main thread keep pointing here after the test.
+        local_persist uint8 scratch_memory[4096];
+        dgl_mem_scratch_thread_init(scratch_memory, sizeof(scratch_memory));
+
+        uint8 output_memory[256];
+        DGL_Mem_Arena output = {};
+        dgl_mem_arena_init(&output, output_memory, sizeof(output_memory));
+
+        DGL_Mem_Arena *conflicts[] = { &output };
+        DGL_Mem_Temp_Arena outer = dgl_mem_scratch_begin(conflicts, array_count(conflicts));
+        DGL_EXPECT_ptr(outer.arena->base, ==, scratch_memory);
+        uint32 *persistent = dgl_mem_arena_push_array(outer.arena, uint32, 4);
+        persistent[3] = 0xABCD;
+
+        // NOTE(dgl): A nested call writing its result into the outer scratch arena gets the other one.
+        DGL_Mem_Arena *nested_conflicts[] = { outer.arena };
+        DGL_Mem_Temp_Arena inner = dgl_mem_scratch_begin(nested_conflicts, array_count(nested_conflicts));
+        DGL_EXPECT_ptr(inner.arena, !=, outer.arena);
+        dgl_memset(dgl_mem_arena_push(inner.arena, 64), 0xFF, 64);
+        dgl_mem_scratch_end(inner);
+        DGL_EXPECT_usize(inner.arena->curr_offset, ==, 0);
+        DGL_EXPECT_uint32(persistent[3], ==, 0xABCD);
+
+        dgl_mem_scratch_end(outer);
+        DGL_EXPECT_usize(outer.arena->curr_offset, ==, 0);
+
+        bool32 thread_uses_own_memory = false;
+        pthread_t thread;
+        pthread_create(&thread, 0, scratch_thread, &thread_uses_own_memory);
+        pthread_join(thread, 0);
+        DGL_EXPECT_bool32(thread_uses_own_memory, ==, true);
+        DGL_EXPECT_ptr(dgl_mem_get_scratch(0, 0)->base, ==, scratch_memory);
+    }
+    DGL_END_TEST();
+
+    DGL_BEGIN_TEST("Atomic arena from multiple threads");
+    {
+        usize memory_size = megabytes(8);
+        uint8 *memory = dgl_cast(uint8 *)malloc(memory_size);
+        DGL_Mem_Atomic_Arena arena = {};
+        dgl_mem_atomic_arena_init(&arena, memory + 3, memory_size - 3);
+
+        for(int32 use_local_blocks = 0; use_local_blocks < 2; ++use_local_blocks)
+        {
+            dgl_mem_atomic_arena_free_all(&arena);
+            Atomic_Arena_Work work[4] = {};
+            pthread_t threads[4];
+            for(int32 index = 0; index < 4; ++index)
+            {
+                work[index].arena = &arena;
+                work[index].use_local_blocks = use_local_blocks;
+                work[index].fill = dgl_cast(uint8)(index + 1);
+                pthread_create(threads + index, 0, atomic_arena_thread, work + index);
+            }
+
+            uint32 misaligned = 0;
+            uint32 overwritten = 0;
+            for(int32 index = 0; index < 4; ++index)
+            {
+                pthread_join(threads[index], 0);
+                misaligned += work[index].misaligned;
+            }
+            for(int32 index = 0; index < 4; ++index)
+            {
+                for(uint32 allocation = 0; allocation < work[index].allocation_count; ++allocation)
+                {
+                    for(usize byte = 0; byte < work[index].sizes[allocation]; ++byte)
+                    {
+                        overwritten += work[index].allocations[allocation][byte] != work[index].fill;
+                    }
+                }
+            }
+            DGL_EXPECT_uint32(misaligned, ==, 0);
+            DGL_EXPECT_uint32(overwritten, ==, 0);
+        }
+
+        DGL_Mem_Atomic_Arena small = {};
+        uint8 small_memory[64];
+        dgl_mem_atomic_arena_init(&small, small_memory, sizeof(small_memory));
+        DGL_EXPECT_ptr(dgl_mem_atomic_arena_push(&small, 32), !=, 0);
+        DGL_EXPECT_ptr(dgl_mem_atomic_arena_push(&small, 64), ==, 0);
+        free(memory);
+    }
+    DGL_END_TEST();
+
+    DGL_BEGIN_TEST("Bitmap pool");
+    {
+        typedef struct Bitmap_Entity { uint64 id; real32 position[3]; } Bitmap_Entity;
+
+        uint8 memory[8192];
+        DGL_Mem_Bitmap_Pool pool = {};
+        dgl_mem_bitmap_pool_init_struct(&pool, memory + 1, sizeof(memory) - 1, Bitmap_Entity);
+        DGL_EXPECT_usize(pool.chunk_size, ==, 32);
+        DGL_EXPECT_usize(pool.chunk_count, ==, 254);
+        DGL_EXPECT_bool32(pool.base + pool.chunk_count * pool.chunk_size <= memory + sizeof(memory), ==, true);
+        DGL_EXPECT_int32(dgl_cast(int32)(dgl_cast(uintptr)pool.base % DEFAULT_ALIGNMENT), ==, 0);
+
+        Bitmap_Entity *entities[254];
+        uint32 not_ascending = 0;
+        for(uint32 index = 0; index < pool.chunk_count; ++index)
+        {
+            entities[index] = dgl_mem_bitmap_pool_push(&pool, Bitmap_Entity);
+            entities[index]->id = index;
+            not_ascending += index > 0 && dgl_cast(uint8 *)entities[index] != dgl_cast(uint8 *)entities[index - 1] + pool.chunk_size;
+        }
+        DGL_EXPECT_uint32(not_ascending, ==, 0);
+        DGL_EXPECT_ptr(dgl_mem_bitmap_pool_alloc(&pool), ==, 0);
+
+        dgl_mem_bitmap_pool_release(&pool, entities[200]);
+        dgl_mem_bitmap_pool_release(&pool, entities[70]);
+        dgl_mem_bitmap_pool_release(&pool, entities[5]);
+        DGL_EXPECT_usize(pool.live_count, ==, 251);
+        DGL_EXPECT_ptr(dgl_mem_bitmap_pool_push(&pool, Bitmap_Entity), ==, entities[5]);
+        DGL_EXPECT_ptr(dgl_mem_bitmap_pool_push(&pool, Bitmap_Entity), ==, entities[70]);
+        DGL_EXPECT_uint64(entities[70]->id, ==, 0);
+        entities[5]->id = 5;
+        entities[70]->id = 70;
+
+        // NOTE(dgl): Release every odd chunk at once. The even chunk 200 is still free.
+        uint64 odd_mask[4];
+        for(uint32 index = 0; index < array_count(odd_mask); ++index) { odd_mask[index] = 0xAAAAAAAAAAAAAAAAULL; }
+        dgl_mem_bitmap_pool_release_mask(&pool, odd_mask, array_count(odd_mask));
+        DGL_EXPECT_usize(pool.live_count, ==, 126);
+
+        DGL_Mem_Bitmap_Pool_Iter iter = dgl_mem_bitmap_pool_iter(&pool);
+        uint32 visited = 0;
+        uint32 wrong_order = 0;
+        uint64 id_sum = 0;
+        Bitmap_Entity *previous = 0;
+        for(Bitmap_Entity *entity; (entity = dgl_cast(Bitmap_Entity *)dgl_mem_bitmap_pool_iter_next(&iter));)
+        {
+            wrong_order += (entity->id % 2) != 0 || entity->id == 200 || entity <= previous;
+            id_sum += entity->id;
+            previous = entity;
+            ++visited;
+        }
+        DGL_EXPECT_uint32(visited, ==, 126);
+        DGL_EXPECT_uint32(wrong_order, ==, 0);
+
+        uint64 callback_sum = 0;
+        dgl_mem_bitmap_pool_for_each_live(&pool, sum_live_chunks, &callback_sum);
+        DGL_EXPECT_uint64(callback_sum, ==, id_sum);
+
+        dgl_mem_bitmap_pool_free_all(&pool);
+        iter = dgl_mem_bitmap_pool_iter(&pool);
+        DGL_EXPECT_ptr(dgl_mem_bitmap_pool_iter_next(&iter), ==, 0);
+        DGL_EXPECT_ptr(dgl_mem_bitmap_pool_push(&pool, Bitmap_Entity), ==, entities[0]);
+    }
+    DGL_END_TEST();
+
+    DGL_BEGIN_TEST("Generational handle pool");
+    {
+        typedef struct Handle_Entity { uint64 id; DGL_Mem_Handle parent; } Handle_Entity;
+
+        uint8 memory[4096];
+        DGL_Mem_Handle_Pool pool = {};
+        dgl_mem_handle_pool_init_struct(&pool, memory, sizeof(memory), Handle_Entity);
+        DGL_EXPECT_usize(pool.chunk_count, ==, 227);
+        DGL_EXPECT_bool32(pool.pool.base + pool.pool.size <= memory + sizeof(memory), ==, true);
+
+        DGL_Mem_Handle first = dgl_mem_handle_pool_alloc(&pool);
+        DGL_Mem_Handle second = dgl_mem_handle_pool_alloc(&pool);
+        DGL_EXPECT_uint32(first, !=, 0);
+        DGL_EXPECT_uint32(dgl_mem_handle_index(first), ==, 0);
+        DGL_EXPECT_uint32(dgl_mem_handle_index(second), ==, 1);
+        DGL_EXPECT_ptr(dgl_mem_handle_pool_resolve(&pool, 0), ==, 0);
+
+        Handle_Entity *entity = dgl_mem_handle_pool_get(&pool, first, Handle_Entity);
+        entity->id = 42;
+        entity->parent = second;
+        DGL_EXPECT_uint32(dgl_mem_handle_pool_handle_of(&pool, entity), ==, first);
+
+        DGL_EXPECT_bool32(dgl_mem_handle_pool_release(&pool, first), ==, true);
+        DGL_EXPECT_bool32(dgl_mem_handle_pool_release(&pool, first), ==, false);
+        DGL_EXPECT_ptr(dgl_mem_handle_pool_resolve(&pool, first), ==, 0);
+        DGL_EXPECT_uint32(dgl_mem_handle_pool_handle_of(&pool, entity), ==, 0);
+
+        // NOTE(dgl): The chunk is recycled, but the old handle must stay stale.
+        DGL_Mem_Handle third = dgl_mem_handle_pool_alloc(&pool);
+        DGL_EXPECT_uint32(dgl_mem_handle_index(third), ==, dgl_mem_handle_index(first));
+        DGL_EXPECT_uint32(third, !=, first);
+        DGL_EXPECT_ptr(dgl_mem_handle_pool_get(&pool, third, Handle_Entity), ==, entity);
+        DGL_EXPECT_uint64(entity->id, ==, 0);
+        DGL_EXPECT_ptr(dgl_mem_handle_pool_resolve(&pool, first), ==, 0);
+
+        // NOTE(dgl): Cycle one chunk through every generation. The null handle is never produced.
+        uint32 null_handles = 0;
+        uint32 stale_resolved = 0;
+        for(uint32 index = 0; index < 2 * DGL_MEM_HANDLE_GENERATION_MASK; ++index)
+        {
+            DGL_Mem_Handle handle = dgl_mem_handle_pool_alloc(&pool);
+            null_handles += handle == 0;
+            dgl_mem_handle_pool_release(&pool, handle);
+            stale_resolved += dgl_mem_handle_pool_resolve(&pool, handle) != 0;
+        }
+        DGL_EXPECT_uint32(null_handles, ==, 0);
+        DGL_EXPECT_uint32(stale_resolved, ==, 0);
+
+        usize allocated = 2;
+        while(dgl_mem_handle_pool_alloc(&pool)) { ++allocated; }
+        DGL_EXPECT_usize(allocated, ==, pool.chunk_count);
+        DGL_EXPECT_usize(pool.live_count, ==, pool.chunk_count);
+
+        dgl_mem_handle_pool_free_all(&pool);
+        DGL_EXPECT_usize(pool.live_count, ==, 0);
+        DGL_EXPECT_ptr(dgl_mem_handle_pool_resolve(&pool, second), ==, 0);
+        DGL_EXPECT_ptr(dgl_mem_handle_pool_resolve(&pool, third), ==, 0);
+    }
+    DGL_END_TEST();
+
+    DGL_BEGIN_TEST("Memory pool reuses released chunks");
+    {
+        uint8 memory[1024];
+        DGL_Mem_Pool pool = {};
+        dgl_mem_pool_init(&pool, memory, sizeof(memory), 64);
+
+        uint64 *first = dgl_mem_pool_push(&pool, uint64);
+        uint64 *second = dgl_mem_pool_push(&pool, uint64);
+        DGL_EXPECT_ptr(first, !=, second);
+        DGL_EXPECT_ptr(dgl_cast(uint8 *)second, ==, dgl_cast(uint8 *)first + pool.chunk_size);
+
+        dgl_mem_pool_release(&pool, first);
+        DGL_EXPECT_ptr(dgl_mem_pool_push(&pool, uint64), ==, first);
+
+        dgl_mem_pool_free_all(&pool);
+        usize allocated = 0;
+        while(pool.head) { dgl_mem_pool_push(&pool, uint64); ++allocated; }
+        DGL_EXPECT_usize(allocated, ==, pool.size / pool.chunk_size);
+    }
+    DGL_END_TEST();
+
+    DGL_BEGIN_TEST("Epoch reclamation waits for readers");
+    {
+        uint8 writer_memory[kilobytes(4)];
+        uint8 reader_memory[kilobytes(4)];
+        uint8 pool_memory[8 * sizeof(Epoch_Node)];
+        DGL_Epoch epoch;
+        DGL_Epoch_Thread writer;
+        DGL_Epoch_Thread reader;
+        DGL_Mem_Pool pool = {};
+        dgl_epoch_init(&epoch);
+        dgl_epoch_thread_register(&epoch, &writer, writer_memory, sizeof(writer_memory));
+        dgl_epoch_thread_register(&epoch, &reader, reader_memory, sizeof(reader_memory));
+        dgl_mem_pool_init_struct(&pool, pool_memory, sizeof(pool_memory), Epoch_Node);
+
+        Epoch_Node *node = dgl_mem_pool_push(&pool, Epoch_Node);
+        usize free_before = pool_free_count(&pool);
+
+        dgl_epoch_enter(&reader);
+        dgl_epoch_enter(&reader);
+        dgl_epoch_exit(&reader);
+        DGL_EXPECT_bool32(dgl_epoch_retire(&writer, node, &pool), ==, true);
+
+        // NOTE(dgl): The reader is pinned, the epoch can advance at most once.
+        usize released = 0;
+        for(uint32 round = 0; round < 4; ++round) { released += dgl_epoch_collect(&writer); }
+        DGL_EXPECT_usize(released, ==, 0);
+        DGL_EXPECT_usize(pool_free_count(&pool), ==, free_before);
+
+        dgl_epoch_exit(&reader);
+        for(uint32 round = 0; round < 2; ++round) { released += dgl_epoch_collect(&writer); }
+        DGL_EXPECT_usize(released, ==, 1);
+        DGL_EXPECT_usize(writer.retired_count, ==, 0);
+        DGL_EXPECT_ptr(dgl_mem_pool_push(&pool, Epoch_Node), ==, node);
+
+        // NOTE(dgl): Retire lists reuse their blocks, so the memory does not run out.
+        uint32 failed = 0;
+        for(uint32 index = 0; index < 10000; ++index)
+        {
+            while(!pool.head) { dgl_epoch_collect(&writer); }
+            failed += !dgl_epoch_retire(&writer, dgl_mem_pool_push(&pool, Epoch_Node), &pool);
+        }
+        DGL_EXPECT_bool32(writer.arena.curr_offset <= 2 * sizeof(DGL_Epoch_Block), ==, true);
+        DGL_EXPECT_uint32(failed, ==, 0);
+    }
+    DGL_END_TEST();
+
+    DGL_BEGIN_TEST("Epoch reclamation stress");
+    {
+        Epoch_Stress stress = {};
+        stress.iterations = 100000;
+        dgl_epoch_init(&stress.epoch);
+
+        Epoch_Stress_Thread *threads = dgl_cast(Epoch_Stress_Thread *)calloc(EPOCH_WRITER_COUNT + EPOCH_READER_COUNT, sizeof(Epoch_Stress_Thread));
+        pthread_t handles[EPOCH_WRITER_COUNT + EPOCH_READER_COUNT];
+        for(uint32 index = 0; index < EPOCH_WRITER_COUNT + EPOCH_READER_COUNT; ++index)
+        {
+            Epoch_Stress_Thread *thread = threads + index;
+            thread->stress = &stress;
+            thread->index = index;
+            dgl_epoch_thread_register(&stress.epoch, &thread->record, thread->retire_memory, sizeof(thread->retire_memory));
+            dgl_mem_pool_init_struct(&thread->pool, thread->pool_memory, sizeof(thread->pool_memory), Epoch_Node);
+        }
+
+        for(uint32 index = 0; index < EPOCH_WRITER_COUNT + EPOCH_READER_COUNT; ++index)
+        {
+            pthread_create(handles + index, 0, index < EPOCH_WRITER_COUNT ? epoch_writer_thread : epoch_reader_thread, threads + index);
+        }
+
+        uint64 reads = 0;
+        uint64 corrupted = 0;
+        for(uint32 index = 0; index < EPOCH_WRITER_COUNT + EPOCH_READER_COUNT; ++index)
+        {
+            pthread_join(handles[index], 0);
+            reads += threads[index].reads;
+            corrupted += threads[index].corrupted;
+        }
+        DGL_EXPECT_uint64(corrupted, ==, 0);
+        DGL_EXPECT_bool32(reads > 0, ==, true);
+
+        // NOTE(dgl): Nobody is reading anymore, so everything except the published nodes comes back.
+        uint32 leaked = 0;
+        for(uint32 index = 0; index < EPOCH_WRITER_COUNT; ++index)
+        {
+            Epoch_Stress_Thread *thread = threads + index;
+            for(uint32 round = 0; round < 2; ++round) { dgl_epoch_collect(&thread->record); }
+            usize chunk_count = thread->pool.size / thread->pool.chunk_size;
+            leaked += pool_free_count(&thread->pool) + EPOCH_SLOT_COUNT != chunk_count;
+        }
+        DGL_EXPECT_uint32(leaked, ==, 0);
+        free(threads);
+    }
+    DGL_END_TEST();
+
+    DGL_BEGIN_TEST("String interning");
+    {
+        usize memory_size = megabytes(4);
+        uint8 *memory = dgl_cast(uint8 *)malloc(memory_size);
+        DGL_Mem_Arena arena;
+        dgl_mem_arena_init(&arena, memory, memory_size);
+
+        DGL_Intern_Table table;
+        dgl_intern_init(&table, &arena, 0);
+        DGL_Intern_Id hello = dgl_intern_cstring(&table, "hello");
+        DGL_Intern_Id world = dgl_intern_cstring(&table, "world");
+        DGL_Intern_Id empty = dgl_intern(&table, "", 0);
+        DGL_EXPECT_uint32(hello, ==, 1);
+        DGL_EXPECT_uint32(world, ==, 2);
+        DGL_EXPECT_uint32(empty, ==, 3);
+        DGL_EXPECT_uint32(dgl_intern(&table, "hello world", 5), ==, hello);
+        DGL_EXPECT_uint32(dgl_intern_find(&table, "hell", 4), ==, 0);
+        DGL_EXPECT_usize(dgl_intern_length(&table, world), ==, 5);
+        DGL_EXPECT_int32(strcmp(dgl_intern_string(&table, hello), "hello"), ==, 0);
+        char *canonical = dgl_intern_string(&table, hello);
+
+        // NOTE(dgl): Grow the table many times, ids and pointers have to stay the same.
+        static char keys[4000][16];
+        DGL_Intern_Id ids[4000];
+        uint32 wrong_ids = 0;
+        for(uint32 index = 0; index < array_count(keys); ++index)
+        {
+            snprintf(keys[index], sizeof(keys[index]), "key_%u", index * 7919);
+            ids[index] = dgl_intern_cstring(&table, keys[index]);
+            wrong_ids += ids[index] != index + 4;
+        }
+        DGL_EXPECT_uint32(wrong_ids, ==, 0);
+        DGL_EXPECT_usize(table.count, ==, array_count(keys) + 3);
+        DGL_EXPECT_ptr(dgl_intern_string(&table, hello), ==, canonical);
+
+        uint32 lost = 0;
+        for(uint32 index = 0; index < array_count(keys); ++index)
+        {
+            lost += dgl_intern_find(&table, keys[index], dgl_string_length(keys[index])) != ids[index];
+            lost += strcmp(dgl_intern_string(&table, ids[index]), keys[index]) != 0;
+        }
+        DGL_EXPECT_uint32(lost, ==, 0);
+
+        // NOTE(dgl): Bulk interning mixes known and new strings.
+        char *bulk[] = { "world", "alpha", "key_7919", "beta", "alpha" };
+        DGL_Intern_Id bulk_ids[array_count(bulk)];
+        dgl_intern_bulk(&table, bulk, 0, array_count(bulk), bulk_ids);
+        DGL_EXPECT_uint32(bulk_ids[0], ==, world);
+        DGL_EXPECT_uint32(bulk_ids[2], ==, ids[1]);
+        DGL_EXPECT_uint32(bulk_ids[1], ==, bulk_ids[4]);
+        DGL_EXPECT_uint32(bulk_ids[3], ==, bulk_ids[1] + 1);
+
+        // NOTE(dgl): The shared table has to hand out one id per string across threads.
+        dgl_mem_arena_free_all(&arena);
+        DGL_Intern_Shared *shared = dgl_mem_arena_push_struct(&arena, DGL_Intern_Shared);
+        usize shared_size = megabytes(2);
+        dgl_intern_shared_init(shared, dgl_mem_arena_push_array(&arena, uint8, shared_size), shared_size, 64);
+
+        Intern_Work *work = dgl_cast(Intern_Work *)calloc(4, sizeof(Intern_Work));
+        pthread_t threads[4];
+        for(uint32 index = 0; index < 4; ++index)
+        {
+            work[index].shared = shared;
+            work[index].keys = keys;
+            work[index].key_count = array_count(keys);
+            work[index].offset = index * 997;
+            pthread_create(threads + index, 0, intern_thread, work + index);
+        }
+        for(uint32 index = 0; index < 4; ++index) { pthread_join(threads[index], 0); }
+
+        uint32 disagree = 0;
+        for(uint32 index = 0; index < array_count(keys); ++index)
+        {
+            for(uint32 thread = 1; thread < 4; ++thread) { disagree += work[thread].ids[index] != work[0].ids[index]; }
+            disagree += strcmp(dgl_intern_shared_string(shared, work[0].ids[index]), keys[index]) != 0;
+        }
+        DGL_EXPECT_uint32(disagree, ==, 0);
+
+        usize shared_count = 0;
+        for(uint32 index = 0; index < DGL_INTERN_SHARD_COUNT; ++index) { shared_count += shared->shards[index].count; }
+        DGL_EXPECT_usize(shared_count, ==, array_count(keys));
+
+        char *shared_bulk[] = { keys[10], "gamma", keys[3999] };
+        DGL_Intern_Id shared_bulk_ids[array_count(shared_bulk)];
+        dgl_intern_shared_bulk(shared, shared_bulk, 0, array_count(shared_bulk), shared_bulk_ids);
+        DGL_EXPECT_uint32(shared_bulk_ids[0], ==, work[0].ids[10]);
+        DGL_EXPECT_uint32(shared_bulk_ids[2], ==, work[0].ids[3999]);
+        DGL_EXPECT_uint32(dgl_intern_shared_find(shared, "gamma", 5), ==, shared_bulk_ids[1]);
+
+        free(work);
+        free(memory);
+    }
+    DGL_END_TEST();
+
+    DGL_BEGIN_TEST("UTF-8 validation and transcoding");
+    {
+        usize memory_size = megabytes(1);
+        uint8 *memory = dgl_cast(uint8 *)malloc(memory_size);
+        DGL_Mem_Arena arena;
+        dgl_mem_arena_init(&arena, memory, memory_size);
+
+        struct { char *bytes; bool32 valid; } cases[] =
+        {
+            { "", true }, { "plain ascii", true }, { "\xC3\xA4\xE2\x82\xAC\xF0\x9F\x98\x80", true },
+            { "\xC0\xAF", false },         // NOTE(dgl): overlong
+            { "\xE0\x80\xAF", false },     // NOTE(dgl): overlong
+            { "\xED\xA0\x80", false },     // NOTE(dgl): surrogate
+            { "\xF4\x90\x80\x80", false }, // NOTE(dgl): above U+10FFFF
+            { "\xF5\x80\x80\x80", false },
+            { "\x80", false },             // NOTE(dgl): stray continuation
+            { "\xE2\x82", false },         // NOTE(dgl): truncated
+            { "\xF0\x9F\x98\x80\x80", false },
+            { "0123456789abcd\xE2\x82\xAC", true }, // NOTE(dgl): crosses the block boundary
+            { "0123456789abcde\xE2\x82", false },
+        };
+        uint32 wrong_cases = 0;
+        for(uint32 index = 0; index < array_count(cases); ++index)
+        {
+            usize size = dgl_string_length(cases[index].bytes);
+            wrong_cases += dgl_utf8_validate(dgl_cast(uint8 *)cases[index].bytes, size) != cases[index].valid;
+            wrong_cases += dgl_utf8_validate_scalar(dgl_cast(uint8 *)cases[index].bytes, size) != cases[index].valid;
+        }
+        DGL_EXPECT_uint32(wrong_cases, ==, 0);
+
+        // NOTE(dgl): Random text with random corruption, at all lengths and offsets (AVX2, SSE and
+        // tail paths). The scalar validator is the reference.
+        uint8 text[1024];
+        uint32 random = 1234;
+        uint32 mismatches = 0;
+        uint32 valid_count = 0;
+        for(uint32 round = 0; round < 4000; ++round)
+        {
+            usize size = random_utf8(text, 1 + round % 100, &random, 60, 20, 15);
+            size = dgl_min(size, sizeof(text));
+            uint32 corruptions = round % 3;
+            for(uint32 corruption = 0; corruption < corruptions; ++corruption)
+            {
+                random = dgl_hash_uint32(random);
+                text[random % size] = dgl_cast(uint8)(random >> 24);
+            }
+            usize offset = round % 7;
+            if(offset < size)
+            {
+                bool32 expected = dgl_utf8_validate_scalar(text + offset, size - offset);
+                mismatches += dgl_utf8_validate(text + offset, size - offset) != expected;
+                valid_count += expected;
+            }
+        }
+        DGL_EXPECT_uint32(mismatches, ==, 0);
+        DGL_EXPECT_bool32(valid_count > 1000 && valid_count < 3500, ==, true);
+
+        // NOTE(dgl): Round trips through UTF-16 and UTF-32.
+        uint32 round_trip_errors = 0;
+        for(uint32 round = 0; round < 200; ++round)
+        {
+            usize code_point_count = round;
+            usize size = random_utf8(text, code_point_count, &random, round % 2 ? 95 : 20, 30, 30);
+            dgl_assert(size <= sizeof(text), "Test text is too long");
+
+            DGL_Mem_Temp_Arena temp = dgl_mem_arena_begin_temp(&arena);
+            usize count_16;
+            usize count_32;
+            usize size_8;
+            uint16 *utf16 = dgl_utf8_to_utf16(&arena, text, size, &count_16);
+            uint32 *utf32 = dgl_utf8_to_utf32(&arena, text, size, &count_32);
+            round_trip_errors += count_32 != code_point_count || utf32[count_32] != 0;
+            round_trip_errors += dgl_utf8_count_code_points(text, size) != code_point_count;
+
+            uint8 *from_16 = dgl_utf16_to_utf8(&arena, utf16, count_16, &size_8);
+            round_trip_errors += size_8 != size || memcmp(from_16, text, size) != 0 || from_16[size] != 0;
+            uint8 *from_32 = dgl_utf32_to_utf8(&arena, utf32, count_32, &size_8);
+            round_trip_errors += size_8 != size || memcmp(from_32, text, size) != 0;
+            dgl_mem_arena_end_temp(temp);
+        }
+        DGL_EXPECT_uint32(round_trip_errors, ==, 0);
+
+        usize count;
+        usize size;
+        uint16 lone_surrogate[] = { 'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 0xD83D, 'x' };
+        uint32 too_large[] = { 'a', 0x110000 };
+        usize used = arena.curr_offset;
+        DGL_EXPECT_ptr(dgl_utf8_to_utf16(&arena, dgl_cast(uint8 *)"\xC0\xAF", 2, &count), ==, 0);
+        DGL_EXPECT_ptr(dgl_utf16_to_utf8(&arena, lone_surrogate, array_count(lone_surrogate), &size), ==, 0);
+        DGL_EXPECT_ptr(dgl_utf32_to_utf8(&arena, too_large, array_count(too_large), &size), ==, 0);
+        DGL_EXPECT_usize(arena.curr_offset, ==, used);
+
+        uint16 pair[] = { 0xD83D, 0xDE00 };
+        uint8 *smiley = dgl_utf16_to_utf8(&arena, pair, 2, &size);
+        DGL_EXPECT_int32(strcmp(dgl_cast(char *)smiley, "\xF0\x9F\x98\x80"), ==, 0);
+        free(memory);
+    }
+    DGL_END_TEST();
+
+    DGL_BEGIN_TEST("Bitset");
+    {
+        usize memory_size = kilobytes(64);
+        uint8 *memory = dgl_cast(uint8 *)malloc(memory_size);
+        DGL_Mem_Arena arena;
+        dgl_mem_arena_init(&arena, memory, memory_size);
+
+        // NOTE(dgl): Compares against a byte per bit for sizes around the word and block ends.
+        usize sizes[] = { 1, 63, 64, 65, 255, 256, 1000, 4099 };
+        uint32 random = 42;
+        uint32 mismatches = 0;
+        for(usize size_index = 0; size_index < array_count(sizes); ++size_index)
+        {
+            DGL_Mem_Temp_Arena temp = dgl_mem_arena_begin_temp(&arena);
+            usize bit_count = sizes[size_index];
+            DGL_Bitset a = dgl_bitset_init(&arena, bit_count);
+            DGL_Bitset b = dgl_bitset_init(&arena, bit_count);
+            DGL_Bitset dest = dgl_bitset_init(&arena, bit_count);
+            mismatches += dgl_cast(uintptr)a.words % 32 != 0;
+            mismatches += dgl_bitset_find_next_set(&a, 0) != bit_count;
+            mismatches += dgl_bitset_find_next_unset(&a, 0) != 0;
+
+            uint8 *bits_a = dgl_mem_arena_push_array(&arena, uint8, bit_count);
+            uint8 *bits_b = dgl_mem_arena_push_array(&arena, uint8, bit_count);
+            for(usize index = 0; index < bit_count; ++index)
+            {
+                random = dgl_hash_uint32(random + 1);
+                bits_a[index] = (random % 3) == 0;
+                bits_b[index] = (random % 5) != 0;
+                if(bits_a[index]) { dgl_bitset_set(&a, index); }
+                if(bits_b[index]) { dgl_bitset_set(&b, index); }
+                if(!bits_b[index]) { dgl_bitset_clear(&b, index); }
+            }
+
+            usize count = 0;
+            for(usize index = 0; index < bit_count; ++index)
+            {
+                mismatches += dgl_bitset_test(&a, index) != bits_a[index];
+                mismatches += dgl_bitset_rank(&a, index) != count;
+                if(bits_a[index])
+                {
+                    mismatches += dgl_bitset_select(&a, count) != index;
+                    ++count;
+                }
+
+                usize next_set = index;
+                while(next_set < bit_count && !bits_a[next_set]) { ++next_set; }
+                usize next_unset = index;
+                while(next_unset < bit_count && bits_a[next_unset]) { ++next_unset; }
+                mismatches += dgl_bitset_find_next_set(&a, index) != next_set;
+                mismatches += dgl_bitset_find_next_unset(&a, index) != next_unset;
+            }
+            mismatches += dgl_bitset_count(&a) != count;
+            mismatches += dgl_bitset_rank(&a, bit_count) != count;
+            mismatches += dgl_bitset_select(&a, count) != bit_count;
+
+            DGL_Bitset_Iter iter = dgl_bitset_iter(&a);
+            usize expected = dgl_bitset_find_next_set(&a, 0);
+            for(usize index; dgl_bitset_iter_next(&iter, &index);)
+            {
+                mismatches += index != expected;
+                expected = dgl_bitset_find_next_set(&a, index + 1);
+            }
+            mismatches += expected != bit_count;
+
+            usize counts[4] = {};
+            for(usize index = 0; index < bit_count; ++index)
+            {
+                counts[0] += bits_a[index] & bits_b[index];
+                counts[1] += bits_a[index] | bits_b[index];
+                counts[2] += bits_a[index] ^ bits_b[index];
+                counts[3] += bits_a[index] & !bits_b[index];
+            }
+            mismatches += dgl_bitset_and(&dest, &a, &b) != counts[0];
+            mismatches += dgl_bitset_count(&dest) != counts[0];
+            mismatches += dgl_bitset_or(&dest, &a, &b) != counts[1];
+            mismatches += dgl_bitset_xor(&dest, &a, &b) != counts[2];
+            mismatches += dgl_bitset_andnot(&dest, &a, &b) != counts[3];
+            for(usize index = 0; index < bit_count; ++index)
+            {
+                mismatches += dgl_bitset_test(&dest, index) != (bits_a[index] && !bits_b[index]);
+            }
+
+            // NOTE(dgl): The result can be one of the inputs.
+            mismatches += dgl_bitset_or(&a, &a, &b) != counts[1];
+            mismatches += dgl_bitset_xor(&a, &a, &a) != 0;
+
+            dgl_bitset_set_all(&dest);
+            mismatches += dgl_bitset_count(&dest) != bit_count;
+            mismatches += dgl_bitset_find_next_unset(&dest, 0) != bit_count;
+            usize count_b = dgl_bitset_count(&b);
+            mismatches += dgl_bitset_andnot(&b, &dest, &b) != bit_count - count_b;
+            dgl_bitset_clear_all(&dest);
+            mismatches += dgl_bitset_count(&dest) != 0;
+            dgl_mem_arena_end_temp(temp);
+        }
+        DGL_EXPECT_uint32(mismatches, ==, 0);
+        free(memory);
+    }
+    DGL_END_TEST();
+
+    DGL_BEGIN_TEST("Fast memcpy and memset");
+    {
+        // NOTE(dgl): Every size up to the loops and past them at all alignments, with guard bytes
+        // around the destination. The last size takes the non temporal path.
+        usize big_size = DGL_FAST_MEMCPY_STREAM_THRESHOLD + 77;
+        uint8 *source = dgl_cast(uint8 *)malloc(big_size + 64);
+        uint8 *dest = dgl_cast(uint8 *)malloc(big_size + 64);
+        for(usize index = 0; index < big_size + 64; ++index) { source[index] = dgl_cast(uint8)(index * 7 + 1); }
+
+        uint32 mismatches = 0;
+        usize sizes[] = { 0, 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 32, 33, 48, 63, 64, 65, 66, 95, 127, 128, 129, 200, 255, 256, 1000, 4097, big_size };
+        for(usize size_index = 0; size_index < array_count(sizes); ++size_index)
+        {
+            usize size = sizes[size_index];
+            usize alignments = size < 4097 ? 32 : 2;
+            for(usize offset = 0; offset < alignments; ++offset)
+            {
+                uint8 *d = dest + 16 + offset;
+                uint8 *s = source + (offset * 5) % 32;
+                dgl_memset(dest, 0xAA, size + 64);
+                dgl_fast_memcpy(d, s, size);
+                mismatches += memcmp(d, s, size) != 0;
+                mismatches += dest[15 + offset] != 0xAA || d[size] != 0xAA;
+
+                dgl_fast_memset(d, 0x5C, size);
+                for(usize index = 0; index < size; ++index) { mismatches += d[index] != 0x5C; }
+                mismatches += dest[15 + offset] != 0xAA || d[size] != 0xAA;
+            }
+        }
+        DGL_EXPECT_uint32(mismatches, ==, 0);
+        free(source);
+        free(dest);
+    }
+    DGL_END_TEST();
+
+    DGL_BEGIN_TEST("Log file segments");
+    {
+        char *base_path = "dgl_test_log";
+        remove_log_segments(base_path);
+
+        DGL_Log_File log_file;
+        DGL_EXPECT_bool32(dgl_log_file_open(&log_file, base_path, kilobytes(4)), ==, true);
+        dgl_log_init(log_time_in_ms);
+        dgl_log_set_sink(dgl_log_file_sink, &log_file);
+        for(int32 index = 0; index < 1000; ++index)
+        {
+            DGL_LOG("message %d", index);
+        }
+
+        // NOTE(dgl): Long lines are cut off to DGL_LOG_LINE_SIZE including the newline.
+        char long_message[2 * DGL_LOG_LINE_SIZE];
+        dgl_memset(long_message, 'x', sizeof(long_message) - 1);
+        long_message[sizeof(long_message) - 1] = 0;
+        Log_Capture capture = {};
+        dgl_log_set_sink(log_capture_sink, &capture);
+        DGL_LOG("%s", long_message);
+        DGL_EXPECT_usize(capture.length, ==, DGL_LOG_LINE_SIZE);
+        DGL_EXPECT_int32(capture.last, ==, '\n');
+        dgl_log_set_sink(0, 0);
+
+        DGL_Log_Reader reader;
+        DGL_EXPECT_bool32(dgl_log_reader_open(&reader, base_path, 0), ==, true);
+        char expected[64];
+        char *line;
+        usize length;
+        uint32 line_count = 0;
+        uint32 wrong_lines = 0;
+        while((length = dgl_log_reader_next(&reader, &line)) > 0)
+        {
+            usize expected_length = dgl_cast(usize)snprintf(expected, sizeof(expected), " message %u\n", line_count);
+            wrong_lines += length < expected_length || memcmp(line + length - expected_length, expected, expected_length) != 0;
+            wrong_lines += memcmp(line, "00:00:01.0234", 13) != 0;
+            ++line_count;
+        }
+        DGL_EXPECT_uint32(line_count, ==, 1000);
+        DGL_EXPECT_uint32(wrong_lines, ==, 0);
+        DGL_EXPECT_bool32(reader.segment_index >= 4, ==, true);
+
+        // NOTE(dgl): Tail the file while threads write to it. Every thread's lines have to arrive
+        // once and in order.
+        Log_File_Work work[4];
+        pthread_t threads[4];
+        uint32 next_line[4] = {};
+        for(uint32 index = 0; index < array_count(threads); ++index)
+        {
+            work[index].log_file = &log_file;
+            work[index].thread_index = index;
+            work[index].line_count = 5000;
+            pthread_create(threads + index, 0, log_file_thread, work + index);
+        }
+
+        uint32 total = 0;
+        uint32 out_of_order = 0;
+        for(uint32 spin = 0; total < 4 * 5000 && spin < 100000000; ++spin)
+        {
+            length = dgl_log_reader_next(&reader, &line);
+            if(length > 0)
+            {
+                uint32 thread_index = 0;
+                uint32 line_index = 0;
+                bool32 parsed = sscanf(line, "thread %u line %u", &thread_index, &line_index) == 2 && thread_index < 4;
+                out_of_order += !parsed || next_line[thread_index] != line_index;
+                if(parsed) { next_line[thread_index] = line_index + 1; }
+                ++total;
+            }
+            else
+            {
+                sched_yield();
+            }
+        }
+        for(uint32 index = 0; index < array_count(threads); ++index) { pthread_join(threads[index], 0); }
+        DGL_EXPECT_uint32(total, ==, 4 * 5000);
+        DGL_EXPECT_uint32(out_of_order, ==, 0);
+
+        dgl_log_file_close(&log_file);
+        DGL_EXPECT_usize(dgl_log_reader_next(&reader, &line), ==, 0);
+        dgl_log_reader_close(&reader);
+        remove_log_segments(base_path);
+
+        // NOTE(dgl): A second log file on the same path takes the next index. Rotating the first
+        // one has to skip it instead of dropping lines, and a reader follows only the log file
+        // of the segment it starts at.
+        char *shared_path = "dgl_test_log_shared";
+        remove_log_segments(shared_path);
+        DGL_Log_File first;
+        DGL_Log_File second;
+        DGL_EXPECT_bool32(dgl_log_file_open(&first, shared_path, kilobytes(4)), ==, true);
+        DGL_EXPECT_bool32(dgl_log_file_open(&second, shared_path, kilobytes(4)), ==, true);
+        DGL_Log_File_Header *second_header = dgl_cast(DGL_Log_File_Header *)second.segments[0].base;
+        DGL_EXPECT_uint64(second_header->segment_index, ==, 1);
+        DGL_EXPECT_uint64(second_header->first_segment_index, ==, 1);
+
+        char first_line[] = "first line\n";
+        char second_line[] = "second line\n";
+        uint32 dropped = 0;
+        for(uint32 index = 0; index < 1000; ++index)
+        {
+            dropped += !dgl_log_file_write(&first, first_line, sizeof(first_line) - 1);
+        }
+        for(uint32 index = 0; index < 500; ++index)
+        {
+            dropped += !dgl_log_file_write(&second, second_line, sizeof(second_line) - 1);
+        }
+        DGL_EXPECT_uint32(dropped, ==, 0);
+        DGL_EXPECT_bool32(first.next_segment_index > 3, ==, true);
+        DGL_EXPECT_bool32(second.next_segment_index > first.next_segment_index, ==, true);
+        dgl_log_file_close(&first);
+        dgl_log_file_close(&second);
+
+        uint32 first_count = 0;
+        uint32 second_count = 0;
+        uint32 foreign_lines = 0;
+        DGL_EXPECT_bool32(dgl_log_reader_open(&reader, shared_path, 0), ==, true);
+        while((length = dgl_log_reader_next(&reader, &line)) > 0)
+        {
+            ++first_count;
+            foreign_lines += length != sizeof(first_line) - 1 || memcmp(line, first_line, length) != 0;
+        }
+        dgl_log_reader_close(&reader);
+        DGL_EXPECT_bool32(dgl_log_reader_open(&reader, shared_path, 1), ==, true);
+        while((length = dgl_log_reader_next(&reader, &line)) > 0)
+        {
+            ++second_count;
+            foreign_lines += length != sizeof(second_line) - 1 || memcmp(line, second_line, length) != 0;
+        }
+        dgl_log_reader_close(&reader);
+        DGL_EXPECT_uint32(first_count, ==, 1000);
+        DGL_EXPECT_uint32(second_count, ==, 500);
+        DGL_EXPECT_uint32(foreign_lines, ==, 0);
+        remove_log_segments(shared_path);
+    }
+    DGL_END_TEST();
+
     if(dgl_test_result()) { return(0); }
     else { return(1); }
 }
@@ -0,0 +1,178 @@
+#define DGL_IMPLEMENTATION
+#include "dgl.hpp"
+
+#include "dgl_test_helpers.h"
+
+#include <stdlib.h>
+#include <vector>
+#include <type_traits>
+
+struct Entity
+{
+    uint64 id;
+    real32 position[3];
+};
+
+// NOTE(dgl): Counts constructions and destructions to check the owning wrappers.
+global int32 tracked_alive;
+
+struct Tracked
+{
+    int32 value;
+    Tracked(int32 value) : value(value) { ++tracked_alive; }
+    ~Tracked() { --tracked_alive; }
+};
+
+struct alignas(64) Cache_Line
+{
+    uint8 bytes[64];
+};
+
+int
+main(int argc, char **argv)
+{
+    DGL_BEGIN_TEST("Typed arena");
+    {
+        uint8 memory[4096];
+        dgl::Arena arena(memory, sizeof(memory));
+
+        uint8 *byte = arena.push<uint8>();
+        Entity *entity = arena.push<Entity>();
+        Cache_Line *line = arena.push<Cache_Line>();
+        DGL_EXPECT_ptr(byte, ==, memory);
+        DGL_EXPECT_int32(dgl_cast(int32)(dgl_cast(uintptr)entity % alignof(Entity)), ==, 0);
+        DGL_EXPECT_int32(dgl_cast(int32)(dgl_cast(uintptr)line % 64), ==, 0);
+        DGL_EXPECT_usize(arena.raw.curr_offset, ==, arena.raw.prev_offset + sizeof(Cache_Line));
+
+        // NOTE(dgl): Same offsets as the C functions for the same alignment.
+        DGL_Mem_Arena c_arena;
+        dgl_mem_arena_init(&c_arena, memory, sizeof(memory));
+        dgl_mem_arena_alloc_align(&c_arena, 1, 1);
+        dgl_mem_arena_alloc_align(&c_arena, sizeof(Entity), alignof(Entity));
+        dgl_mem_arena_alloc_align(&c_arena, sizeof(Cache_Line), 64);
+        DGL_EXPECT_usize(arena.raw.curr_offset, ==, c_arena.curr_offset);
+
+        dgl_memset(memory + arena.raw.curr_offset, 0xFF, 256);
+        int32 *values = arena.push_array<int32, 16>();
+        uint32 not_zero = 0;
+        for(uint32 index = 0; index < 16; ++index) { not_zero += values[index] != 0; }
+        DGL_EXPECT_uint32(not_zero, ==, 0);
+
+        Tracked *tracked = arena.make<Tracked>(7);
+        DGL_EXPECT_int32(tracked->value, ==, 7);
+        tracked->~Tracked();
+
+        {
+            dgl::Temp_Scope temp(arena);
+            arena.push_array<real32>(100);
+            DGL_EXPECT_bool32(arena.raw.curr_offset > c_arena.curr_offset, ==, true);
+        }
+        DGL_EXPECT_usize(arena.raw.curr_offset, ==, c_arena.curr_offset + 16 * sizeof(int32) + sizeof(Tracked));
+    }
+    DGL_END_TEST();
+
+    DGL_BEGIN_TEST("Typed pool and owning pointers");
+    {
+        static_assert(!std::is_copy_constructible<dgl::Pool_Ptr<Tracked>>::value, "Pool_Ptr must be move only");
+        static_assert(std::is_move_constructible<dgl::Pool_Ptr<Tracked>>::value, "Pool_Ptr must be movable");
+        static_assert(dgl::Pool<Entity>::chunk_size == 24, "Chunk size is rounded to the alignment");
+        static_assert(dgl::Pool<Entity, 32>::chunk_size == 32, "Chunk size is rounded to the alignment");
+
+        uint8 memory[1024];
+        dgl::Pool<Entity> pool(memory + 1, sizeof(memory) - 1);
+        Entity *first = pool.push();
+        Entity *second = pool.push();
+        DGL_EXPECT_int32(dgl_cast(int32)(dgl_cast(uintptr)first % alignof(Entity)), ==, 0);
+        DGL_EXPECT_ptr(dgl_cast(uint8 *)second, ==, dgl_cast(uint8 *)first + 24);
+        first->id = 12;
+        pool.release(first);
+        Entity *again = pool.push();
+        DGL_EXPECT_ptr(again, ==, first);
+        DGL_EXPECT_uint64(again->id, ==, 0);
+
+        // NOTE(dgl): The C pool can use the same memory.
+        DGL_EXPECT_ptr(dgl_mem_pool_push(&pool.raw, Entity), ==, dgl_cast(uint8 *)second + 24);
+
+        uint8 tracked_memory[1024];
+        dgl::Pool<Tracked> tracked_pool(tracked_memory, sizeof(tracked_memory));
+        {
+            dgl::Pool_Ptr<Tracked> a = dgl::make_pool_ptr(&tracked_pool, 1);
+            dgl::Pool_Ptr<Tracked> b = dgl::make_pool_ptr(&tracked_pool, 2);
+            DGL_EXPECT_int32(tracked_alive, ==, 2);
+            Tracked *a_object = a.get();
+            Tracked *b_object = b.get();
+
+            dgl::Pool_Ptr<Tracked> moved(std::move(b));
+            DGL_EXPECT_bool32(!b, ==, true);
+            DGL_EXPECT_ptr(moved.get(), ==, b_object);
+            DGL_EXPECT_int32(moved->value, ==, 2);
+
+            a = std::move(moved);
+            DGL_EXPECT_int32(tracked_alive, ==, 1);
+            DGL_EXPECT_int32(a->value, ==, 2);
+            // NOTE(dgl): The chunk of the replaced object is handed out next.
+            DGL_EXPECT_ptr(tracked_pool.push(), ==, a_object);
+        }
+        DGL_EXPECT_int32(tracked_alive, ==, 0);
+    }
+    DGL_END_TEST();
+
+    DGL_BEGIN_TEST("Typed handle pool");
+    {
+        static_assert(!std::is_copy_assignable<dgl::Unique_Handle<Tracked>>::value, "Unique_Handle must be move only");
+
+        uint8 memory[4096];
+        dgl::Handle_Pool<Tracked> pool(memory, sizeof(memory));
+        DGL_Mem_Handle stale = 0;
+        {
+            dgl::Unique_Handle<Tracked> handle = dgl::make_unique_handle(&pool, 5);
+            DGL_EXPECT_int32(handle->value, ==, 5);
+            DGL_EXPECT_int32(tracked_alive, ==, 1);
+            stale = handle.handle;
+
+            dgl::Unique_Handle<Tracked> other;
+            other = std::move(handle);
+            DGL_EXPECT_bool32(!handle, ==, true);
+            DGL_EXPECT_ptr(handle.get(), ==, 0);
+            DGL_EXPECT_int32(other->value, ==, 5);
+        }
+        DGL_EXPECT_int32(tracked_alive, ==, 0);
+        DGL_EXPECT_ptr(pool.get(stale), ==, 0);
+        DGL_EXPECT_bool32(pool.destroy(stale), ==, false);
+    }
+    DGL_END_TEST();
+
+    DGL_BEGIN_TEST("Arena allocator and scratch scope");
+    {
+        usize memory_size = kilobytes(64);
+        uint8 *memory = dgl_cast(uint8 *)malloc(memory_size);
+        dgl::Arena arena(memory, memory_size);
+        {
+            dgl::Temp_Scope temp(arena);
+            dgl::Arena_Allocator<int32> allocator(&arena);
+            std::vector<int32, dgl::Arena_Allocator<int32>> values(allocator);
+            for(int32 index = 0; index < 1000; ++index) { values.push_back(index); }
+            int64 sum = 0;
+            for(int32 value : values) { sum += value; }
+            DGL_EXPECT_int64(sum, ==, 499500);
+            DGL_EXPECT_bool32(dgl_cast(uint8 *)values.data() >= memory && dgl_cast(uint8 *)values.data() < memory + memory_size, ==, true);
+        }
+        DGL_EXPECT_usize(arena.raw.curr_offset, ==, 0);
+
+        // NOTE(dgl): The scratch arenas of the main thread keep pointing here after the test.
+        local_persist uint8 scratch_memory[4096];
+        dgl_mem_scratch_thread_init(scratch_memory, sizeof(scratch_memory));
+        {
+            dgl::Scratch_Scope scratch(&arena.raw);
+            real32 *temporary = dgl_cast(real32 *)dgl::arena_alloc<alignof(real32), true>(scratch.arena(), 64 * sizeof(real32));
+            DGL_EXPECT_bool32(dgl_cast(uint8 *)temporary >= scratch_memory && dgl_cast(uint8 *)temporary < scratch_memory + sizeof(scratch_memory), ==, true);
+            DGL_EXPECT_bool32(scratch.arena()->curr_offset > 0, ==, true);
+        }
+        DGL_EXPECT_usize(dgl_mem_get_scratch(0, 0)->curr_offset, ==, 0);
+        free(memory);
+    }
+    DGL_END_TEST();
+
+    if(dgl_test_result()) { return(0); }
+    else { return(1); }
+}